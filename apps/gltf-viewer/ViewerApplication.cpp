@@ -1,5 +1,9 @@
 #include "ViewerApplication.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <numeric>
 
@@ -8,13 +12,47 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/io.hpp>
 
+#include "utils/async_program.hpp"
 #include "utils/cameras.hpp"
+#include "utils/file_watcher.hpp"
 #include "utils/gltf.hpp"
+#include "utils/hot_reload.hpp"
 #include "utils/images.hpp"
+#include "utils/material_buffer.hpp"
+#include "utils/textures.hpp"
+#include "utils/uniform_ring_buffer.hpp"
 
 #include <stb_image_write.h>
 #include <tiny_gltf.h>
 
+namespace
+{
+
+// std140 layout of an element of the DrawUniforms block of the vertex
+// shaders
+struct DrawUniforms
+{
+  glm::mat4 modelViewProjMatrix;
+  glm::mat4 modelViewMatrix;
+  glm::mat4 normalMatrix;
+};
+
+// DrawUniforms of the instances of a mesh in a frame: the nodes referencing
+// it, or their EXT_mesh_gpu_instancing instances. A mesh has two groups, its
+// mirrored instances being drawn with clockwise front faces.
+struct MeshInstances
+{
+  size_t byteOffset = 0; // In the frame
+  uint32_t capacity = 0; // Instances of the group, reachable from the roots
+  uint32_t count = 0; // Instances written
+};
+
+// Uniform block binding points of DrawUniforms and Material
+const GLuint kDrawUniformsBinding = 0;
+const GLuint kMaterialBinding = 1;
+
+} // namespace
+
 void keyCallback(
     GLFWwindow *window, int key, int scancode, int action, int mods)
 {
@@ -24,9 +62,9 @@ void keyCallback(
 }
 
 bool ViewerApplication::loadGltfFile(tinygltf::Model &model) {
-    tinygltf::TinyGLTF loader;
     std::string warning, error;
-    bool returnValue = loader.LoadASCIIFromFile(&model, &error, &warning, m_gltfFilePath.string());
+    bool returnValue =
+        m_gltfLoader.load(m_gltfFilePath, model, &error, &warning);
     if(!warning.empty()) {
         std::cerr << "Warning: " << warning << std::endl;
     }
@@ -37,165 +75,287 @@ bool ViewerApplication::loadGltfFile(tinygltf::Model &model) {
         std::cerr << "glTF parsing failed" << std::endl;
         return false;
     }
+    const auto meshoptSize = m_gltfLoader.meshoptDecodedSize();
+    if (meshoptSize > 0) {
+        const auto seconds = m_gltfLoader.meshoptDecodeSeconds();
+        std::clog << "Decoded " << meshoptSize * 1e-6
+                  << " MB of EXT_meshopt_compression data in "
+                  << seconds * 1e3 << " ms (" << meshoptSize / seconds * 1e-9
+                  << " GB/s)" << std::endl;
+    }
     return true;
 }
 
-std::vector<GLuint> ViewerApplication::createBufferObjects(const tinygltf::Model &model) {
-    std::vector<GLuint> bufferObjects(model.buffers.size(), 0);
-    glGenBuffers(model.buffers.size(), bufferObjects.data());
-    for(int i = 0; i < model.buffers.size(); i++) {
-        glBindBuffer(GL_ARRAY_BUFFER, bufferObjects[i]);
-        // My GL version is 4.2 (< 4.4) :-/
-        glBufferData(GL_ARRAY_BUFFER, model.buffers[i].data.size(), model.buffers[i].data.data(), GL_STATIC_DRAW); 
+void ViewerApplication::reportTimings(const Timings &timings) const
+{
+  if (m_Options.printTimings) {
+    std::clog << "Startup timings of " << m_gltfFilePath.string() << ":"
+              << std::endl;
+    timings.print(std::clog);
+  }
+  if (m_Options.timingsJsonPath == "-") {
+    timings.printJson(std::cout);
+  } else if (!m_Options.timingsJsonPath.empty()) {
+    std::ofstream output(m_Options.timingsJsonPath.string());
+    timings.printJson(output);
+    if (!output) {
+      std::cerr << "Unable to write timings to " << m_Options.timingsJsonPath
+                << std::endl;
     }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    return bufferObjects;
+  }
+}
+
+bool ViewerApplication::loadBakedScene(Scene &scene)
+{
+  std::string error;
+  if (!m_BakedScene.load(m_gltfFilePath, scene, &error)) {
+    std::cerr << "Error: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void ViewerApplication::createBufferObjects(
+    const Scene &scene, GpuBuffers &gpuBuffers, bool pullVertices) const
+{
+  // My GL version is 4.2 (< 4.4) :-/
+  // Bytes may come directly from a memory mapped file
+  gpuBuffers.upload(scene,
+      pullVertices ? std::min(kDefaultGpuBufferSize,
+                         VertexArrays::getMaxVertexDataSize())
+                   : kDefaultGpuBufferSize);
+  if (!m_Options.printTimings) {
+    return;
+  }
+  uint64_t sceneSize = 0;
+  for (const auto &buffer : scene.buffers) {
+    sceneSize += buffer.size;
+  }
+  const auto &layout = gpuBuffers.layout();
+  std::clog << "Uploaded " << layout.uploadedSize() / (1024. * 1024.)
+            << " MB of vertex and index data to "
+            << layout.gpuBufferSizes.size() << " buffers, out of "
+            << sceneSize / (1024. * 1024.) << " MB of glTF buffers"
+            << std::endl;
 }
 
-std::vector<GLuint> ViewerApplication::createVertexArrayObjects(const tinygltf::Model &model, const std::vector<GLuint> &bufferObjects, std::vector<VaoRange> &meshIndexToVaoRange) {
-	std::vector<GLuint> vertexArrayObjects;
-	meshIndexToVaoRange.resize(model.meshes.size());
-	const GLuint VERTEX_ATTRIB_POSITION_IDX = 0;
-	const GLuint VERTEX_ATTRIB_NORMAL_IDX = 1;
-	const GLuint VERTEX_ATTRIB_TEXCOORD0_IDX = 2;
- 	for(int meshIdx = 0; meshIdx < model.meshes.size(); meshIdx++) {
- 		const tinygltf::Mesh &mesh = model.meshes[meshIdx];
- 		VaoRange &vaoRange = meshIndexToVaoRange[meshIdx];
- 		vaoRange.begin = GLsizei(vertexArrayObjects.size());
-    	vaoRange.count = GLsizei(mesh.primitives.size());
- 		vertexArrayObjects.resize(vertexArrayObjects.size() + mesh.primitives.size());
- 		glGenVertexArrays(vaoRange.count, &vertexArrayObjects[vaoRange.begin]);
- 		for(int primIdx = 0; primIdx < mesh.primitives.size(); primIdx++) {
- 			const GLuint vao = vertexArrayObjects[vaoRange.begin + primIdx];
- 			const tinygltf::Primitive & primitive = mesh.primitives[primIdx];
- 			glBindVertexArray(vao);
-			{
-				const auto it = primitive.attributes.find("POSITION");
-				if (it != end(primitive.attributes)) {
-					const int accessorIdx = (*it).second;
-					const tinygltf::Accessor &accessor = model.accessors[accessorIdx];
-					const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-					const int bufferIdx = bufferView.buffer;
-					const GLuint bufferObject = bufferObjects[bufferIdx];
-					glEnableVertexAttribArray(VERTEX_ATTRIB_POSITION_IDX);
-					glBindBuffer(GL_ARRAY_BUFFER, bufferObject);
-					const size_t byteOffset = accessor.byteOffset + bufferView.byteOffset;
-					glVertexAttribPointer(VERTEX_ATTRIB_POSITION_IDX, accessor.type, accessor.componentType, GL_FALSE, bufferView.byteStride, (const GLvoid*)byteOffset);
-				}
-			}
-			{
-				const auto it = primitive.attributes.find("NORMAL");
-				if (it != end(primitive.attributes)) {
-					const int accessorIdx = (*it).second;
-					const tinygltf::Accessor &accessor = model.accessors[accessorIdx];
-					const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-					const int bufferIdx = bufferView.buffer;
-					const GLuint bufferObject = bufferObjects[bufferIdx];
-					glEnableVertexAttribArray(VERTEX_ATTRIB_NORMAL_IDX);
-					glBindBuffer(GL_ARRAY_BUFFER, bufferObject);
-					const size_t byteOffset = accessor.byteOffset + bufferView.byteOffset;
-					glVertexAttribPointer(VERTEX_ATTRIB_NORMAL_IDX, accessor.type, accessor.componentType, GL_FALSE, bufferView.byteStride, (const GLvoid*)byteOffset);
-				}
-			}
-			{
-				const auto it = primitive.attributes.find("TEXCOORD_0");
-				if (it != end(primitive.attributes)) {
-					const int accessorIdx = (*it).second;
-					const tinygltf::Accessor &accessor = model.accessors[accessorIdx];
-					const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-					const int bufferIdx = bufferView.buffer;
-					const GLuint bufferObject = bufferObjects[bufferIdx];
-					glEnableVertexAttribArray(VERTEX_ATTRIB_TEXCOORD0_IDX);
-					glBindBuffer(GL_ARRAY_BUFFER, bufferObject);
-					const size_t byteOffset = accessor.byteOffset + bufferView.byteOffset;
-					glVertexAttribPointer(VERTEX_ATTRIB_TEXCOORD0_IDX, accessor.type, accessor.componentType, GL_FALSE, bufferView.byteStride, (const GLvoid*)byteOffset);
-				}
-			}
-			if(primitive.indices >= 0) {
-				const int accessorIdx = primitive.indices;
-				const tinygltf::Accessor &accessor = model.accessors[accessorIdx];
-				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-				const int bufferIdx = bufferView.buffer;
-				assert(GL_ELEMENT_ARRAY_BUFFER == bufferView.target);
-				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferObjects[bufferIdx]);
-			}
- 		}
- 	}
- 	glBindVertexArray(0);
- 	return vertexArrayObjects;
+void ViewerApplication::createVertexArrayObjects(const Scene &scene,
+    const GpuBuffers &gpuBuffers, bool pullVertices,
+    VertexArrays &vertexArrays) const
+{
+  vertexArrays.create(scene, gpuBuffers, pullVertices);
+  if (!m_Options.printTimings) {
+    return;
+  }
+  std::clog << "Created " << vertexArrays.size()
+            << " vertex array objects for " << scene.primitives.size()
+            << " primitives";
+  if (pullVertices) {
+    std::clog << ", " << vertexArrays.pulledCount()
+              << " of them pulling their vertices";
+  }
+  std::clog << std::endl;
 }
 
 std::vector<GLuint> ViewerApplication::createTextureObjects(const tinygltf::Model &model) const {
   std::vector<GLuint> textureObjects(model.textures.size(), 0);
-  glGenTextures(model.textures.size(), textureObjects.data());
   for(size_t texIdx = 0; texIdx < model.textures.size(); texIdx++) {
-    glBindTexture(GL_TEXTURE_2D, textureObjects[texIdx]);
-    const tinygltf::Texture &texture = model.textures[texIdx];
-    assert(texture.source >= 0);
-    const tinygltf::Image &image = model.images[texture.source];
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA, image.pixel_type, image.image.data());
-    tinygltf::Sampler defaultSampler;
-    defaultSampler.minFilter = GL_LINEAR;
-    defaultSampler.magFilter = GL_LINEAR;
-    defaultSampler.wrapS = GL_REPEAT;
-    defaultSampler.wrapT = GL_REPEAT;
-    defaultSampler.wrapR = GL_REPEAT;
-    const tinygltf::Sampler &sampler = texture.sampler >= 0 ? model.samplers[texture.sampler] : defaultSampler;
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter != -1 ? sampler.minFilter : GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter != -1 ? sampler.magFilter : GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, sampler.wrapR);
-    if( sampler.minFilter == GL_NEAREST_MIPMAP_NEAREST ||
-        sampler.minFilter == GL_NEAREST_MIPMAP_LINEAR ||
-        sampler.minFilter == GL_LINEAR_MIPMAP_NEAREST ||
-        sampler.minFilter == GL_LINEAR_MIPMAP_LINEAR) {
+    textureObjects[texIdx] = createTextureObject(model, texIdx);
+  }
+  return textureObjects;
+}
+
+GLuint ViewerApplication::createTextureObject(
+    const tinygltf::Model &model, size_t textureIdx) const
+{
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+  const tinygltf::Texture &texture = model.textures[textureIdx];
+  assert(texture.source >= 0);
+  const tinygltf::Image &image = model.images[texture.source];
+  setSamplerParameters(model, texture);
+  const bool mipmaps = texture.sampler >= 0 &&
+                       usesMipmaps(model.samplers[texture.sampler].minFilter);
+  if (const auto *cached = m_gltfLoader.cachedImage(texture.source)) {
+    uploadImageLevels(cached->levels, cached->bitsPerComponent, mipmaps);
+  } else if (const auto *compressed =
+                 m_gltfLoader.compressedImage(texture.source)) {
+    uploadCompressedImageLevels(*compressed, mipmaps);
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0,
+        GL_RGBA, image.pixel_type, image.image.data());
+    if (mipmaps) {
       glGenerateMipmap(GL_TEXTURE_2D);
     }
   }
   glBindTexture(GL_TEXTURE_2D, 0);
+  return textureObject;
+}
+
+std::vector<GLuint> ViewerApplication::createTextureObjects(
+    const Scene &scene) const
+{
+  const auto &images = m_BakedScene.images();
+  std::vector<GLuint> textureObjects(scene.textures.size(), 0);
+  glGenTextures(GLsizei(textureObjects.size()), textureObjects.data());
+  for (size_t texIdx = 0; texIdx < scene.textures.size(); ++texIdx) {
+    const auto &texture = scene.textures[texIdx];
+    glBindTexture(GL_TEXTURE_2D, textureObjects[texIdx]);
+    setSamplerParameters(texture);
+    if (texture.image >= 0 && !images[texture.image].levels.empty()) {
+      const auto &image = images[texture.image];
+      uploadImageLevels(image.levels, image.bitsPerComponent,
+          usesMipmaps(texture.minFilter));
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
   return textureObjects;
 }
 
 int ViewerApplication::run()
 {
+  // Startup phases are measured until the end of the first frame
+  Timings timings;
+  Timings *const pTimings =
+      m_Options.printTimings || !m_Options.timingsJsonPath.empty() ? &timings
+                                                                   : nullptr;
+  m_gltfLoader.setTimings(pTimings);
+  const auto compressedFormats = getSupportedCompressedFormats();
+  m_gltfLoader.setCompressedFormats(compressedFormats);
+
+  // Vertex pulling has its own vertex shader, which also reads vertex arrays
+  const bool pullVertices =
+      m_Options.vertexPulling && VertexArrays::supportsVertexPulling();
+  if (m_Options.vertexPulling && !pullVertices) {
+    std::cerr << "Warning: vertex pulling needs OpenGL 4.3 with shader "
+                 "storage blocks in vertex shaders, drawing from vertex arrays"
+              << std::endl;
+  }
+
   // Loader shaders
-  const auto glslProgram =
-      compileProgram({m_ShadersRootPath / m_AppName / m_vertexShader,
-          m_ShadersRootPath / m_AppName / m_fragmentShader});
-
-  const auto modelViewProjMatrixLocation =
-      glGetUniformLocation(glslProgram.glId(), "uModelViewProjMatrix");
-  const auto modelViewMatrixLocation =
-      glGetUniformLocation(glslProgram.glId(), "uModelViewMatrix");
-  const auto normalMatrixLocation =
-      glGetUniformLocation(glslProgram.glId(), "uNormalMatrix");
-  const GLint lightDirectionLocation =
-      glGetUniformLocation(glslProgram.glId(), "uLightDirection");
-  const GLint lightIntensityLocation =
-      glGetUniformLocation(glslProgram.glId(), "uLightIntensity");
-  const GLint baseColorTextureLocation =
-      glGetUniformLocation(glslProgram.glId(), "uBaseColorTexture");
-  const GLint baseColorFactorLocation =
-      glGetUniformLocation(glslProgram.glId(), "uBaseColorFactor");
-  const GLint metallicRoughnessTextureLocation =
-      glGetUniformLocation(glslProgram.glId(), "uMetallicRoughnessTexture");
-  const GLint metallicFactorLocation =
-      glGetUniformLocation(glslProgram.glId(), "uMetallicFactor");
-  const GLint roughnessFactorLocation =
-      glGetUniformLocation(glslProgram.glId(), "uRoughnessFactor");
-  const GLint emissiveTextureLocation =
-      glGetUniformLocation(glslProgram.glId(), "uEmissiveTexture");
-  const GLint emissiveFactorLocation =
-      glGetUniformLocation(glslProgram.glId(), "uEmissiveFactor");
+  Timings::Scope compileProgramTiming{pTimings, "compileProgram"};
+  const std::vector<fs::path> shaderPaths{
+      m_ShadersRootPath / m_AppName /
+          (pullVertices ? std::string{"forward_pulling.vs.glsl"}
+                        : m_vertexShader),
+      m_ShadersRootPath / m_AppName / m_fragmentShader};
+  const auto shaderDefines = VertexArrays::getShaderDefines();
+  GLProgram glslProgram = compileProgram(shaderPaths, shaderDefines);
+  compileProgramTiming.stop();
+
+  // Queried again each time shaders are reloaded
+  GLint modelViewProjMatrixLocation, modelViewMatrixLocation,
+      normalMatrixLocation, lightDirectionLocation, lightIntensityLocation,
+      baseColorTextureLocation, baseColorFactorLocation,
+      metallicRoughnessTextureLocation, metallicFactorLocation,
+      roughnessFactorLocation, emissiveTextureLocation, emissiveFactorLocation,
+      texCoordTransformLocation;
+  // Vertex shaders without a DrawUniforms block get their matrices as plain
+  // uniforms. Those with an array of DrawUniforms draw up to
+  // maxDrawInstances instances of a mesh at once, whose DrawUniforms are
+  // drawUniformsStride bytes apart.
+  bool hasDrawUniformsBlock = false;
+  size_t drawUniformsBlockSize = 0;
+  size_t maxDrawInstances = 1;
+  size_t drawUniformsStride = sizeof(DrawUniforms);
+  const size_t drawUniformsAlignment = UniformRingBuffer::getOffsetAlignment();
+  // Same for fragment shaders without a Material block and material factors
+  bool hasMaterialBlock = false;
+  const auto getUniformLocations = [&]() {
+    const GLuint drawUniformsIndex =
+        glGetUniformBlockIndex(glslProgram.glId(), "DrawUniforms");
+    hasDrawUniformsBlock = drawUniformsIndex != GL_INVALID_INDEX;
+    maxDrawInstances = 1;
+    drawUniformsStride = sizeof(DrawUniforms);
+    if (hasDrawUniformsBlock) {
+      glUniformBlockBinding(
+          glslProgram.glId(), drawUniformsIndex, kDrawUniformsBinding);
+      GLint blockSize = 0;
+      glGetActiveUniformBlockiv(glslProgram.glId(), drawUniformsIndex,
+          GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+      drawUniformsBlockSize = size_t(blockSize);
+      // Each draw binds the whole block, at an aligned offset
+      maxDrawInstances =
+          std::max(drawUniformsBlockSize / sizeof(DrawUniforms), size_t(1));
+      while (maxDrawInstances > 1 &&
+             maxDrawInstances * sizeof(DrawUniforms) % drawUniformsAlignment) {
+        --maxDrawInstances;
+      }
+      if (maxDrawInstances == 1) {
+        drawUniformsStride =
+            (sizeof(DrawUniforms) + drawUniformsAlignment - 1) /
+            drawUniformsAlignment * drawUniformsAlignment;
+      }
+    }
+    const GLuint materialIndex =
+        glGetUniformBlockIndex(glslProgram.glId(), "Material");
+    hasMaterialBlock = materialIndex != GL_INVALID_INDEX;
+    if (hasMaterialBlock) {
+      glUniformBlockBinding(
+          glslProgram.glId(), materialIndex, kMaterialBinding);
+    }
+    modelViewProjMatrixLocation =
+        glGetUniformLocation(glslProgram.glId(), "uModelViewProjMatrix");
+    modelViewMatrixLocation =
+        glGetUniformLocation(glslProgram.glId(), "uModelViewMatrix");
+    normalMatrixLocation =
+        glGetUniformLocation(glslProgram.glId(), "uNormalMatrix");
+    lightDirectionLocation =
+        glGetUniformLocation(glslProgram.glId(), "uLightDirection");
+    lightIntensityLocation =
+        glGetUniformLocation(glslProgram.glId(), "uLightIntensity");
+    baseColorTextureLocation =
+        glGetUniformLocation(glslProgram.glId(), "uBaseColorTexture");
+    baseColorFactorLocation =
+        glGetUniformLocation(glslProgram.glId(), "uBaseColorFactor");
+    metallicRoughnessTextureLocation =
+        glGetUniformLocation(glslProgram.glId(), "uMetallicRoughnessTexture");
+    metallicFactorLocation =
+        glGetUniformLocation(glslProgram.glId(), "uMetallicFactor");
+    roughnessFactorLocation =
+        glGetUniformLocation(glslProgram.glId(), "uRoughnessFactor");
+    emissiveTextureLocation =
+        glGetUniformLocation(glslProgram.glId(), "uEmissiveTexture");
+    emissiveFactorLocation =
+        glGetUniformLocation(glslProgram.glId(), "uEmissiveFactor");
+    texCoordTransformLocation =
+        glGetUniformLocation(glslProgram.glId(), "uTexCoordTransform");
+  };
+  getUniformLocations();
   
       
+  // Baked scenes are loaded without tinygltf, model then stays empty
+  const bool isBakedScene = BakedScene::isBakedScene(m_gltfFilePath);
+  // Streaming makes no sense when rendering a single image, nor for baked
+  // scenes whose images are already decoded
+  const bool streamTextures = m_Options.textureUploadBudget > 0 &&
+                              m_OutputPath.empty() && !isBakedScene;
+  m_gltfLoader.setDeferImageDecoding(streamTextures);
+
   tinygltf::Model model;
-  if(!loadGltfFile(model)) {
-    return -1;
+  Scene scene;
+  if (isBakedScene) {
+    Timings::Scope timing{pTimings, "baked scene load"};
+    if (!loadBakedScene(scene)) {
+      return -1;
+    }
+  } else {
+    if (!loadGltfFile(model)) {
+      return -1;
+    }
+    {
+      Timings::Scope timing{pTimings, "scene extraction"};
+      scene = extractScene(model, m_gltfLoader.bufferSpans());
+    }
+    Timings::Scope timing{pTimings, "computeSceneBounds"};
+    computeSceneBounds(model, m_gltfLoader.bufferSpans(), scene);
   }
-  glm::vec3 bboxMin, bboxMax;
-  computeSceneBounds(model, bboxMin, bboxMax);
+  // Owns the rewritten vertices and indices scene.buffers may end with
+  std::vector<std::vector<unsigned char>> geometryStorage;
+  applyGeometryOptions(scene, m_Options.geometryOptions, geometryStorage,
+      &m_ThreadPool, pTimings);
+  const glm::vec3 bboxMin = scene.bboxMin, bboxMax = scene.bboxMax;
 
   glm::vec3 
       diagonal = bboxMax - bboxMin, 
@@ -217,9 +377,21 @@ int ViewerApplication::run()
     cameraController->setCamera(Camera{eye, center, up});
   }
 
-  const std::vector<GLuint> textureObjects = createTextureObjects(model);
-  
-  GLuint whiteTexture;
+  Timings::Scope createTextureObjectsTiming{pTimings, "createTextureObjects"};
+  std::unique_ptr<TextureStreamer> textureStreamer;
+  std::vector<GLuint> textureObjects;
+  if (streamTextures) {
+    textureStreamer = std::make_unique<TextureStreamer>(
+        model, m_gltfLoader, m_ThreadPool, m_Options.textureUploadBudget);
+  } else if (isBakedScene) {
+    textureObjects = createTextureObjects(scene);
+  } else {
+    textureObjects = createTextureObjects(model);
+  }
+  createTextureObjectsTiming.stop();
+
+  GLuint whiteTexture = 0;
+  glGenTextures(1, &whiteTexture);
   glBindTexture(GL_TEXTURE_2D, whiteTexture);
   float white[] = {1, 1, 1, 1};
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_FLOAT, white);
@@ -230,9 +402,122 @@ int ViewerApplication::run()
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  const std::vector<GLuint> bufferObjects = createBufferObjects(model);
-  std::vector<VaoRange> meshToVertexArrays;
-  const std::vector<GLuint> vertexArrayObjects = createVertexArrayObjects(model, bufferObjects, meshToVertexArrays);
+  Timings::Scope createBufferObjectsTiming{pTimings, "createBufferObjects"};
+  GpuBuffers gpuBuffers;
+  createBufferObjects(scene, gpuBuffers, pullVertices);
+  createBufferObjectsTiming.stop();
+  Timings::Scope createVertexArrayObjectsTiming{
+      pTimings, "createVertexArrayObjects"};
+  VertexArrays vertexArrays;
+  createVertexArrayObjects(scene, gpuBuffers, pullVertices, vertexArrays);
+  createVertexArrayObjectsTiming.stop();
+  MaterialBuffer materialBuffer;
+  materialBuffer.create(scene);
+
+  // Only scene records are needed from now on, except for streamed images.
+  // Bounds have been computed by extractScene().
+  const auto releaseData = [&]() {
+    m_gltfLoader.releaseData(model);
+    m_BakedScene.release();
+    scene.buffers.clear();
+    geometryStorage.clear();
+  };
+
+  // Hot reload: changed files are parsed again in background, then only the
+  // GL objects whose data changed are updated. The camera and the GUI state
+  // are kept.
+  const bool watchFiles =
+      m_Options.watch && m_OutputPath.empty() && !isBakedScene;
+  if (m_Options.watch && isBakedScene) {
+    std::cerr << "Warning: --watch only reloads shaders for baked scenes"
+              << std::endl;
+  }
+  FileWatcher fileWatcher;
+  SceneHashes sceneHashes;
+  std::future<std::unique_ptr<ReloadedGltf>> pendingReload;
+  double lastChangeTime = -1; // Of a change not reloaded yet, -1 if none
+  double reloadStartTime = 0;
+  const auto watchDependencies = [&]() {
+    fileWatcher.clear();
+    for (const auto &path : getGltfFileDependencies(m_gltfFilePath, model)) {
+      fileWatcher.watch(path);
+    }
+  };
+  if (watchFiles) {
+    // Before releaseData(), buffers are hashed
+    sceneHashes = computeSceneHashes(scene, model, m_gltfLoader);
+    watchDependencies();
+  }
+
+  const auto applyReload = [&](ReloadedGltf &reloaded) {
+    if (!reloaded.warning.empty()) {
+      std::cerr << "Warning: " << reloaded.warning << std::endl;
+    }
+    if (!reloaded.succeeded) {
+      std::cerr << "Error: " << reloaded.error << std::endl
+                << "Reload failed, keeping the current scene" << std::endl;
+      return;
+    }
+    // Streaming is done, its textures are updated like the others
+    if (textureStreamer) {
+      textureObjects = textureStreamer->textureObjects();
+      textureStreamer.reset();
+    }
+    m_gltfLoader = std::move(reloaded.loader);
+    model = std::move(reloaded.model);
+    scene = std::move(reloaded.scene);
+    geometryStorage = std::move(reloaded.geometryStorage);
+    sceneHashes = std::move(reloaded.hashes);
+    const auto &diff = reloaded.diff;
+
+    // While the referenced ranges of buffers stay the same, changed buffers
+    // are uploaded again in place and vertex array objects stay valid
+    // (diff.buffers lists all buffers if their count changed)
+    const bool buffersMoved = !gpuBuffers.update(scene, diff.buffers);
+
+    if (buffersMoved || diff.primitivesResized) {
+      createVertexArrayObjects(scene, gpuBuffers, pullVertices, vertexArrays);
+    } else {
+      vertexArrays.update(scene, gpuBuffers, diff.primitives);
+    }
+    materialBuffer.create(scene);
+
+    if (diff.texturesResized) {
+      glDeleteTextures(GLsizei(textureObjects.size()), textureObjects.data());
+      textureObjects = createTextureObjects(model);
+    } else {
+      for (const auto texIdx : diff.textures) {
+        glDeleteTextures(1, &textureObjects[texIdx]);
+        textureObjects[texIdx] = createTextureObject(model, texIdx);
+      }
+    }
+
+    std::clog << "Reloaded " << m_gltfFilePath.string() << " in "
+              << glfwGetTime() - reloadStartTime << " seconds: "
+              << diff.buffers.size() << " buffers, " << diff.primitives.size()
+              << " primitives and " << diff.textures.size()
+              << " textures updated" << std::endl;
+
+    // Buffers and images may have been renamed
+    watchDependencies();
+    if (m_Options.lowMemory) {
+      releaseData();
+    }
+  };
+
+  if (m_Options.lowMemory && !textureStreamer) {
+    releaseData();
+  }
+
+  // Shader hot reload: the new program is built while the current one keeps
+  // being used, and replaces it only if it links
+  const bool watchShaders = m_Options.watch && m_OutputPath.empty();
+  FileWatcher shaderWatcher;
+  AsyncProgramBuilder programBuilder;
+  double lastShaderChangeTime = -1; // Of a change not rebuilt yet, -1 if none
+  if (watchShaders) {
+    shaderWatcher.watch(m_ShadersRootPath / m_AppName);
+  }
 
   // Setup OpenGL state for rendering
   glEnable(GL_DEPTH_TEST);
@@ -242,67 +527,72 @@ int ViewerApplication::run()
   glm::vec3 lightDirection(1., 1., 1.), lightIntensity(1., 1., 1.);
   bool lightFromCamera = false;
 
+  // Texture object of a glTF texture. missingTexture is used if there is no
+  // texture, placeholder if the texture is still being streamed.
+  const auto getTextureObject = [&](int textureIdx, GLuint missingTexture,
+                                    GLuint placeholder) {
+    if (textureIdx < 0) {
+      return missingTexture;
+    }
+    return textureStreamer
+               ? textureStreamer->getTextureObject(textureIdx, placeholder)
+               : textureObjects[textureIdx];
+  };
+
   const auto bindMaterial = [&](const int materialIndex) {
+    // Single-sided by default. Culling back faces also lets the order of
+    // --optimize-overdraw reject the fragments of inner surfaces.
+    if (materialIndex >= 0 && scene.materials[materialIndex].doubleSided) {
+      glDisable(GL_CULL_FACE);
+    } else {
+      glEnable(GL_CULL_FACE);
+    }
+    if(hasMaterialBlock) {
+      materialBuffer.bind(kMaterialBinding, materialIndex);
+    }
     if(materialIndex >= 0) {
-      const tinygltf::Material &material = model.materials[materialIndex];
-      const tinygltf::PbrMetallicRoughness &pbrMetallicRoughness = material.pbrMetallicRoughness;
-      if(baseColorFactorLocation >= 0) {
-        glUniform4f(baseColorFactorLocation,
-                   (float)pbrMetallicRoughness.baseColorFactor[0],
-                   (float)pbrMetallicRoughness.baseColorFactor[1],
-                   (float)pbrMetallicRoughness.baseColorFactor[2],
-                   (float)pbrMetallicRoughness.baseColorFactor[3]);
+      const Scene::Material &material = scene.materials[materialIndex];
+      if(!hasMaterialBlock && baseColorFactorLocation >= 0) {
+        glUniform4fv(baseColorFactorLocation, 1,
+            glm::value_ptr(material.baseColorFactor));
       }
       if(baseColorTextureLocation >= 0) {
-        GLuint textureObject = whiteTexture;
-        if(pbrMetallicRoughness.baseColorTexture.index >= 0) {
-          const tinygltf::Texture &texture = model.textures[pbrMetallicRoughness.baseColorTexture.index];
-          if(texture.source >= 0) {
-            textureObject = textureObjects[texture.source];
-          }
-        }
+        const GLuint textureObject = getTextureObject(
+            material.baseColorTexture, whiteTexture, whiteTexture);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, textureObject);
         glUniform1i(baseColorTextureLocation, 0);
       }
-      if(metallicFactorLocation >= 0) {
-        glUniform1f(metallicFactorLocation, (float)pbrMetallicRoughness.metallicFactor);
+      if(!hasMaterialBlock && metallicFactorLocation >= 0) {
+        glUniform1f(metallicFactorLocation, material.metallicFactor);
       }
-      if(roughnessFactorLocation >= 0) {
-        glUniform1f(roughnessFactorLocation, (float)pbrMetallicRoughness.roughnessFactor);
+      if(!hasMaterialBlock && roughnessFactorLocation >= 0) {
+        glUniform1f(roughnessFactorLocation, material.roughnessFactor);
       }
       if(metallicRoughnessTextureLocation >= 0) {
-        GLuint textureObject = 0;
-        if(pbrMetallicRoughness.metallicRoughnessTexture.index >= 0) {
-            const tinygltf::Texture &texture = model.textures[pbrMetallicRoughness.metallicRoughnessTexture.index];
-            if(texture.source >= 0) {
-                textureObject = textureObjects[texture.source];
-            }
-        }
+        const GLuint textureObject = getTextureObject(
+            material.metallicRoughnessTexture, 0, whiteTexture);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, textureObject);
         glUniform1i(metallicRoughnessTextureLocation, 1);
       }
-      if(emissiveFactorLocation >= 0) {
-        glUniform3f(emissiveFactorLocation,
-            (float)material.emissiveFactor[0],
-            (float)material.emissiveFactor[1],
-            (float)material.emissiveFactor[2]);
+      if(!hasMaterialBlock && emissiveFactorLocation >= 0) {
+        glUniform3fv(emissiveFactorLocation, 1,
+            glm::value_ptr(material.emissiveFactor));
       }
       if(emissiveTextureLocation >= 0) {
-        GLuint textureObject = 0;
-        if(material.emissiveTexture.index >= 0) {
-          const tinygltf::Texture &texture = model.textures[material.emissiveTexture.index];
-          if(texture.source >= 0) {
-            textureObject = textureObjects[texture.source];
-          }
-        }
+        const GLuint textureObject =
+            getTextureObject(material.emissiveTexture, 0, 0);
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, textureObject);
         glUniform1i(emissiveTextureLocation, 2);
       }
+      if(!hasMaterialBlock && texCoordTransformLocation >= 0) {
+        glUniform4fv(texCoordTransformLocation, 2,
+            glm::value_ptr(material.texCoordTransform[0]));
+      }
     } else {
-        if(baseColorFactorLocation >= 0) {
+        if(!hasMaterialBlock && baseColorFactorLocation >= 0) {
             glUniform4f(baseColorFactorLocation, 1, 1, 1, 1);
         }
         if (baseColorTextureLocation >= 0) {
@@ -310,10 +600,10 @@ int ViewerApplication::run()
             glBindTexture(GL_TEXTURE_2D, whiteTexture);
             glUniform1i(baseColorTextureLocation, 0);
         }
-        if (metallicFactorLocation >= 0) {
+        if (!hasMaterialBlock && metallicFactorLocation >= 0) {
             glUniform1f(metallicFactorLocation, 1.f);
         }
-        if (roughnessFactorLocation >= 0) {
+        if (!hasMaterialBlock && roughnessFactorLocation >= 0) {
             glUniform1f(roughnessFactorLocation, 1.f);
         }
         if (metallicRoughnessTextureLocation >= 0) {
@@ -321,7 +611,7 @@ int ViewerApplication::run()
             glBindTexture(GL_TEXTURE_2D, 0);
             glUniform1i(metallicRoughnessTextureLocation, 1);
         }
-        if (emissiveFactorLocation >= 0) {
+        if (!hasMaterialBlock && emissiveFactorLocation >= 0) {
             glUniform3f(emissiveFactorLocation, 0.f, 0.f, 0.f);
         }
         if (emissiveTextureLocation >= 0) {
@@ -329,9 +619,19 @@ int ViewerApplication::run()
             glBindTexture(GL_TEXTURE_2D, 0);
             glUniform1i(emissiveTextureLocation, 2);
         }
+        if (!hasMaterialBlock && texCoordTransformLocation >= 0) {
+            const Scene::Material defaultMaterial;
+            glUniform4fv(texCoordTransformLocation, 2,
+                glm::value_ptr(defaultMaterial.texCoordTransform[0]));
+        }
     }
   };
 
+  // Per-frame uniforms of drawn nodes, grouped by mesh
+  UniformRingBuffer drawUniforms;
+  std::vector<unsigned char> cpuDrawUniforms; // Without a DrawUniforms block
+  std::vector<MeshInstances> meshInstances;
+
   // Lambda function to draw the scene
   const auto drawScene = [&](const Camera &camera) {
     glViewport(0, 0, m_nWindowWidth, m_nWindowHeight);
@@ -356,56 +656,150 @@ int ViewerApplication::run()
       glUniform3fv(lightDirectionLocation, 1, glm::value_ptr(lightDirectionInViewSpace));
     }
 
-    // The recursive function that should draw a node
+    // Matrices of all drawn nodes are written in one pass over the nodes,
+    // grouped by mesh and by whether they are mirrored (group 2 * mesh + 1),
+    // then the instances of each group are drawn together. Mirroring is
+    // tracked from the local matrices, so that both passes agree on it.
+    meshInstances.assign(2 * scene.meshes.size(), MeshInstances{});
+    const std::function<void(int, bool)> countNode = [&](int nodeIdx, bool mirrored) {
+      const Scene::Node &node = scene.nodes[nodeIdx];
+      mirrored = mirrored != isMirroring(node.localMatrix);
+      if(node.mesh >= 0 && node.instanceCount == 0) {
+        meshInstances[2 * node.mesh + mirrored].capacity++;
+      }
+      for(uint32_t instanceIdx = 0; node.mesh >= 0 && instanceIdx < node.instanceCount; instanceIdx++) {
+        const bool instanceMirrored = isMirroring(scene.instanceMatrices[node.firstInstance + instanceIdx]);
+        meshInstances[2 * node.mesh + (mirrored != instanceMirrored)].capacity++;
+      }
+      for(uint32_t childIdx = node.firstChild; childIdx < node.firstChild + node.childCount; childIdx++) {
+        countNode(scene.children[childIdx], mirrored);
+      }
+    };
+    for(const uint32_t nodeIdx : scene.rootNodes) {
+      countNode(nodeIdx, false);
+    }
+    // Groups start at aligned offsets, and the block bound for the last one
+    // must fit in the frame
+    size_t uniformsSize = 0;
+    for(MeshInstances &instances : meshInstances) {
+      instances.byteOffset = uniformsSize;
+      uniformsSize += (instances.capacity * drawUniformsStride + drawUniformsAlignment - 1) / drawUniformsAlignment * drawUniformsAlignment;
+    }
+    unsigned char *uniforms = nullptr;
+    if(hasDrawUniformsBlock) {
+      uniforms = drawUniforms.beginFrame(uniformsSize + drawUniformsBlockSize);
+    } else {
+      cpuDrawUniforms.resize(uniformsSize);
+      uniforms = cpuDrawUniforms.data();
+    }
+
+    // The recursive function that should compute the matrices of a node
     // We use a std::function because a simple lambda cannot be recursive
-    const std::function<void(int, const glm::mat4 &)> drawNode =
-        [&](int nodeIdx, const glm::mat4 &parentMatrix) {
-          	const tinygltf::Node &node = model.nodes[nodeIdx];
-          	glm::mat4 modelMatrix = getLocalToWorldMatrix(node, parentMatrix);
+    const std::function<void(int, const glm::mat4 &, bool)> computeNode =
+        [&](int nodeIdx, const glm::mat4 &parentMatrix, bool mirrored) {
+          	const Scene::Node &node = scene.nodes[nodeIdx];
+          	glm::mat4 modelMatrix = parentMatrix * node.localMatrix;
+          	mirrored = mirrored != isMirroring(node.localMatrix);
           	if(node.mesh >= 0) {
-          		glm::mat4 modelViewMatrix = viewMatrix * modelMatrix;
-          		glm::mat4 modelViewProjectionMatrix = projMatrix * modelViewMatrix;
-          		glm::mat4 normalMatrix = glm::transpose(glm::inverse(modelViewMatrix));
-          		glUniformMatrix4fv(modelViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(modelViewMatrix));
-          		glUniformMatrix4fv(modelViewProjMatrixLocation, 1, GL_FALSE, glm::value_ptr(modelViewProjectionMatrix));
-          		glUniformMatrix4fv(normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(normalMatrix));
-          		const tinygltf::Mesh &mesh = model.meshes[node.mesh];
-          		const VaoRange &vaoRange = meshToVertexArrays[node.mesh];
-          		for(GLsizei primIdx = 0; primIdx < mesh.primitives.size(); primIdx++) {
-          			const GLuint vao = vertexArrayObjects[vaoRange.begin + primIdx];
-                const tinygltf::Primitive &primitive = mesh.primitives[primIdx];
-                bindMaterial(primitive.material);
-          			glBindVertexArray(vao);
-          			if(primitive.indices >= 0) {
-          				const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-          				const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-          				const size_t byteOffset = accessor.byteOffset + bufferView.byteOffset;
-          				glDrawElements(primitive.mode, accessor.count, accessor.componentType, (const GLvoid*)byteOffset);
-          			} else {
-          				const int accessorIdx = (*begin(primitive.attributes)).second;
-          				const tinygltf::Accessor &accessor = model.accessors[accessorIdx];
-          				glDrawArrays(primitive.mode, 0, accessor.count);
+          		const Scene::Mesh &mesh = scene.meshes[node.mesh];
+          		float screenCoverage = 0.f;
+          		for(uint32_t instanceIdx = 0; instanceIdx < std::max(node.instanceCount, 1u); instanceIdx++) {
+          			const bool instanceMirrored = node.instanceCount > 0 && isMirroring(scene.instanceMatrices[node.firstInstance + instanceIdx]);
+          			MeshInstances &instances = meshInstances[2 * node.mesh + (mirrored != instanceMirrored)];
+          			// Safety net, capacities are counted with the same traversal
+          			if(instances.count == instances.capacity) {
+          				continue;
+          			}
+          			const glm::mat4 instanceMatrix = node.instanceCount > 0 ? modelMatrix * scene.instanceMatrices[node.firstInstance + instanceIdx] : modelMatrix;
+          			DrawUniforms matrices;
+          			matrices.modelViewMatrix = viewMatrix * instanceMatrix;
+          			matrices.modelViewProjMatrix = projMatrix * matrices.modelViewMatrix;
+          			matrices.normalMatrix = glm::transpose(glm::inverse(matrices.modelViewMatrix));
+          			std::memcpy(uniforms + instances.byteOffset + instances.count * drawUniformsStride, &matrices, sizeof(DrawUniforms));
+          			instances.count++;
+          			if(textureStreamer) {
+          				screenCoverage = std::max(screenCoverage, estimateScreenCoverage(mesh.boundingSphere, matrices.modelViewMatrix, projMatrix));
+          			}
+          		}
+          		if(textureStreamer) {
+          			const uint32_t endPrimitive = mesh.firstPrimitive + mesh.primitiveCount;
+          			for(uint32_t primIdx = mesh.firstPrimitive; primIdx < endPrimitive; primIdx++) {
+          				textureStreamer->requestMaterial(scene.primitives[primIdx].material, screenCoverage);
           			}
           		}
           	}
-          	for(const int childIdx : node.children) {
-          		drawNode(childIdx, modelMatrix);
+          	for(uint32_t childIdx = node.firstChild; childIdx < node.firstChild + node.childCount; childIdx++) {
+          		computeNode(scene.children[childIdx], modelMatrix, mirrored);
           	}
         };
 
-    // Draw the scene referenced by gltf file
-    if (model.defaultScene >= 0) {
-    	for(const int nodeIdx : model.scenes[model.defaultScene].nodes) {
-    		drawNode(nodeIdx, glm::mat4(1));
-    	}
+    // Compute the matrices of the scene referenced by gltf file
+    for(const uint32_t nodeIdx : scene.rootNodes) {
+    	computeNode(nodeIdx, glm::mat4(1), false);
+    }
+    if(hasDrawUniformsBlock) {
+      drawUniforms.endWrites();
+    }
+
+    // Draw the instances of each group, maxDrawInstances at a time. Mirrored
+    // groups have clockwise front faces, so that culling keeps their outside.
+    // Consecutive primitives with the same material bind it once.
+    int32_t boundMaterial = -2;
+    GLenum frontFace = GL_CCW;
+    for(size_t groupIdx = 0; groupIdx < meshInstances.size(); groupIdx++) {
+      const MeshInstances &instances = meshInstances[groupIdx];
+      const Scene::Mesh &mesh = scene.meshes[groupIdx / 2];
+      const uint32_t endPrimitive = mesh.firstPrimitive + mesh.primitiveCount;
+      const GLenum groupFrontFace = groupIdx % 2 ? GL_CW : GL_CCW;
+      if(instances.count > 0 && groupFrontFace != frontFace) {
+        frontFace = groupFrontFace;
+        glFrontFace(frontFace);
+      }
+      for(size_t firstInstance = 0; firstInstance < instances.count; firstInstance += maxDrawInstances) {
+        const size_t byteOffset = instances.byteOffset + firstInstance * drawUniformsStride;
+        const GLsizei instanceCount = GLsizei(std::min(maxDrawInstances, instances.count - firstInstance));
+        if(hasDrawUniformsBlock) {
+          drawUniforms.bind(kDrawUniformsBinding, byteOffset, drawUniformsBlockSize);
+        } else {
+          DrawUniforms matrices;
+          std::memcpy(&matrices, uniforms + byteOffset, sizeof(DrawUniforms));
+          glUniformMatrix4fv(modelViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(matrices.modelViewMatrix));
+          glUniformMatrix4fv(modelViewProjMatrixLocation, 1, GL_FALSE, glm::value_ptr(matrices.modelViewProjMatrix));
+          glUniformMatrix4fv(normalMatrixLocation, 1, GL_FALSE, glm::value_ptr(matrices.normalMatrix));
+        }
+        for(uint32_t primIdx = mesh.firstPrimitive; primIdx < endPrimitive; primIdx++) {
+          const Scene::Primitive &primitive = scene.primitives[primIdx];
+          if(primitive.material != boundMaterial) {
+            bindMaterial(primitive.material);
+            boundMaterial = primitive.material;
+          }
+          const uint64_t indexByteOffset = vertexArrays.bind(primIdx);
+          if(primitive.indexBuffer >= 0) {
+            glDrawElementsInstancedBaseVertex(primitive.mode, primitive.count, primitive.indexType, (const GLvoid*)indexByteOffset, instanceCount, primitive.baseVertex);
+          } else {
+            glDrawArraysInstanced(primitive.mode, 0, primitive.count, instanceCount);
+          }
+        }
+      }
+    }
+    if(frontFace != GL_CCW) {
+      glFrontFace(GL_CCW);
+    }
+    vertexArrays.unbind();
+    materialBuffer.unbind();
+    if(hasDrawUniformsBlock) {
+      drawUniforms.endFrame();
     }
   };
 
   if(!m_OutputPath.empty()) {
   	std::vector<unsigned char> pixels(m_nWindowWidth * m_nWindowHeight * 3);
+  	Timings::Scope firstFrameTiming{pTimings, "first frame"};
   	renderToImage(m_nWindowWidth, m_nWindowHeight, 3, pixels.data(), [&](){
   		drawScene(cameraController->getCamera());
   	});
+  	firstFrameTiming.stop();
+  	reportTimings(timings);
   	flipImageYAxis(m_nWindowWidth, m_nWindowHeight, 3, pixels.data());
   	const std::string strPath = m_OutputPath.string();
   	stbi_write_png(strPath.c_str(), m_nWindowWidth, m_nWindowHeight, 3, pixels.data(), 0);
@@ -416,10 +810,73 @@ int ViewerApplication::run()
   for (auto iterationCount = 0u; !m_GLFWHandle.shouldClose();
        ++iterationCount) {
     const auto seconds = glfwGetTime();
+    Timings::Scope firstFrameTiming{
+        iterationCount == 0 ? pTimings : nullptr, "first frame"};
 
     const auto camera = cameraController->getCamera();
     drawScene(camera);
 
+    if (textureStreamer && !textureStreamer->done()) {
+      // Priorities have been set by drawScene
+      textureStreamer->update();
+      if (textureStreamer->done()) {
+        std::clog << "All textures streamed after " << glfwGetTime()
+                  << " seconds" << std::endl;
+        if (m_Options.lowMemory) {
+          releaseData();
+        }
+      }
+    }
+
+    if (watchShaders) {
+      for (const auto &path : shaderWatcher.poll()) {
+        if (path.extension() == ".glsl") {
+          lastShaderChangeTime = glfwGetTime();
+        }
+      }
+      if (lastShaderChangeTime >= 0 &&
+          glfwGetTime() - lastShaderChangeTime > 0.1) {
+        lastShaderChangeTime = -1;
+        std::string error;
+        if (!programBuilder.start(shaderPaths, shaderDefines, &error)) {
+          std::cerr << "Error: " << error << std::endl;
+        }
+      }
+      if (programBuilder.building() && programBuilder.isReady()) {
+        std::string error;
+        if (programBuilder.finish(glslProgram, &error)) {
+          glslProgram.use();
+          getUniformLocations();
+          std::clog << "Shaders reloaded" << std::endl;
+        } else {
+          std::cerr << error << std::endl
+                    << "Keeping the current shaders" << std::endl;
+        }
+      }
+    }
+
+    if (watchFiles) {
+      if (!fileWatcher.poll().empty()) {
+        lastChangeTime = glfwGetTime();
+      }
+      // Wait for writes to settle, exporters often write files in several
+      // steps
+      if (lastChangeTime >= 0 && !pendingReload.valid() &&
+          glfwGetTime() - lastChangeTime > 0.2) {
+        lastChangeTime = -1;
+        reloadStartTime = glfwGetTime();
+        pendingReload = reloadGltfFile(m_gltfFilePath, &m_ThreadPool,
+            m_pTextureCache.get(), compressedFormats,
+            m_Options.geometryOptions, scene, sceneHashes);
+      }
+      if (pendingReload.valid() &&
+          pendingReload.wait_for(std::chrono::seconds(0)) ==
+              std::future_status::ready &&
+          (!textureStreamer || textureStreamer->done())) {
+        applyReload(*pendingReload.get());
+      }
+    }
+
     // GUI code:
     imguiNewFrame();
 
@@ -427,6 +884,10 @@ int ViewerApplication::run()
       ImGui::Begin("GUI");
       ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
           1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+      if (textureStreamer && !textureStreamer->done()) {
+        ImGui::Text("Streaming textures %zu / %zu",
+            textureStreamer->finishedCount(), scene.textures.size());
+      }
       if (ImGui::CollapsingHeader("Camera", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Text("eye: %.3f %.3f %.3f", camera.eye().x, camera.eye().y,
             camera.eye().z);
@@ -497,6 +958,12 @@ int ViewerApplication::run()
     }
 
     m_GLFWHandle.swapBuffers(); // Swap front and back buffers
+
+    if (iterationCount == 0 && pTimings) {
+      glFinish(); // Wait for the GPU to actually render the frame
+      firstFrameTiming.stop();
+      reportTimings(timings);
+    }
   }
 
   // TODO clean up allocated GL data
@@ -507,7 +974,8 @@ int ViewerApplication::run()
 ViewerApplication::ViewerApplication(const fs::path &appPath, uint32_t width,
     uint32_t height, const fs::path &gltfFile,
     const std::vector<float> &lookatArgs, const std::string &vertexShader,
-    const std::string &fragmentShader, const fs::path &output) :
+    const std::string &fragmentShader, const fs::path &output,
+    const ViewerOptions &options) :
     m_nWindowWidth(width),
     m_nWindowHeight(height),
     m_AppPath{appPath},
@@ -515,6 +983,8 @@ ViewerApplication::ViewerApplication(const fs::path &appPath, uint32_t width,
     m_ImGuiIniFilename{m_AppName + ".imgui.ini"},
     m_ShadersRootPath{m_AppPath.parent_path() / "shaders"},
     m_gltfFilePath{gltfFile},
+    m_Options{options},
+    m_ThreadPool{options.threadCount},
     m_OutputPath{output}
 {
   if (!lookatArgs.empty()) {
@@ -533,6 +1003,12 @@ ViewerApplication::ViewerApplication(const fs::path &appPath, uint32_t width,
     m_fragmentShader = fragmentShader;
   }
 
+  if (!m_Options.textureCacheDirectory.empty()) {
+    m_pTextureCache =
+        std::make_unique<TextureCache>(m_Options.textureCacheDirectory);
+    m_gltfLoader.setTextureCache(m_pTextureCache.get());
+  }
+
 /*
   glGenFramebuffers(1, &m_GBufferFBO);
   glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_GBufferFBO);
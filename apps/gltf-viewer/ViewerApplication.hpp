@@ -1,30 +1,57 @@
 #pragma once
 
 #include "utils/GLFWHandle.hpp"
+#include "utils/baked_scene.hpp"
 #include "utils/cameras.hpp"
 #include "utils/filesystem.hpp"
+#include "utils/geometry_options.hpp"
+#include "utils/gltf_loader.hpp"
+#include "utils/gpu_buffers.hpp"
+#include "utils/scene.hpp"
 #include "utils/shaders.hpp"
+#include "utils/texture_cache.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/timings.hpp"
+#include "utils/vertex_arrays.hpp"
 
+#include <memory>
 #include <tiny_gltf.h>
 
+// Options of the viewer command, see main.cpp for their flags
+struct ViewerOptions
+{
+  // Workers used for load time tasks, 0 for one per hardware thread
+  uint32_t threadCount = 0;
+  // Max bytes of texture data uploaded per frame, 0 to disable streaming
+  size_t textureUploadBudget = 0;
+  // Directory of the texture cache, caching is disabled if empty
+  fs::path textureCacheDirectory;
+  // Free CPU copies of buffers and images once uploaded
+  bool lowMemory = false;
+  // Report startup timings on std::clog and/or as JSON to a file ("-" for
+  // std::cout)
+  bool printTimings = false;
+  fs::path timingsJsonPath;
+  // Reload the glTF file when it changes on disk, see hot_reload.hpp
+  bool watch = false;
+  // Load-time passes on vertices and indices, see geometry_options.hpp
+  GeometryOptions geometryOptions;
+  // Read vertices from storage buffers in the vertex shader, see
+  // vertex_arrays.hpp
+  bool vertexPulling = false;
+};
+
 class ViewerApplication
 {
 public:
   ViewerApplication(const fs::path &appPath, uint32_t width, uint32_t height,
       const fs::path &gltfFile, const std::vector<float> &lookatArgs,
       const std::string &vertexShader, const std::string &fragmentShader,
-      const fs::path &output);
+      const fs::path &output, const ViewerOptions &options);
 
   int run();
 
 private:
-  // A range of indices in a vector containing Vertex Array Objects
-  struct VaoRange
-  {
-    GLsizei begin; // Index of first element in vertexArrayObjects
-    GLsizei count; // Number of elements in range
-  };
-
   enum GBufferTextureType {
     GPosition = 0,
     GNormal,
@@ -35,9 +62,22 @@ private:
   };
 
   bool loadGltfFile(tinygltf::Model &model);
-  std::vector<GLuint> createBufferObjects(const tinygltf::Model &model);
-  std::vector<GLuint> createVertexArrayObjects(const tinygltf::Model &model, const std::vector<GLuint> &bufferObjects, std::vector<VaoRange> &meshIndexToVaoRange);
+  bool loadBakedScene(Scene &scene);
+  void reportTimings(const Timings &timings) const;
+  // Upload the vertex attributes and indices of scene to gpuBuffers, in
+  // buffer objects the vertex shader can read if pullVertices. Their size is
+  // reported with --timings.
+  void createBufferObjects(
+      const Scene &scene, GpuBuffers &gpuBuffers, bool pullVertices) const;
+  // Set up vertexArrays to draw the primitives of scene from gpuBuffers,
+  // reporting how many vertex array objects it takes with --timings
+  void createVertexArrayObjects(const Scene &scene,
+      const GpuBuffers &gpuBuffers, bool pullVertices,
+      VertexArrays &vertexArrays) const;
   std::vector<GLuint> createTextureObjects(const tinygltf::Model &model) const;
+  GLuint createTextureObject(
+      const tinygltf::Model &model, size_t textureIdx) const;
+  std::vector<GLuint> createTextureObjects(const Scene &scene) const;
   void computeTangents(const tinygltf::Model & model, std::vector<glm::vec3> &tangents);
 
   GLuint m_GBufferFBO;
@@ -58,6 +98,16 @@ private:
   const fs::path m_ShadersRootPath;
 
   fs::path m_gltfFilePath;
+  const ViewerOptions m_Options;
+  // Workers used for load time tasks (e.g. image decoding)
+  ThreadPool m_ThreadPool;
+  // Decoded images with their mipmaps, nullptr if disabled
+  std::unique_ptr<TextureCache> m_pTextureCache;
+  // Owns the memory mappings of the glTF file and its buffers
+  GltfLoader m_gltfLoader{&m_ThreadPool};
+  // Owns the memory mapping of a baked scene file, used instead of
+  // m_gltfLoader when m_gltfFilePath is one
+  BakedScene m_BakedScene;
   std::string m_vertexShader = "forward.vs.glsl";
   std::string m_fragmentShader = "pbr_directional_light.fs.glsl";
 
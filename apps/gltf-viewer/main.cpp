@@ -1,12 +1,33 @@
 #include "ViewerApplication.hpp"
 #include "utils/GLFWHandle.hpp"
+#include "utils/baked_scene.hpp"
+#include "utils/benchmarks.hpp"
 #include "utils/filesystem.hpp"
+#include "utils/geometry_options.hpp"
+#include "utils/gltf_loader.hpp"
+#include "utils/scene.hpp"
+#include "utils/scene_stats.hpp"
 
 #include <args.hxx>
 
 std::vector<std::string> split(
     const std::string &str, const std::string &delim);
 
+// Flags of the load-time geometry passes, shared by the viewer and bake
+// commands
+struct GeometryFlags
+{
+  args::ValueFlag<std::string> vertexLayout;
+  args::Flag optimizeVertexCache;
+  args::ValueFlag<float> optimizeOverdraw;
+  args::Flag narrowIndices;
+
+  explicit GeometryFlags(args::Subparser &parser);
+
+  // Throws args::ValidationError if a value is invalid
+  GeometryOptions get();
+};
+
 int main(int argc, char **argv)
 {
   auto returnCode = 0;
@@ -43,6 +64,36 @@ int main(int argc, char **argv)
             "Output path to render the image. If specified no window is shown. "
             "Only png is supported.",
             {"o", "output"}};
+        args::ValueFlag<uint32_t> threads{parser, "threads",
+            "Number of worker threads used to load the glTF file (default: "
+            "one per hardware thread)",
+            {"threads"}};
+        args::ValueFlag<float> streamTextures{parser, "MB",
+            "Stream textures in background, uploading at most this amount of "
+            "MB per frame. Placeholders are displayed meanwhile.",
+            {"stream-textures"}};
+        args::ValueFlag<std::string> textureCache{parser, "directory",
+            "Cache decoded images and their mipmaps in this directory, so "
+            "that next loads skip decoding",
+            {"texture-cache"}};
+        args::Flag lowMemory{parser, "low-memory",
+            "Free CPU copies of buffers and images once uploaded to the GPU",
+            {"low-memory"}};
+        args::Flag timings{parser, "timings",
+            "Print wall-clock and CPU time of startup phases",
+            {"timings"}};
+        args::ValueFlag<std::string> timingsJson{parser, "path",
+            "Write startup timings as JSON to this file (- for stdout)",
+            {"timings-json"}};
+        args::Flag watch{parser, "watch",
+            "Reload the glTF file when it or its buffers and images change, "
+            "uploading only what changed, and the shaders when they change",
+            {"watch"}};
+        args::Flag vertexPulling{parser, "vertex-pulling",
+            "Read vertices from shader storage buffers in the vertex shader "
+            "(OpenGL 4.3), with forward_pulling.vs.glsl instead of --vs",
+            {"vertex-pulling"}};
+        GeometryFlags geometryFlags{parser};
         parser.Parse();
 
         std::vector<float> lookatParams;
@@ -62,11 +113,162 @@ int main(int argc, char **argv)
         uint32_t width = imageWidth ? args::get(imageWidth) : 1280;
         uint32_t height = imageHeight ? args::get(imageHeight) : 720;
 
+        ViewerOptions options;
+        options.threadCount = threads ? args::get(threads) : 0;
+        options.textureUploadBudget =
+            streamTextures ? size_t(args::get(streamTextures) * 1024 * 1024)
+                           : 0;
+        options.textureCacheDirectory = args::get(textureCache);
+        options.lowMemory = args::get(lowMemory);
+        options.printTimings = args::get(timings);
+        options.timingsJsonPath = args::get(timingsJson);
+        options.watch = args::get(watch);
+        options.geometryOptions = geometryFlags.get();
+        options.vertexPulling = args::get(vertexPulling);
+
         ViewerApplication app{fs::path{argv[0]}, width, height, args::get(file),
             lookatParams, args::get(vertexShader), args::get(fragmentShader),
-            args::get(output)};
+            args::get(output), options};
         returnCode = app.run();
       }};
+  args::Command bake{commands, "bake",
+      "Convert a glTF file to a baked scene file, that the viewer loads "
+      "without parsing glTF nor decoding images",
+      [&](args::Subparser &parser) {
+        args::Positional<std::string> file{
+            parser, "file", "Path to glTF file", args::Options::Required};
+        args::Positional<std::string> output{parser, "output",
+            "Path to baked scene file", args::Options::Required};
+        args::ValueFlag<uint32_t> threads{parser, "threads",
+            "Number of worker threads used to decode images (default: one "
+            "per hardware thread)",
+            {"threads"}};
+        args::ValueFlag<std::string> textureCache{parser, "directory",
+            "Cache decoded images and their mipmaps in this directory",
+            {"texture-cache"}};
+        GeometryFlags geometryFlags{parser};
+        parser.Parse();
+        const auto geometryOptions = geometryFlags.get();
+
+        ThreadPool threadPool{threads ? args::get(threads) : 0};
+        GltfLoader loader{&threadPool};
+        std::unique_ptr<TextureCache> cache;
+        if (textureCache) {
+          cache = std::make_unique<TextureCache>(args::get(textureCache));
+          loader.setTextureCache(cache.get());
+        }
+
+        tinygltf::Model model;
+        std::string error, warning;
+        const bool loaded =
+            loader.load(args::get(file), model, &error, &warning);
+        if (!warning.empty()) {
+          std::cerr << "Warning: " << warning << std::endl;
+        }
+        if (!loaded) {
+          std::cerr << "Error: " << error << std::endl;
+          returnCode = 1;
+          return;
+        }
+
+        auto scene = extractScene(model, loader.bufferSpans());
+        computeSceneBounds(model, loader.bufferSpans(), scene);
+        std::vector<std::vector<unsigned char>> geometryStorage;
+        applyGeometryOptions(
+            scene, geometryOptions, geometryStorage, &threadPool, nullptr);
+        if (!bakeScene(args::get(output), scene, model, loader, &error)) {
+          std::cerr << "Error: " << error << std::endl;
+          returnCode = 1;
+        }
+      }};
+
+  args::Command stats{commands, "stats",
+      "Print statistics of a glTF file (counts, triangles, estimated VRAM, "
+      "duplicated data) without creating an OpenGL context",
+      [&](args::Subparser &parser) {
+        args::Positional<std::string> file{
+            parser, "file", "Path to glTF file", args::Options::Required};
+        args::Flag json{parser, "json", "Print statistics as JSON", {"json"}};
+        args::ValueFlag<uint32_t> top{parser, "count",
+            "Number of largest buffers, textures and meshes to list, 0 for "
+            "all (default: 10)",
+            {"top"}};
+        args::ValueFlag<uint32_t> threads{parser, "threads",
+            "Number of worker threads (default: one per hardware thread)",
+            {"threads"}};
+        parser.Parse();
+
+        ThreadPool threadPool{threads ? args::get(threads) : 0};
+        SceneStats sceneStats;
+        std::string error, warning;
+        const bool computed = computeSceneStats(
+            args::get(file), threadPool, sceneStats, &error, &warning);
+        if (!warning.empty()) {
+          std::cerr << "Warning: " << warning << std::endl;
+        }
+        if (!computed) {
+          std::cerr << "Error: " << error << std::endl;
+          returnCode = 1;
+          return;
+        }
+        const size_t topCount = top ? args::get(top) : 10;
+        if (json) {
+          printSceneStatsJson(sceneStats, std::cout, topCount);
+        } else {
+          printSceneStats(sceneStats, std::cout, topCount);
+        }
+      }};
+
+  args::Command benchmark{commands, "benchmark",
+      "Run a microbenchmark. Available: base64 (data URI decoding), "
+      "vertex-layout (vertex-bound draws with each --vertex-layout), "
+      "vertex-pulling (draw-bound frames with and without --vertex-pulling)",
+      [&](args::Subparser &parser) {
+        args::Positional<std::string> name{
+            parser, "name", "Benchmark to run", args::Options::Required};
+        args::Positional<std::string> file{parser, "file",
+            "Optional glTF file, loaded by the benchmark in addition to "
+            "synthetic data"};
+        args::ValueFlag<float> size{parser, "MB",
+            "Size of synthetic data in MB (default: 256)", {"size"}};
+        args::ValueFlag<uint32_t> iterations{parser, "count",
+            "Number of runs of each case, the best is kept (default: 5)",
+            {"iterations"}};
+        args::ValueFlag<uint32_t> primitives{parser, "count",
+            "Number of synthetic primitives drawn by draw-bound benchmarks "
+            "(default: 16384)",
+            {"primitives"}};
+        parser.Parse();
+
+        const auto byteCount =
+            size_t((size ? args::get(size) : 256.f) * 1024 * 1024);
+        const auto iterationCount = iterations ? args::get(iterations) : 5;
+        if (args::get(name) == "base64") {
+          if (!runBase64Benchmark(
+                  byteCount, iterationCount, args::get(file))) {
+            returnCode = 1;
+          }
+        } else if (args::get(name) == "vertex-layout") {
+          GLFWHandle handle{1, 1, "", false};
+          if (!runVertexLayoutBenchmark(
+                  byteCount, iterationCount, args::get(file))) {
+            returnCode = 1;
+          }
+        } else if (args::get(name) == "vertex-pulling") {
+          GLFWHandle handle{1, 1, "", false};
+          const fs::path appPath{argv[0]};
+          if (!runVertexPullingBenchmark(
+                  primitives ? args::get(primitives) : 16384, iterationCount,
+                  args::get(file),
+                  appPath.parent_path() / "shaders" / appPath.stem() /
+                      "forward_pulling.vs.glsl")) {
+            returnCode = 1;
+          }
+        } else {
+          std::cerr << "Unknown benchmark " << args::get(name) << std::endl;
+          returnCode = 1;
+        }
+      }};
 
   try {
     parser.ParseCLI(argc, argv);
@@ -107,4 +309,46 @@ std::vector<std::string> split(const std::string &str, const std::string &delim)
     prev = pos + delim.length();
   } while (pos < str.length() && prev < str.length());
   return tokens;
-}
\ No newline at end of file
+}
+
+GeometryFlags::GeometryFlags(args::Subparser &parser) :
+    vertexLayout{parser, "layout",
+        "Repack vertex attributes at load time: source (as stored, default), "
+        "interleaved (one stream), or split (positions, then the other "
+        "attributes interleaved)",
+        {"vertex-layout"}},
+    optimizeVertexCache{parser, "optimize-vertex-cache",
+        "Reorder triangles for the post-transform vertex cache and vertices "
+        "in order of first use at load time",
+        {"optimize-vertex-cache"}},
+    optimizeOverdraw{parser, "threshold",
+        "Also reorder clusters of triangles to reduce overdraw, letting the "
+        "vertex cache miss ratio of a cluster grow by this factor (e.g. "
+        "1.05). Implies --optimize-vertex-cache.",
+        {"optimize-overdraw"}},
+    narrowIndices{parser, "narrow-indices",
+        "Rewrite 32-bit indices as 16-bit ones when their range allows it, "
+        "rebasing them with a base vertex if needed",
+        {"narrow-indices"}}
+{
+}
+
+GeometryOptions GeometryFlags::get()
+{
+  GeometryOptions options;
+  options.optimizeVertexCache = args::get(optimizeVertexCache);
+  options.narrowIndices = args::get(narrowIndices);
+  if (optimizeOverdraw) {
+    options.overdrawThreshold = args::get(optimizeOverdraw);
+    if (!(options.overdrawThreshold >= 1.f)) {
+      throw args::ValidationError(
+          "--optimize-overdraw must be at least 1 (e.g. 1.05)");
+    }
+  }
+  if (vertexLayout &&
+      !parseVertexLayout(args::get(vertexLayout), options.vertexLayout)) {
+    throw args::ValidationError(
+        "Unknown vertex layout " + args::get(vertexLayout));
+  }
+  return options;
+}
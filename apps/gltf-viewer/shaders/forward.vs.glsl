@@ -8,14 +8,26 @@ out vec3 vViewSpacePosition;
 out vec3 vViewSpaceNormal;
 out vec2 vTexCoords;
 
-uniform mat4 uModelViewProjMatrix;
-uniform mat4 uModelViewMatrix;
-uniform mat4 uNormalMatrix;
+// Written for each drawn node, or instance of a node, to a per-frame uniform
+// buffer (see uniform_ring_buffer.hpp). Instances of a same mesh are drawn
+// together and read their own with gl_InstanceID.
+struct DrawMatrices
+{
+    mat4 modelViewProj;
+    mat4 modelView;
+    mat4 normal;
+};
+
+layout(std140) uniform DrawUniforms
+{
+    DrawMatrices uDraws[64];
+};
 
 void main()
 {
-    vViewSpacePosition = vec3(uModelViewMatrix * vec4(aPosition, 1));
-	vViewSpaceNormal = normalize(vec3(uNormalMatrix * vec4(aNormal, 0)));
+    DrawMatrices draw = uDraws[gl_InstanceID];
+    vViewSpacePosition = vec3(draw.modelView * vec4(aPosition, 1));
+	vViewSpaceNormal = normalize(vec3(draw.normal * vec4(aNormal, 0)));
 	vTexCoords = aTexCoords;
-    gl_Position =  uModelViewProjMatrix * vec4(aPosition, 1);
+    gl_Position =  draw.modelViewProj * vec4(aPosition, 1);
 }
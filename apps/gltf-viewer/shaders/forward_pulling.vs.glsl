@@ -0,0 +1,97 @@
+#version 430
+
+// forward.vs.glsl with vertex pulling: attributes are read from shader
+// storage buffers with gl_VertexID (see vertex_arrays.hpp)
+
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+
+out vec3 vViewSpacePosition;
+out vec3 vViewSpaceNormal;
+out vec2 vTexCoords;
+
+// Written for each drawn node, or instance of a node, to a per-frame uniform
+// buffer (see uniform_ring_buffer.hpp). Instances of a same mesh are drawn
+// together and read their own with gl_InstanceID.
+struct DrawMatrices
+{
+    mat4 modelViewProj;
+    mat4 modelView;
+    mat4 normal;
+};
+
+layout(std140) uniform DrawUniforms
+{
+    DrawMatrices uDraws[64];
+};
+
+// Index of the primitive drawn in uAttribFormats, 0xFFFFFFFF if its
+// attributes come from vertex arrays
+layout(location = 0) uniform uint uPrimitive;
+
+// Vertices of the primitive drawn
+layout(std430, binding = 0) readonly buffer VertexData
+{
+    uint uVertexWords[];
+};
+
+// For each primitive and each of its VertexAttribCount attributes (defined by
+// the viewer): byte offset in VertexData, byte stride, component type, and
+// size | normalized << 8 | component size << 16
+layout(std430, binding = 1) readonly buffer AttribFormats
+{
+    uvec4 uAttribFormats[];
+};
+
+float readComponent(uint byteOffset, uint componentType, bool normalized)
+{
+    const uint word = uVertexWords[byteOffset >> 2];
+    if (componentType == 0x1406u) { // GL_FLOAT
+        return uintBitsToFloat(word);
+    }
+    // GL_BYTE, GL_SHORT and GL_INT are even, their unsigned versions odd
+    const bool isSigned = (componentType & 1u) == 0u;
+    const int bitCount = componentType < 0x1402u ? 8 : (componentType < 0x1404u ? 16 : 32);
+    const int shift = int(byteOffset & 3u) * 8;
+    const float value = isSigned ? float(bitfieldExtract(int(word), shift, bitCount))
+                                 : float(bitfieldExtract(word, shift, bitCount));
+    if (!normalized) {
+        return value;
+    }
+    const float maxValue = exp2(float(isSigned ? bitCount - 1 : bitCount)) - 1.0;
+    return max(value / maxValue, -1.0);
+}
+
+vec4 readAttribute(uint attribIndex, vec4 defaultValue)
+{
+    const uvec4 format = uAttribFormats[VertexAttribCount * uPrimitive + attribIndex];
+    const uint size = format.w & 0xFFu;
+    const bool normalized = ((format.w >> 8) & 1u) != 0u;
+    const uint componentSize = format.w >> 16;
+    const uint byteOffset = format.x + uint(gl_VertexID) * format.y;
+    vec4 value = defaultValue;
+    for (uint i = 0u; i < size; ++i) {
+        value[i] = readComponent(byteOffset + i * componentSize, format.z, normalized);
+    }
+    return value;
+}
+
+void main()
+{
+    vec3 position = aPosition;
+    vec3 normal = aNormal;
+    vec2 texCoords = aTexCoords;
+    if (uPrimitive != 0xFFFFFFFFu) {
+        // Default values of disabled vertex arrays
+        position = readAttribute(0u, vec4(0, 0, 0, 1)).xyz;
+        normal = readAttribute(1u, vec4(0, 0, 0, 1)).xyz;
+        texCoords = readAttribute(2u, vec4(0, 0, 0, 1)).xy;
+    }
+
+    const DrawMatrices draw = uDraws[gl_InstanceID];
+    vViewSpacePosition = vec3(draw.modelView * vec4(position, 1));
+    vViewSpaceNormal = normalize(vec3(draw.normal * vec4(normal, 0)));
+    vTexCoords = texCoords;
+    gl_Position = draw.modelViewProj * vec4(position, 1);
+}
@@ -7,10 +7,16 @@ in vec2 vTexCoords;
 uniform vec3 uLightDirection;
 uniform vec3 uLightIntensity;
 
-uniform vec4 uBaseColorFactor;
-uniform float uMetallicFactor;
-uniform float uRoughnessFactor;
-uniform vec3 uEmissiveFactor;
+// Factors of the material drawn, see material_buffer.hpp
+layout(std140) uniform Material
+{
+  vec4 uBaseColorFactor;
+  vec3 uEmissiveFactor;
+  float uMetallicFactor;
+  float uRoughnessFactor;
+  // KHR_texture_transform, rows of a 2x3 matrix
+  vec4 uTexCoordTransform[2];
+};
 
 uniform sampler2D uBaseColorTexture;
 uniform sampler2D uMetallicRoughnessTexture;
@@ -46,13 +52,15 @@ vec4 SRGBtoLINEAR(vec4 srgbIn)
 }
 
 vec3 pbr_color() {
+	vec3 uv = vec3(vTexCoords, 1);
+	vec2 texCoords = vec2(dot(uTexCoordTransform[0].xyz, uv), dot(uTexCoordTransform[1].xyz, uv));
 	vec3 N = vViewSpaceNormal;
   	vec3 L = uLightDirection;
 	vec3 V = normalize(-vViewSpacePosition);
 	vec3 H = normalize(L + V);
 
-  	vec4 baseColorFromTexture = SRGBtoLINEAR(texture(uBaseColorTexture, vTexCoords));
-  	vec4 metallicRoughnessFromTexture = texture(uMetallicRoughnessTexture, vTexCoords);
+  	vec4 baseColorFromTexture = SRGBtoLINEAR(texture(uBaseColorTexture, texCoords));
+  	vec4 metallicRoughnessFromTexture = texture(uMetallicRoughnessTexture, texCoords);
 
   	vec4 baseColor = uBaseColorFactor * baseColorFromTexture;
   	vec3 metallic = vec3(uMetallicFactor * metallicRoughnessFromTexture.b);
@@ -90,7 +98,7 @@ vec3 pbr_color() {
 	
 	vec3 f_diffuse = (1 - F) * diffuse;
 
-	vec3 emissive = SRGBtoLINEAR(texture2D(uEmissiveTexture, vTexCoords)).rgb * uEmissiveFactor;
+	vec3 emissive = SRGBtoLINEAR(texture2D(uEmissiveTexture, texCoords)).rgb * uEmissiveFactor;
 
 	vec3 f = f_diffuse + f_specular;
 
@@ -0,0 +1,110 @@
+#include "async_program.hpp"
+#include "gl_extensions.hpp"
+
+namespace
+{
+
+// From KHR_parallel_shader_compile, same value as GL_COMPLETION_STATUS_ARB
+const GLenum kCompletionStatus = 0x91B1;
+
+bool hasParallelShaderCompile()
+{
+  static const bool supported =
+      hasGLExtension("GL_KHR_parallel_shader_compile") ||
+      hasGLExtension("GL_ARB_parallel_shader_compile");
+  return supported;
+}
+
+GLenum getShaderType(const fs::path &shaderPath)
+{
+  const auto ext = shaderPath.stem().extension().string();
+  if (ext == ".vs") {
+    return GL_VERTEX_SHADER;
+  }
+  if (ext == ".fs") {
+    return GL_FRAGMENT_SHADER;
+  }
+  if (ext == ".gs") {
+    return GL_GEOMETRY_SHADER;
+  }
+  if (ext == ".cs") {
+    return GL_COMPUTE_SHADER;
+  }
+  return 0;
+}
+
+} // namespace
+
+bool AsyncProgramBuilder::start(const std::vector<fs::path> &shaderPaths,
+    const std::string &defines, std::string *err)
+{
+  m_pProgram.reset();
+  m_Shaders.clear();
+
+  std::vector<std::string> sources;
+  for (const auto &path : shaderPaths) {
+    if (!getShaderType(path)) {
+      *err += "Unrecognized shader extension " + path.string() + "\n";
+      return false;
+    }
+    try {
+      sources.emplace_back(loadShaderSource(path, defines));
+    } catch (const std::runtime_error &e) {
+      *err += std::string(e.what()) + "\n";
+      return false;
+    }
+  }
+
+  // No status is queried here, it would wait for the driver
+  m_ShaderPaths = shaderPaths;
+  m_pProgram = std::make_unique<GLProgram>();
+  for (size_t i = 0; i < shaderPaths.size(); ++i) {
+    m_Shaders.emplace_back(getShaderType(shaderPaths[i]));
+    m_Shaders.back().setSource(sources[i]);
+    glCompileShader(m_Shaders.back().glId());
+    m_pProgram->attachShader(m_Shaders.back());
+  }
+  glLinkProgram(m_pProgram->glId());
+  return true;
+}
+
+bool AsyncProgramBuilder::isReady() const
+{
+  if (!m_pProgram) {
+    return false;
+  }
+  if (!hasParallelShaderCompile()) {
+    return true;
+  }
+  GLint completed = GL_FALSE;
+  glGetProgramiv(m_pProgram->glId(), kCompletionStatus, &completed);
+  return completed == GL_TRUE;
+}
+
+bool AsyncProgramBuilder::finish(GLProgram &program, std::string *err)
+{
+  if (!m_pProgram) {
+    return false;
+  }
+  auto builtProgram = std::move(m_pProgram);
+  const auto shaders = std::move(m_Shaders);
+  m_Shaders.clear();
+
+  bool compiled = true;
+  for (size_t i = 0; i < shaders.size(); ++i) {
+    if (!shaders[i].getCompileStatus()) {
+      *err += "Shader compilation error in " + m_ShaderPaths[i].string() +
+              ":\n" + shaders[i].getInfoLog();
+      compiled = false;
+    }
+  }
+  if (!compiled) {
+    return false;
+  }
+  if (!builtProgram->getLinkStatus()) {
+    *err += "Program link error:\n" + builtProgram->getInfoLog();
+    return false;
+  }
+  program = std::move(*builtProgram);
+  return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "shaders.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Builds a program from shader files without stalling the render loop.
+//
+// With KHR_parallel_shader_compile (or its ARB version) the driver compiles
+// and links in background: start() returns immediately and isReady() polls
+// GL_COMPLETION_STATUS_KHR. Without it, compilation happens when finish()
+// queries the results, so the stall is limited to the frame the program is
+// swapped in.
+class AsyncProgramBuilder
+{
+public:
+  // Load the sources of shaderPaths (named as expected by loadShader()) with
+  // defines (see loadShaderSource()) and submit compilation and linking.
+  // Returns false and fill err if a file cannot be read; a build in progress
+  // is abandoned.
+  bool start(const std::vector<fs::path> &shaderPaths,
+      const std::string &defines, std::string *err);
+
+  // True if a build has been started and not finished yet
+  bool building() const { return bool(m_pProgram); }
+
+  // True once the driver is done with the started build, finish() then does
+  // not block
+  bool isReady() const;
+
+  // Returns false and fill err with compiler and linker logs if the build
+  // failed, otherwise move the linked program to program
+  bool finish(GLProgram &program, std::string *err);
+
+private:
+  std::vector<fs::path> m_ShaderPaths;
+  std::vector<GLShader> m_Shaders;
+  std::unique_ptr<GLProgram> m_pProgram;
+};
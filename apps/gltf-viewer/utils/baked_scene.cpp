@@ -0,0 +1,342 @@
+#include "baked_scene.hpp"
+#include "images.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+
+const char kMagic[4] = {'G', 'V', 'B', 'S'};
+const uint32_t kVersion = 7;
+const size_t kBlobAlignment = 16;
+
+enum SectionType {
+  NodesSection = 0,
+  ChildrenSection,
+  RootNodesSection,
+  MeshesSection,
+  PrimitivesSection,
+  MaterialsSection,
+  TexturesSection,
+  BuffersSection,
+  ImagesSection,
+  LevelsSection,
+  InstanceMatricesSection,
+  SectionCount
+};
+
+// An array of records
+struct Section
+{
+  uint64_t offset;
+  uint64_t count;
+};
+
+// Bytes of a buffer or of an image level
+struct BlobRecord
+{
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct ImageRecord
+{
+  uint32_t bitsPerComponent;
+  uint32_t firstLevel; // Index in the levels section
+  uint32_t levelCount;
+  uint32_t reserved;
+};
+
+struct LevelRecord
+{
+  uint32_t width, height;
+  BlobRecord texels;
+};
+
+// Layout of a baked scene file: FileHeader, then blobs and sections at the
+// offsets given by the header, all aligned to kBlobAlignment
+struct FileHeader
+{
+  char magic[4];
+  uint32_t version;
+  glm::vec3 bboxMin, bboxMax;
+  Section sections[SectionCount];
+};
+
+class Writer
+{
+public:
+  explicit Writer(const fs::path &path) :
+      m_Output(path.string(), std::ios::binary)
+  {
+    std::memset(&m_Header, 0, sizeof(m_Header));
+    std::memcpy(m_Header.magic, kMagic, sizeof(kMagic));
+    m_Header.version = kVersion;
+    write(&m_Header, sizeof(m_Header));
+  }
+
+  bool good() const { return bool(m_Output); }
+
+  FileHeader &header() { return m_Header; }
+
+  BlobRecord writeBlob(const unsigned char *data, size_t size)
+  {
+    align();
+    const BlobRecord blob{m_nOffset, size};
+    write(data, size);
+    return blob;
+  }
+
+  template <typename T>
+  void writeSection(SectionType type, const std::vector<T> &records)
+  {
+    align();
+    m_Header.sections[type] = {m_nOffset, records.size()};
+    write(records.data(), records.size() * sizeof(T));
+  }
+
+  // Write the final header, sections offsets included
+  bool finish()
+  {
+    m_Output.seekp(0);
+    m_Output.write((const char *)&m_Header, sizeof(m_Header));
+    m_Output.close();
+    return !m_Output.fail();
+  }
+
+private:
+  void write(const void *data, size_t size)
+  {
+    m_Output.write((const char *)data, std::streamsize(size));
+    m_nOffset += size;
+  }
+
+  void align()
+  {
+    static const char zeros[kBlobAlignment] = {};
+    write(
+        zeros, (kBlobAlignment - m_nOffset % kBlobAlignment) % kBlobAlignment);
+  }
+
+  std::ofstream m_Output;
+  FileHeader m_Header;
+  uint64_t m_nOffset = 0;
+};
+
+bool isValidIndex(int32_t index, size_t count)
+{
+  return index >= -1 && (index < 0 || size_t(index) < count);
+}
+
+bool isValidRange(uint64_t first, uint64_t count, uint64_t size)
+{
+  return first <= size && count <= size - first;
+}
+
+} // namespace
+
+bool bakeScene(const fs::path &outputPath, const Scene &scene,
+    const tinygltf::Model &model, const GltfLoader &loader, std::string *err)
+{
+  Writer writer{outputPath};
+  if (!writer.good()) {
+    *err += "Unable to open " + outputPath.string() + " for writing.\n";
+    return false;
+  }
+
+  std::vector<BlobRecord> buffers;
+  for (const auto &buffer : scene.buffers) {
+    buffers.emplace_back(writer.writeBlob(buffer.data, buffer.size));
+  }
+
+  // All levels are baked, whether textures use mipmaps or not
+  std::vector<ImageRecord> images;
+  std::vector<LevelRecord> levels;
+  for (size_t imageIdx = 0; imageIdx < model.images.size(); ++imageIdx) {
+    const auto &image = model.images[imageIdx];
+    ImageRecord record{uint32_t(image.bits), uint32_t(levels.size()), 0, 0};
+    if (const auto *cached = loader.cachedImage(int(imageIdx))) {
+      for (const auto &level : cached->levels) {
+        levels.push_back({level.width, level.height,
+            writer.writeBlob(level.texels.data, level.texels.size)});
+      }
+    } else if (!image.image.empty()) {
+      computeMipmaps(uint32_t(image.width), uint32_t(image.height),
+          uint32_t(image.component), uint32_t(image.bits), image.image.data(),
+          [&](uint32_t, uint32_t width, uint32_t height,
+              const unsigned char *texels, size_t byteCount) {
+            levels.push_back(
+                {width, height, writer.writeBlob(texels, byteCount)});
+          });
+    }
+    record.levelCount = uint32_t(levels.size()) - record.firstLevel;
+    images.emplace_back(record);
+  }
+
+  writer.writeSection(NodesSection, scene.nodes);
+  writer.writeSection(ChildrenSection, scene.children);
+  writer.writeSection(RootNodesSection, scene.rootNodes);
+  writer.writeSection(MeshesSection, scene.meshes);
+  writer.writeSection(PrimitivesSection, scene.primitives);
+  writer.writeSection(MaterialsSection, scene.materials);
+  writer.writeSection(TexturesSection, scene.textures);
+  writer.writeSection(BuffersSection, buffers);
+  writer.writeSection(ImagesSection, images);
+  writer.writeSection(LevelsSection, levels);
+  writer.writeSection(InstanceMatricesSection, scene.instanceMatrices);
+  writer.header().bboxMin = scene.bboxMin;
+  writer.header().bboxMax = scene.bboxMax;
+
+  if (!writer.finish()) {
+    *err += "Unable to write " + outputPath.string() + ".\n";
+    return false;
+  }
+  return true;
+}
+
+bool BakedScene::isBakedScene(const fs::path &path)
+{
+  std::ifstream input(path.string(), std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return input.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool BakedScene::load(const fs::path &path, Scene &scene, std::string *err)
+{
+  try {
+    m_File = MappedFile{path};
+  } catch (const std::runtime_error &e) {
+    *err += std::string(e.what()) + "\n";
+    return false;
+  }
+  m_Images.clear();
+
+  const auto *bytes = m_File.data();
+  const auto size = m_File.size();
+  FileHeader header;
+  if (size < sizeof(header)) {
+    *err += "Invalid baked scene: truncated header.\n";
+    return false;
+  }
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    *err += "Invalid baked scene: unsupported version, bake it again.\n";
+    return false;
+  }
+
+  // Records are copied out of the mapping, they are small compared to blobs
+  bool valid = true;
+  const auto readSection = [&](SectionType type, auto &records) {
+    using Record = typename std::decay_t<decltype(records)>::value_type;
+    const auto &section = header.sections[type];
+    if (section.count > size / sizeof(Record) ||
+        !isValidRange(section.offset, section.count * sizeof(Record), size)) {
+      valid = false;
+      return;
+    }
+    records.resize(section.count);
+    if (section.count > 0) {
+      std::memcpy(records.data(), bytes + section.offset,
+          section.count * sizeof(Record));
+    }
+  };
+  std::vector<BlobRecord> buffers;
+  std::vector<ImageRecord> images;
+  std::vector<LevelRecord> levels;
+  readSection(NodesSection, scene.nodes);
+  readSection(ChildrenSection, scene.children);
+  readSection(RootNodesSection, scene.rootNodes);
+  readSection(MeshesSection, scene.meshes);
+  readSection(PrimitivesSection, scene.primitives);
+  readSection(MaterialsSection, scene.materials);
+  readSection(TexturesSection, scene.textures);
+  readSection(BuffersSection, buffers);
+  readSection(ImagesSection, images);
+  readSection(LevelsSection, levels);
+  readSection(InstanceMatricesSection, scene.instanceMatrices);
+  if (!valid) {
+    *err += "Invalid baked scene: truncated section.\n";
+    return false;
+  }
+  scene.bboxMin = header.bboxMin;
+  scene.bboxMax = header.bboxMax;
+
+  // Check indices so that a corrupted file cannot make the viewer read out of
+  // bounds
+  for (const auto &node : scene.nodes) {
+    valid = valid && isValidIndex(node.mesh, scene.meshes.size()) &&
+            isValidRange(
+                node.firstChild, node.childCount, scene.children.size()) &&
+            isValidRange(node.firstInstance, node.instanceCount,
+                scene.instanceMatrices.size());
+  }
+  for (const auto nodeIdx : scene.children) {
+    valid = valid && nodeIdx < scene.nodes.size();
+  }
+  for (const auto nodeIdx : scene.rootNodes) {
+    valid = valid && nodeIdx < scene.nodes.size();
+  }
+  for (const auto &mesh : scene.meshes) {
+    valid = valid && isValidRange(mesh.firstPrimitive, mesh.primitiveCount,
+                         scene.primitives.size());
+  }
+  for (const auto &primitive : scene.primitives) {
+    valid = valid && isValidIndex(primitive.indexBuffer, buffers.size()) &&
+            isValidIndex(primitive.material, scene.materials.size());
+    for (const auto &attrib : primitive.attributes) {
+      valid = valid && isValidIndex(attrib.buffer, buffers.size());
+    }
+  }
+  for (const auto &material : scene.materials) {
+    for (const auto textureIdx :
+        {material.baseColorTexture, material.metallicRoughnessTexture,
+            material.emissiveTexture, material.normalTexture,
+            material.occlusionTexture}) {
+      valid = valid && isValidIndex(textureIdx, scene.textures.size());
+    }
+  }
+  for (const auto &texture : scene.textures) {
+    valid = valid && isValidIndex(texture.image, images.size());
+  }
+  for (const auto &image : images) {
+    valid = valid &&
+            isValidRange(image.firstLevel, image.levelCount, levels.size()) &&
+            (image.bitsPerComponent == 8 || image.bitsPerComponent == 16);
+    for (uint32_t levelIdx = image.firstLevel;
+         valid && levelIdx < image.firstLevel + image.levelCount; ++levelIdx) {
+      const auto &level = levels[levelIdx];
+      valid = isValidRange(level.texels.offset, level.texels.size, size) &&
+              level.texels.size >= uint64_t(level.width) * level.height * 4 *
+                                       (image.bitsPerComponent / 8);
+    }
+  }
+  for (const auto &buffer : buffers) {
+    valid = valid && isValidRange(buffer.offset, buffer.size, size);
+  }
+  if (!valid) {
+    *err += "Invalid baked scene: index out of range.\n";
+    return false;
+  }
+
+  scene.buffers.clear();
+  for (const auto &buffer : buffers) {
+    scene.buffers.push_back({bytes + buffer.offset, size_t(buffer.size)});
+  }
+  for (const auto &image : images) {
+    Image result;
+    result.bitsPerComponent = image.bitsPerComponent;
+    for (uint32_t levelIdx = image.firstLevel;
+         levelIdx < image.firstLevel + image.levelCount; ++levelIdx) {
+      const auto &level = levels[levelIdx];
+      result.levels.push_back({level.width, level.height,
+          {bytes + level.texels.offset, size_t(level.texels.size)}});
+    }
+    m_Images.emplace_back(std::move(result));
+  }
+  return true;
+}
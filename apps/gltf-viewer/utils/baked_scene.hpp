@@ -0,0 +1,55 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "gltf.hpp"
+#include "gltf_loader.hpp"
+#include "mapped_file.hpp"
+#include "scene.hpp"
+
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+// Baked scene files hold a Scene and its decoded images with all their mipmap
+// levels in a single flat file.
+//
+// Loading one involves neither JSON parsing nor image decoding: the file is
+// memory mapped, the small records of the Scene are copied from the mapping
+// and vertex data and texels are uploaded directly from it.
+
+// Write scene, built from model, and the images of model to outputPath.
+// Images must have been decoded by loader (or found in its texture cache).
+bool bakeScene(const fs::path &outputPath, const Scene &scene,
+    const tinygltf::Model &model, const GltfLoader &loader, std::string *err);
+
+class BakedScene
+{
+public:
+  struct Image
+  {
+    uint32_t bitsPerComponent = 8; // Images are RGBA
+    std::vector<ImageLevel> levels; // Empty if the image failed to decode
+  };
+
+  // True if the file at path starts like a baked scene file
+  static bool isBakedScene(const fs::path &path);
+
+  // Map the file and fill scene, whose buffers point to the mapping. Returns
+  // false and fill err if the file is invalid.
+  bool load(const fs::path &path, Scene &scene, std::string *err);
+
+  // Indexed like Scene::Texture::image, levels point to the mapping
+  const std::vector<Image> &images() const { return m_Images; }
+
+  // Unmap the file once the scene has been uploaded, spans of the loaded
+  // Scene and images() become invalid
+  void release()
+  {
+    m_File = MappedFile{};
+    m_Images.clear();
+  }
+
+private:
+  MappedFile m_File;
+  std::vector<Image> m_Images;
+};
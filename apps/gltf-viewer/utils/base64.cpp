@@ -0,0 +1,254 @@
+#include "base64.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define GLTF_VIEWER_BASE64_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+const unsigned char kInvalid = 0xff; // Has bits above the 6 value bits
+
+struct DecodingTable
+{
+  unsigned char values[256];
+
+  DecodingTable()
+  {
+    std::memset(values, kInvalid, sizeof(values));
+    const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (unsigned char i = 0; i < 64; ++i) {
+      values[(unsigned char)alphabet[i]] = i;
+    }
+  }
+};
+
+const DecodingTable kDecodingTable;
+
+size_t stripPadding(const char *text, size_t length)
+{
+  for (size_t i = 0; i < 2 && length > 0 && text[length - 1] == '='; ++i) {
+    --length;
+  }
+  return length;
+}
+
+// Decode length characters without padding
+bool decodeScalar(const char *text, size_t length, unsigned char *output)
+{
+  const auto *values = kDecodingTable.values;
+  uint32_t invalid = 0;
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4, output += 3) {
+    const uint32_t a = values[(unsigned char)text[i]];
+    const uint32_t b = values[(unsigned char)text[i + 1]];
+    const uint32_t c = values[(unsigned char)text[i + 2]];
+    const uint32_t d = values[(unsigned char)text[i + 3]];
+    invalid |= a | b | c | d;
+    const uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+    output[0] = (unsigned char)(triple >> 16);
+    output[1] = (unsigned char)(triple >> 8);
+    output[2] = (unsigned char)triple;
+  }
+  // 2 or 3 characters left encode 1 or 2 bytes
+  if (i + 1 < length) {
+    const uint32_t a = values[(unsigned char)text[i]];
+    const uint32_t b = values[(unsigned char)text[i + 1]];
+    const uint32_t c =
+        i + 2 < length ? values[(unsigned char)text[i + 2]] : 0;
+    invalid |= a | b | c;
+    const uint32_t triple = (a << 18) | (b << 12) | (c << 6);
+    output[0] = (unsigned char)(triple >> 16);
+    if (i + 2 < length) {
+      output[1] = (unsigned char)(triple >> 8);
+    }
+  }
+  return (invalid & 0xc0) == 0;
+}
+
+#ifdef GLTF_VIEWER_BASE64_SIMD
+
+// Vectorized decoding as described by Wojciech Mula and Daniel Lemire in
+// "Faster Base64 Encoding and Decoding Using AVX2 Instructions": characters
+// are validated and translated to 6-bit values with nibble indexed lookups,
+// then packed by multiply-adds and a shuffle.
+
+// Decode blocks of 16 characters as long as 16 bytes can be written to
+// output, outputSize being the size of the whole output. Returns the number of
+// characters decoded, or size_t(-1) if one is invalid.
+__attribute__((target("sse4.1"))) size_t decodeSse(
+    const char *text, size_t length, unsigned char *output, size_t outputSize)
+{
+  const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+      0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i mergeFactors = _mm_set1_epi32(0x01400140);
+  const __m128i packFactors = _mm_set1_epi32(0x00011000);
+  const __m128i packShuffle =
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  size_t i = 0, o = 0;
+  for (; i + 16 <= length && o + 16 <= outputSize; i += 16, o += 12) {
+    const __m128i in = _mm_loadu_si128((const __m128i *)(text + i));
+    const __m128i hiNibbles =
+        _mm_and_si128(_mm_srli_epi32(in, 4), nibbleMask);
+    const __m128i loNibbles = _mm_and_si128(in, nibbleMask);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    if (!_mm_testz_si128(lo, hi)) {
+      return size_t(-1);
+    }
+    const __m128i roll = _mm_shuffle_epi8(
+        lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(in, slash), hiNibbles));
+    const __m128i values = _mm_add_epi8(in, roll);
+    const __m128i merged = _mm_maddubs_epi16(values, mergeFactors);
+    const __m128i packed = _mm_madd_epi16(merged, packFactors);
+    _mm_storeu_si128((__m128i *)(output + o),
+        _mm_shuffle_epi8(packed, packShuffle));
+  }
+  return i;
+}
+
+// Same as decodeSse() with blocks of 32 characters
+__attribute__((target("avx2"))) size_t decodeAvx2(
+    const char *text, size_t length, unsigned char *output, size_t outputSize)
+{
+  const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a, 0x15, 0x11,
+      0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b,
+      0x1b, 0x1a);
+  const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+      0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10);
+  const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0, 0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0,
+      0, 0, 0);
+  const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+  const __m256i slash = _mm256_set1_epi8('/');
+  const __m256i mergeFactors = _mm256_set1_epi32(0x01400140);
+  const __m256i packFactors = _mm256_set1_epi32(0x00011000);
+  const __m256i packShuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+      14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1,
+      -1, -1, -1);
+  // Moves the 12 bytes of the high lane right after those of the low lane
+  const __m256i lanePermutation = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+  size_t i = 0, o = 0;
+  for (; i + 32 <= length && o + 32 <= outputSize; i += 32, o += 24) {
+    const __m256i in = _mm256_loadu_si256((const __m256i *)(text + i));
+    const __m256i hiNibbles =
+        _mm256_and_si256(_mm256_srli_epi32(in, 4), nibbleMask);
+    const __m256i loNibbles = _mm256_and_si256(in, nibbleMask);
+    const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      return size_t(-1);
+    }
+    const __m256i roll = _mm256_shuffle_epi8(
+        lutRoll, _mm256_add_epi8(_mm256_cmpeq_epi8(in, slash), hiNibbles));
+    const __m256i values = _mm256_add_epi8(in, roll);
+    const __m256i merged = _mm256_maddubs_epi16(values, mergeFactors);
+    const __m256i packed = _mm256_madd_epi16(merged, packFactors);
+    const __m256i shuffled = _mm256_shuffle_epi8(packed, packShuffle);
+    _mm256_storeu_si256((__m256i *)(output + o),
+        _mm256_permutevar8x32_epi32(shuffled, lanePermutation));
+  }
+  return i;
+}
+
+enum SimdLevel { SimdNone, SimdSse, SimdAvx2 };
+
+SimdLevel getSimdLevel()
+{
+  static const SimdLevel level = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return SimdAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+      return SimdSse;
+    }
+    return SimdNone;
+  }();
+  return level;
+}
+
+#endif
+
+} // namespace
+
+bool getBase64DecodedSize(const char *text, size_t length, size_t *size)
+{
+  length = stripPadding(text, length);
+  if (length % 4 == 1) {
+    return false;
+  }
+  *size = length / 4 * 3 + (length % 4 == 0 ? 0 : length % 4 - 1);
+  return true;
+}
+
+bool decodeBase64(const char *text, size_t length, unsigned char *output)
+{
+  length = stripPadding(text, length);
+  size_t outputSize;
+  if (!getBase64DecodedSize(text, length, &outputSize)) {
+    return false;
+  }
+#ifdef GLTF_VIEWER_BASE64_SIMD
+  size_t decoded = 0;
+  switch (getSimdLevel()) {
+  case SimdAvx2:
+    decoded = decodeAvx2(text, length, output, outputSize);
+    break;
+  case SimdSse:
+    decoded = decodeSse(text, length, output, outputSize);
+    break;
+  case SimdNone:
+    break;
+  }
+  if (decoded == size_t(-1)) {
+    return false;
+  }
+  // Whole blocks of 4 characters have been decoded
+  text += decoded;
+  length -= decoded;
+  output += decoded / 4 * 3;
+#endif
+  return decodeScalar(text, length, output);
+}
+
+bool decodeBase64Scalar(const char *text, size_t length, unsigned char *output)
+{
+  length = stripPadding(text, length);
+  return length % 4 != 1 && decodeScalar(text, length, output);
+}
+
+bool parseBase64DataUri(
+    const std::string &uri, size_t *textOffset, std::string *mediaType)
+{
+  static const std::string scheme = "data:";
+  static const std::string encoding = ";base64";
+  if (uri.compare(0, scheme.size(), scheme) != 0) {
+    return false;
+  }
+  const auto comma = uri.find(',', scheme.size());
+  if (comma == std::string::npos || comma < scheme.size() + encoding.size() ||
+      uri.compare(comma - encoding.size(), encoding.size(), encoding) != 0) {
+    return false;
+  }
+  const auto mediaTypeEnd = uri.find(';', scheme.size());
+  *mediaType = uri.substr(scheme.size(), mediaTypeEnd - scheme.size());
+  *textOffset = comma + 1;
+  return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Base64 decoding of data URIs.
+//
+// On x86-64 blocks of 32 (AVX2) or 16 (SSE4.1) characters are decoded with
+// SIMD instructions, selected at runtime according to the CPU. Other platforms
+// and the last characters use a scalar decoder. Characters outside of the
+// base64 alphabet, whitespace included, are rejected.
+
+// Size of the bytes encoded by text, whose trailing '=' padding is optional.
+// Returns false if length cannot be the length of base64 text.
+bool getBase64DecodedSize(const char *text, size_t length, size_t *size);
+
+// Decode text to output, which must hold getBase64DecodedSize() bytes. Returns
+// false if text contains invalid characters.
+bool decodeBase64(const char *text, size_t length, unsigned char *output);
+
+// Same as decodeBase64(), without SIMD (for benchmarks)
+bool decodeBase64Scalar(const char *text, size_t length, unsigned char *output);
+
+// Offset of the base64 text of uri and its media type, if uri is a base64 data
+// URI ("data:[<media type>][;<parameter>];base64,<text>")
+bool parseBase64DataUri(
+    const std::string &uri, size_t *textOffset, std::string *mediaType);
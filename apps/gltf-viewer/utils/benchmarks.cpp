@@ -0,0 +1,589 @@
+#include "benchmarks.hpp"
+#include "base64.hpp"
+#include "gltf_loader.hpp"
+#include "gpu_buffers.hpp"
+#include "scene.hpp"
+#include "shaders.hpp"
+#include "vertex_arrays.hpp"
+#include "vertex_layout.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+namespace
+{
+
+// Best wall-clock time of iterationCount calls to f, in seconds
+template <typename Function>
+double measure(uint32_t iterationCount, Function &&f)
+{
+  auto best = std::numeric_limits<double>::max();
+  for (uint32_t i = 0; i < std::max(iterationCount, 1u); ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> duration =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, duration.count());
+  }
+  return best;
+}
+
+std::string encodeBase64(const std::vector<unsigned char> &bytes)
+{
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string text;
+  text.reserve((bytes.size() + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 3 <= bytes.size(); i += 3) {
+    const uint32_t triple =
+        (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+    text += alphabet[triple >> 18];
+    text += alphabet[(triple >> 12) & 63];
+    text += alphabet[(triple >> 6) & 63];
+    text += alphabet[triple & 63];
+  }
+  if (i < bytes.size()) {
+    const uint32_t triple =
+        (bytes[i] << 16) | (i + 1 < bytes.size() ? bytes[i + 1] << 8 : 0);
+    text += alphabet[triple >> 18];
+    text += alphabet[(triple >> 12) & 63];
+    text += i + 1 < bytes.size() ? alphabet[(triple >> 6) & 63] : '=';
+    text += '=';
+  }
+  return text;
+}
+
+void printResult(const char *name, double seconds, size_t byteCount)
+{
+  std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << seconds * 1000.
+            << " ms" << std::setw(10) << byteCount / seconds * 1e-9 << " GB/s"
+            << std::endl;
+}
+
+void printDrawResult(const char *name, double seconds, size_t drawCount)
+{
+  std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(10) << seconds * 1000.
+            << " ms" << std::setw(10) << drawCount / seconds * 1e-6
+            << " M draws/s" << std::endl;
+}
+
+// Does not decode, so that only parsing is measured
+bool skipImage(tinygltf::Image *, const int, std::string *, std::string *, int,
+    int, const unsigned char *, int, void *)
+{
+  return true;
+}
+
+// Reads every attribute, so that none is optimized out
+const char *const kVertexLayoutVertexShader = R"(#version 330
+layout(location = 0) in vec3 aPosition;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+out vec3 vColor;
+void main()
+{
+  vColor = 0.5 * aNormal + vec3(aTexCoords, 0.5);
+  gl_Position = vec4(aPosition, 1);
+}
+)";
+
+const char *const kVertexLayoutFragmentShader = R"(#version 330
+in vec3 vColor;
+out vec4 fColor;
+void main()
+{
+  fColor = vec4(vColor, 1);
+}
+)";
+
+// For forward_pulling.vs.glsl, reads every output
+const char *const kVertexPullingFragmentShader = R"(#version 330
+in vec3 vViewSpacePosition;
+in vec3 vViewSpaceNormal;
+in vec2 vTexCoords;
+out vec4 fColor;
+void main()
+{
+  fColor = vec4(vViewSpacePosition + vViewSpaceNormal, vTexCoords.x);
+}
+)";
+
+// Bytes of vertex attributes fetched to draw all the primitives of scene
+uint64_t getVertexByteCount(const Scene &scene)
+{
+  uint64_t byteCount = 0;
+  for (const auto &primitive : scene.primitives) {
+    for (const auto &attrib : primitive.attributes) {
+      if (attrib.buffer >= 0) {
+        byteCount += uint64_t(primitive.vertexCount) * attrib.size *
+                     tinygltf::GetComponentSizeInBytes(attrib.componentType);
+      }
+    }
+  }
+  return byteCount;
+}
+
+// Grid of vertexCount vertices (rounded down to a square) covering the
+// viewport, with non-interleaved float attributes and 32-bit indices
+Scene makeGridScene(size_t vertexCount, std::vector<unsigned char> &buffer)
+{
+  const auto side =
+      std::max(uint32_t(std::sqrt(double(vertexCount))), uint32_t(2));
+  vertexCount = size_t(side) * side;
+  const size_t indexCount = size_t(side - 1) * (side - 1) * 6;
+  const size_t positionsOffset = 0, normalsOffset = vertexCount * 12,
+               texCoordsOffset = vertexCount * 24,
+               indicesOffset = vertexCount * 32;
+  buffer.assign(indicesOffset + indexCount * 4, 0);
+  auto *positions = (float *)(buffer.data() + positionsOffset);
+  auto *normals = (float *)(buffer.data() + normalsOffset);
+  auto *texCoords = (float *)(buffer.data() + texCoordsOffset);
+  auto *indices = (uint32_t *)(buffer.data() + indicesOffset);
+  for (uint32_t y = 0; y < side; ++y) {
+    for (uint32_t x = 0; x < side; ++x) {
+      const auto u = float(x) / (side - 1), v = float(y) / (side - 1);
+      *positions++ = 2.f * u - 1.f;
+      *positions++ = 2.f * v - 1.f;
+      *positions++ = 0.f;
+      *normals++ = u - 0.5f;
+      *normals++ = v - 0.5f;
+      *normals++ = 1.f;
+      *texCoords++ = u;
+      *texCoords++ = v;
+    }
+  }
+  for (uint32_t y = 0; y + 1 < side; ++y) {
+    for (uint32_t x = 0; x + 1 < side; ++x) {
+      const auto i = y * side + x;
+      for (const auto index : {i, i + 1, i + side, i + side, i + 1,
+               i + side + 1}) {
+        *indices++ = index;
+      }
+    }
+  }
+
+  Scene scene;
+  scene.buffers.push_back({buffer.data(), buffer.size()});
+  Scene::Primitive primitive;
+  const size_t offsets[] = {positionsOffset, normalsOffset, texCoordsOffset};
+  const int32_t sizes[] = {3, 3, 2};
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    auto &attrib = primitive.attributes[attribIdx];
+    attrib.buffer = 0;
+    attrib.size = sizes[attribIdx];
+    attrib.componentType = GL_FLOAT;
+    attrib.byteOffset = offsets[attribIdx];
+  }
+  primitive.indexBuffer = 0;
+  primitive.indexType = GL_UNSIGNED_INT;
+  primitive.indexByteOffset = indicesOffset;
+  primitive.count = uint32_t(indexCount);
+  primitive.vertexCount = uint32_t(vertexCount);
+  scene.primitives.push_back(primitive);
+  return scene;
+}
+
+// primitiveCount grids of side x side vertices covering the viewport, each
+// with its own non-interleaved float attributes, sharing 16-bit indices
+Scene makeGridsScene(uint32_t primitiveCount, uint32_t side,
+    std::vector<unsigned char> &buffer)
+{
+  const size_t vertexCount = size_t(side) * side;
+  const size_t indexCount = size_t(side - 1) * (side - 1) * 6;
+  const size_t allVertexCount = vertexCount * primitiveCount;
+  const size_t positionsOffset = 0, normalsOffset = allVertexCount * 12,
+               texCoordsOffset = allVertexCount * 24,
+               indicesOffset = allVertexCount * 32;
+  buffer.assign(indicesOffset + indexCount * 2, 0);
+  auto *positions = (float *)(buffer.data() + positionsOffset);
+  auto *normals = (float *)(buffer.data() + normalsOffset);
+  auto *texCoords = (float *)(buffer.data() + texCoordsOffset);
+  auto *indices = (uint16_t *)(buffer.data() + indicesOffset);
+  for (uint32_t primIdx = 0; primIdx < primitiveCount; ++primIdx) {
+    for (uint32_t y = 0; y < side; ++y) {
+      for (uint32_t x = 0; x < side; ++x) {
+        const auto u = float(x) / (side - 1), v = float(y) / (side - 1);
+        *positions++ = 2.f * u - 1.f;
+        *positions++ = 2.f * v - 1.f;
+        *positions++ = 0.f;
+        *normals++ = u - 0.5f;
+        *normals++ = v - 0.5f;
+        *normals++ = 1.f;
+        *texCoords++ = u;
+        *texCoords++ = v;
+      }
+    }
+  }
+  for (uint32_t y = 0; y + 1 < side; ++y) {
+    for (uint32_t x = 0; x + 1 < side; ++x) {
+      const auto i = y * side + x;
+      for (const auto index : {i, i + 1, i + side, i + side, i + 1,
+               i + side + 1}) {
+        *indices++ = uint16_t(index);
+      }
+    }
+  }
+
+  Scene scene;
+  scene.buffers.push_back({buffer.data(), buffer.size()});
+  const size_t offsets[] = {positionsOffset, normalsOffset, texCoordsOffset};
+  const int32_t sizes[] = {3, 3, 2};
+  for (uint32_t primIdx = 0; primIdx < primitiveCount; ++primIdx) {
+    Scene::Primitive primitive;
+    for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+      auto &attrib = primitive.attributes[attribIdx];
+      attrib.buffer = 0;
+      attrib.size = sizes[attribIdx];
+      attrib.componentType = GL_FLOAT;
+      attrib.byteOffset = offsets[attribIdx] +
+                          size_t(primIdx) * vertexCount * 4 * attrib.size;
+    }
+    primitive.indexBuffer = 0;
+    primitive.indexType = GL_UNSIGNED_SHORT;
+    primitive.indexByteOffset = indicesOffset;
+    primitive.count = uint32_t(indexCount);
+    primitive.vertexCount = uint32_t(vertexCount);
+    scene.primitives.push_back(primitive);
+  }
+  return scene;
+}
+
+// Draw all the primitives of scene with a vertex array object each, shared
+// vertex array objects and vertex pulling
+bool runVertexPullingCases(const Scene &scene, uint32_t iterationCount)
+{
+  const auto draw = [&](size_t primIdx, uint64_t indexByteOffset) {
+    const auto &primitive = scene.primitives[primIdx];
+    if (primitive.indexBuffer >= 0) {
+      glDrawElementsBaseVertex(primitive.mode, GLsizei(primitive.count),
+          primitive.indexType, (const GLvoid *)indexByteOffset,
+          primitive.baseVertex);
+    } else {
+      glDrawArrays(primitive.mode, 0, GLsizei(primitive.count));
+    }
+  };
+  const auto checkError = [](const char *name) {
+    const auto error = glGetError();
+    if (error != GL_NO_ERROR) {
+      std::cerr << "Error: OpenGL error " << error << " drawing with " << name
+                << std::endl;
+      return false;
+    }
+    return true;
+  };
+
+  GpuBuffers gpuBuffers;
+  gpuBuffers.upload(scene, std::min(kDefaultGpuBufferSize,
+                               VertexArrays::getMaxVertexDataSize()));
+  const auto drawCount = scene.primitives.size();
+
+  glUniform1ui(VertexArrays::kPrimitiveUniformLocation,
+      VertexArrays::kNoPrimitive);
+  std::vector<GLuint> vertexArrayObjects(drawCount, 0);
+  std::vector<uint64_t> indexByteOffsets(drawCount, 0);
+  glGenVertexArrays(
+      GLsizei(vertexArrayObjects.size()), vertexArrayObjects.data());
+  for (size_t primIdx = 0; primIdx < drawCount; ++primIdx) {
+    glBindVertexArray(vertexArrayObjects[primIdx]);
+    indexByteOffsets[primIdx] =
+        setupVertexArrayObject(scene.primitives[primIdx], gpuBuffers);
+  }
+  const auto ownSeconds = measure(iterationCount, [&]() {
+    for (size_t primIdx = 0; primIdx < drawCount; ++primIdx) {
+      glBindVertexArray(vertexArrayObjects[primIdx]);
+      draw(primIdx, indexByteOffsets[primIdx]);
+    }
+    glFinish();
+  });
+  glBindVertexArray(0);
+  glDeleteVertexArrays(
+      GLsizei(vertexArrayObjects.size()), vertexArrayObjects.data());
+  if (!checkError("a vertex array object per primitive")) {
+    return false;
+  }
+  printDrawResult("vertex array each", ownSeconds, drawCount);
+
+  VertexArrays vertexArrays;
+  for (const bool pullVertices : {false, true}) {
+    vertexArrays.create(scene, gpuBuffers, pullVertices);
+    const auto seconds = measure(iterationCount, [&]() {
+      for (size_t primIdx = 0; primIdx < drawCount; ++primIdx) {
+        draw(primIdx, vertexArrays.bind(primIdx));
+      }
+      vertexArrays.unbind();
+      glFinish();
+    });
+    const auto name = pullVertices ? "vertex pulling" : "shared vertex arrays";
+    if (!checkError(name)) {
+      return false;
+    }
+    printDrawResult(name, seconds, drawCount);
+  }
+  return true;
+}
+
+// Repack the vertices of sourceScene with each layout, then draw all its
+// primitives with them
+bool runVertexLayoutCases(const Scene &sourceScene, uint32_t iterationCount,
+    ThreadPool &threadPool)
+{
+  const auto byteCount = size_t(getVertexByteCount(sourceScene));
+  for (int layoutIdx = 0; layoutIdx < VertexLayoutCount; ++layoutIdx) {
+    const auto layout = VertexLayout(layoutIdx);
+    const std::string name = getVertexLayoutName(layout);
+    Scene scene;
+    std::vector<unsigned char> storage;
+    const auto repackSeconds = measure(iterationCount, [&]() {
+      scene = sourceScene;
+      applyVertexLayout(scene, layout, storage, &threadPool);
+    });
+    if (layout != VertexLayoutSource) {
+      printResult((name + " repack").c_str(), repackSeconds, byteCount);
+    }
+
+    GpuBuffers gpuBuffers;
+    gpuBuffers.upload(scene);
+    std::vector<GLuint> vertexArrayObjects(scene.primitives.size(), 0);
+    std::vector<uint64_t> indexByteOffsets(scene.primitives.size(), 0);
+    glGenVertexArrays(
+        GLsizei(vertexArrayObjects.size()), vertexArrayObjects.data());
+    for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+      glBindVertexArray(vertexArrayObjects[primIdx]);
+      indexByteOffsets[primIdx] =
+          setupVertexArrayObject(scene.primitives[primIdx], gpuBuffers);
+    }
+    const auto drawSeconds = measure(iterationCount, [&]() {
+      for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+        const auto &primitive = scene.primitives[primIdx];
+        glBindVertexArray(vertexArrayObjects[primIdx]);
+        if (primitive.indexBuffer >= 0) {
+          glDrawElementsBaseVertex(primitive.mode, GLsizei(primitive.count),
+              primitive.indexType, (const GLvoid *)indexByteOffsets[primIdx],
+              primitive.baseVertex);
+        } else {
+          glDrawArrays(primitive.mode, 0, GLsizei(primitive.count));
+        }
+      }
+      glFinish();
+    });
+    glBindVertexArray(0);
+    glDeleteVertexArrays(
+        GLsizei(vertexArrayObjects.size()), vertexArrayObjects.data());
+    const auto error = glGetError();
+    if (error != GL_NO_ERROR) {
+      std::cerr << "Error: OpenGL error " << error << " drawing with layout "
+                << name << std::endl;
+      return false;
+    }
+    printResult((name + " draw").c_str(), drawSeconds, byteCount);
+  }
+  return true;
+}
+
+} // namespace
+
+bool runBase64Benchmark(
+    size_t byteCount, uint32_t iterationCount, const fs::path &gltfFile)
+{
+  std::vector<unsigned char> bytes(byteCount);
+  std::mt19937 generator;
+  std::generate(begin(bytes), end(bytes), [&]() {
+    return (unsigned char)generator();
+  });
+  const std::string header = "data:application/octet-stream;base64,";
+  const auto uri = header + encodeBase64(bytes);
+  const auto *text = uri.data() + header.size();
+  const auto textSize = uri.size() - header.size();
+
+  std::cout << "Decoding " << byteCount << " bytes (" << textSize
+            << " base64 characters), throughput of decoded bytes:"
+            << std::endl;
+  bool valid = true;
+  std::vector<unsigned char> decoded;
+  printResult("tinygltf", measure(iterationCount, [&]() {
+    std::string mimeType;
+    std::vector<unsigned char>().swap(decoded);
+    valid = tinygltf::DecodeDataURI(&decoded, mimeType, uri, byteCount, true) &&
+            valid;
+  }),
+      byteCount);
+  valid = valid && decoded == bytes;
+  printResult("scalar", measure(iterationCount, [&]() {
+    std::vector<unsigned char>(byteCount).swap(decoded);
+    valid = decodeBase64Scalar(text, textSize, decoded.data()) && valid;
+  }),
+      byteCount);
+  valid = valid && decoded == bytes;
+  printResult("SIMD", measure(iterationCount, [&]() {
+    std::vector<unsigned char>(byteCount).swap(decoded);
+    valid = decodeBase64(text, textSize, decoded.data()) && valid;
+  }),
+      byteCount);
+  valid = valid && decoded == bytes;
+  if (!valid) {
+    std::cerr << "Error: decoded bytes differ" << std::endl;
+    return false;
+  }
+
+  if (gltfFile.empty()) {
+    return true;
+  }
+  const auto fileSize = size_t(fs::file_size(gltfFile));
+  std::cout << "Loading " << gltfFile.string() << " (" << fileSize
+            << " bytes), images not decoded:" << std::endl;
+  std::string error, warning;
+  bool loaded = true;
+  printResult("tinygltf", measure(iterationCount, [&]() {
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(&skipImage, nullptr);
+    tinygltf::Model model;
+    loaded = (gltfFile.extension() == ".glb"
+                     ? loader.LoadBinaryFromFile(
+                           &model, &error, &warning, gltfFile.string())
+                     : loader.LoadASCIIFromFile(
+                           &model, &error, &warning, gltfFile.string())) &&
+             loaded;
+  }),
+      fileSize);
+  ThreadPool threadPool;
+  printResult("GltfLoader", measure(iterationCount, [&]() {
+    GltfLoader loader{&threadPool};
+    loader.setDeferImageDecoding(true);
+    tinygltf::Model model;
+    loaded = loader.load(gltfFile, model, &error, &warning) && loaded;
+  }),
+      fileSize);
+  if (!loaded) {
+    std::cerr << "Error: " << error << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool runVertexLayoutBenchmark(
+    size_t byteCount, uint32_t iterationCount, const fs::path &gltfFile)
+{
+  GLProgram program;
+  program.attachShader(
+      compileShader(GL_VERTEX_SHADER, kVertexLayoutVertexShader));
+  program.attachShader(
+      compileShader(GL_FRAGMENT_SHADER, kVertexLayoutFragmentShader));
+  if (!program.link()) {
+    std::cerr << "Error: " << program.getInfoLog() << std::endl;
+    return false;
+  }
+  program.use();
+  // Triangles cover few or no pixels: the frame is bound by vertex fetching
+  // and shading
+  glViewport(0, 0, 1, 1);
+  glDisable(GL_DEPTH_TEST);
+
+  ThreadPool threadPool;
+  std::vector<unsigned char> gridBuffer;
+  const auto gridScene = makeGridScene(byteCount / 32, gridBuffer);
+  std::cout << "Drawing a grid of " << gridScene.primitives[0].vertexCount
+            << " vertices, throughput of vertex bytes:" << std::endl;
+  if (!runVertexLayoutCases(gridScene, iterationCount, threadPool)) {
+    return false;
+  }
+
+  if (gltfFile.empty()) {
+    return true;
+  }
+  GltfLoader loader{&threadPool};
+  loader.setDeferImageDecoding(true);
+  tinygltf::Model model;
+  std::string error, warning;
+  if (!loader.load(gltfFile, model, &error, &warning)) {
+    std::cerr << "Error: " << error << std::endl;
+    return false;
+  }
+  const auto scene = extractScene(model, loader.bufferSpans());
+  std::cout << "Drawing the " << scene.primitives.size() << " primitives of "
+            << gltfFile.string() << ", throughput of vertex bytes:"
+            << std::endl;
+  return runVertexLayoutCases(scene, iterationCount, threadPool);
+}
+
+bool runVertexPullingBenchmark(uint32_t primitiveCount,
+    uint32_t iterationCount, const fs::path &gltfFile,
+    const fs::path &vertexShaderPath)
+{
+  if (!VertexArrays::supportsVertexPulling()) {
+    std::cerr << "Error: vertex pulling needs OpenGL 4.3 with shader storage "
+                 "blocks in vertex shaders"
+              << std::endl;
+    return false;
+  }
+  GLProgram program;
+  program.attachShader(
+      loadShader(vertexShaderPath, VertexArrays::getShaderDefines()));
+  program.attachShader(
+      compileShader(GL_FRAGMENT_SHADER, kVertexPullingFragmentShader));
+  if (!program.link()) {
+    std::cerr << "Error: " << program.getInfoLog() << std::endl;
+    return false;
+  }
+  program.use();
+  // Identity matrices for the first instance of the DrawUniforms block, the
+  // whole block must be backed by the buffer
+  const GLuint blockIndex =
+      glGetUniformBlockIndex(program.glId(), "DrawUniforms");
+  GLint blockSize = 0;
+  glGetActiveUniformBlockiv(
+      program.glId(), blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+  const glm::mat4 identities[3] = {glm::mat4{1}, glm::mat4{1}, glm::mat4{1}};
+  std::vector<unsigned char> blockData(
+      std::max(size_t(blockSize), sizeof(identities)), 0);
+  std::memcpy(blockData.data(), identities, sizeof(identities));
+  GLuint drawUniforms = 0;
+  glGenBuffers(1, &drawUniforms);
+  glBindBuffer(GL_UNIFORM_BUFFER, drawUniforms);
+  glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(blockData.size()),
+      blockData.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glUniformBlockBinding(program.glId(), blockIndex, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, 0, drawUniforms);
+  glViewport(0, 0, 1, 1);
+  glDisable(GL_DEPTH_TEST);
+
+  std::vector<unsigned char> gridsBuffer;
+  const uint32_t side = 8;
+  const auto gridsScene =
+      makeGridsScene(std::max(primitiveCount, 1u), side, gridsBuffer);
+  std::cout << "Drawing " << gridsScene.primitives.size() << " grids of "
+            << side * side << " vertices, time per frame:" << std::endl;
+  bool succeeded = runVertexPullingCases(gridsScene, iterationCount);
+
+  if (succeeded && !gltfFile.empty()) {
+    ThreadPool threadPool;
+    GltfLoader loader{&threadPool};
+    loader.setDeferImageDecoding(true);
+    tinygltf::Model model;
+    std::string error, warning;
+    if (loader.load(gltfFile, model, &error, &warning)) {
+      const auto scene = extractScene(model, loader.bufferSpans());
+      std::cout << "Drawing the " << scene.primitives.size()
+                << " primitives of " << gltfFile.string()
+                << ", time per frame:" << std::endl;
+      succeeded = runVertexPullingCases(scene, iterationCount);
+    } else {
+      std::cerr << "Error: " << error << std::endl;
+      succeeded = false;
+    }
+  }
+  glDeleteBuffers(1, &drawUniforms);
+  return succeeded;
+}
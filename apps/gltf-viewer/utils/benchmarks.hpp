@@ -0,0 +1,37 @@
+#pragma once
+
+#include "filesystem.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+// Microbenchmarks run by the "benchmark" command. Results are printed to
+// std::cout, each case is timed iterationCount times and the best time is
+// kept.
+
+// Decode byteCount random bytes encoded as a base64 data URI with tinygltf,
+// with the scalar decoder and with the SIMD decoder of base64.hpp. If gltfFile
+// is not empty, also compare loading it with tinygltf and with GltfLoader,
+// images not being decoded. Returns false on error.
+bool runBase64Benchmark(
+    size_t byteCount, uint32_t iterationCount, const fs::path &gltfFile);
+
+// Draw a vertex-bound frame with the vertices of each VertexLayout (see
+// vertex_layout.hpp), and repack them: a grid of byteCount bytes of float
+// positions, normals and texture coordinates stored in separate streams, as
+// most exporters write them, its tiny triangles being drawn to a 1x1
+// viewport. If gltfFile is not empty, also draw all the primitives of it in
+// one frame. Needs a current GL context. Returns false on error.
+bool runVertexLayoutBenchmark(
+    size_t byteCount, uint32_t iterationCount, const fs::path &gltfFile);
+
+// Draw primitiveCount small primitives, each with its own vertices, with a
+// vertex array object per primitive, with vertex array objects shared by
+// vertex format and with vertex pulling (see vertex_arrays.hpp), using the
+// vertex shader vertexShaderPath (forward_pulling.vs.glsl). Triangles are
+// drawn to a 1x1 viewport: the frame is bound by the CPU cost of draws. If
+// gltfFile is not empty, also draw all the primitives of it. Needs a current
+// GL context. Returns false on error.
+bool runVertexPullingBenchmark(uint32_t primitiveCount,
+    uint32_t iterationCount, const fs::path &gltfFile,
+    const fs::path &vertexShaderPath);
@@ -0,0 +1,156 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+fs::path normalize(const fs::path &path)
+{
+  std::error_code error;
+  const auto absolutePath = fs::absolute(path);
+  const auto canonicalPath = fs::canonical(absolutePath, error);
+  return error ? absolutePath : canonicalPath;
+}
+
+} // namespace
+
+bool FileWatcher::isWatched(const fs::path &path) const
+{
+  return std::find(begin(m_Files), end(m_Files), path) != end(m_Files) ||
+         std::find(begin(m_Directories), end(m_Directories),
+             path.parent_path()) != end(m_Directories);
+}
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() : m_nInotifyFd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+  if (m_nInotifyFd >= 0) {
+    close(m_nInotifyFd);
+  }
+}
+
+bool FileWatcher::watch(const fs::path &path)
+{
+  if (m_nInotifyFd < 0) {
+    return false;
+  }
+  const auto watchedPath = normalize(path);
+  const bool isDirectory = fs::is_directory(watchedPath);
+  const auto directory =
+      isDirectory ? watchedPath : watchedPath.parent_path();
+  const auto wd = inotify_add_watch(m_nInotifyFd, directory.c_str(),
+      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  if (wd < 0) {
+    return false;
+  }
+  m_WatchedDirectories[wd] = directory;
+  (isDirectory ? m_Directories : m_Files).emplace_back(watchedPath);
+  return true;
+}
+
+void FileWatcher::clear()
+{
+  for (const auto &watched : m_WatchedDirectories) {
+    inotify_rm_watch(m_nInotifyFd, watched.first);
+  }
+  m_WatchedDirectories.clear();
+  m_Files.clear();
+  m_Directories.clear();
+}
+
+std::vector<fs::path> FileWatcher::poll()
+{
+  std::vector<fs::path> changedPaths;
+  if (m_nInotifyFd < 0) {
+    return changedPaths;
+  }
+  alignas(inotify_event) char buffer[4096];
+  ssize_t length;
+  while ((length = read(m_nInotifyFd, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const auto *event = (const inotify_event *)(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      const auto it = m_WatchedDirectories.find(event->wd);
+      if (it == end(m_WatchedDirectories) || event->len == 0) {
+        continue;
+      }
+      const auto path = (*it).second / event->name;
+      if (isWatched(path) && std::find(begin(changedPaths),
+                                 end(changedPaths),
+                                 path) == end(changedPaths)) {
+        changedPaths.emplace_back(path);
+      }
+    }
+  }
+  return changedPaths;
+}
+
+#else
+
+FileWatcher::FileWatcher() = default;
+
+FileWatcher::~FileWatcher() = default;
+
+bool FileWatcher::watch(const fs::path &path)
+{
+  const auto watchedPath = normalize(path);
+  std::error_code error;
+  if (fs::is_directory(watchedPath)) {
+    m_Directories.emplace_back(watchedPath);
+    for (const auto &entry : fs::directory_iterator(watchedPath, error)) {
+      m_LastWriteTimes[entry.path().string()] =
+          fs::last_write_time(entry.path(), error);
+    }
+  } else {
+    m_Files.emplace_back(watchedPath);
+    m_LastWriteTimes[watchedPath.string()] =
+        fs::last_write_time(watchedPath, error);
+  }
+  return !error;
+}
+
+void FileWatcher::clear()
+{
+  m_Files.clear();
+  m_Directories.clear();
+  m_LastWriteTimes.clear();
+}
+
+std::vector<fs::path> FileWatcher::poll()
+{
+  std::vector<fs::path> paths = m_Files;
+  for (const auto &directory : m_Directories) {
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(directory, error)) {
+      paths.emplace_back(entry.path());
+    }
+  }
+
+  std::vector<fs::path> changedPaths;
+  for (const auto &path : paths) {
+    std::error_code error;
+    const auto lastWriteTime = fs::last_write_time(path, error);
+    if (error) {
+      continue; // Being replaced
+    }
+    auto &knownTime = m_LastWriteTimes[path.string()];
+    if (knownTime != lastWriteTime) {
+      knownTime = lastWriteTime;
+      changedPaths.emplace_back(path);
+    }
+  }
+  return changedPaths;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "filesystem.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Reports changes of watched files, or of files in watched directories.
+//
+// On Linux changes are notified by inotify. Parent directories are watched
+// rather than files, so that files replaced by a rename (as most editors and
+// exporters do) are still reported. Other platforms fall back to comparing
+// last write times on each poll().
+class FileWatcher
+{
+public:
+  FileWatcher();
+
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher &) = delete;
+
+  FileWatcher &operator=(const FileWatcher &) = delete;
+
+  // Watch a file, or all files of a directory (not recursively). Returns
+  // false if the path cannot be watched.
+  bool watch(const fs::path &path);
+
+  // Stop watching everything
+  void clear();
+
+  // Paths of the files that changed since the last call, without blocking
+  std::vector<fs::path> poll();
+
+private:
+  bool isWatched(const fs::path &path) const;
+
+  std::vector<fs::path> m_Files;
+  std::vector<fs::path> m_Directories;
+#ifdef __linux__
+  int m_nInotifyFd = -1;
+  std::map<int, fs::path> m_WatchedDirectories; // By watch descriptor
+#else
+  std::map<std::string, fs::file_time_type> m_LastWriteTimes;
+#endif
+};
@@ -0,0 +1,26 @@
+#include "geometry_options.hpp"
+#include "index_narrowing.hpp"
+#include "vertex_cache.hpp"
+
+void applyGeometryOptions(Scene &scene, const GeometryOptions &options,
+    std::vector<std::vector<unsigned char>> &storage, ThreadPool *threadPool,
+    Timings *timings)
+{
+  if (options.optimizeVertexCache || options.overdrawThreshold > 0.f) {
+    Timings::Scope timing{timings, "vertex cache"};
+    storage.emplace_back();
+    optimizeVertexCaches(
+        scene, storage.back(), threadPool, options.overdrawThreshold);
+  }
+  if (options.vertexLayout != VertexLayoutSource) {
+    Timings::Scope timing{timings, "vertex layout"};
+    storage.emplace_back();
+    applyVertexLayout(
+        scene, options.vertexLayout, storage.back(), threadPool);
+  }
+  if (options.narrowIndices) {
+    Timings::Scope timing{timings, "index narrowing"};
+    storage.emplace_back();
+    narrowIndices(scene, storage.back(), threadPool);
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "scene.hpp"
+#include "thread_pool.hpp"
+#include "timings.hpp"
+#include "vertex_layout.hpp"
+
+#include <vector>
+
+// Optional load-time passes rewriting the vertices and indices of a scene,
+// applied the same way on first load and on hot reload
+struct GeometryOptions
+{
+  // Reorder triangles and vertices for the GPU caches, see vertex_cache.hpp
+  bool optimizeVertexCache = false;
+  // Then reorder triangles to reduce overdraw if greater than 0, see
+  // overdraw.hpp. Implies optimizeVertexCache.
+  float overdrawThreshold = 0.f;
+  // Repack vertex attributes, see vertex_layout.hpp
+  VertexLayout vertexLayout = VertexLayoutSource;
+  // Rewrite 32-bit indices as 16-bit ones where possible, see
+  // index_narrowing.hpp
+  bool narrowIndices = false;
+};
+
+// Apply the passes enabled in options to scene, in the order of the fields of
+// GeometryOptions. Each pass writing data appends a vector to storage, whose
+// bytes scene.buffers then reference. Passes are timed with timings if not
+// null and run in parallel on threadPool if not null.
+void applyGeometryOptions(Scene &scene, const GeometryOptions &options,
+    std::vector<std::vector<unsigned char>> &storage, ThreadPool *threadPool,
+    Timings *timings);
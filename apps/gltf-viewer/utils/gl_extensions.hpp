@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// True if the current context exposes the extension named name (e.g.
+// "GL_KHR_parallel_shader_compile")
+inline bool hasGLExtension(const char *name)
+{
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (GLint i = 0; i < extensionCount; ++i) {
+    const auto *extension =
+        (const char *)glGetStringi(GL_EXTENSIONS, GLuint(i));
+    if (extension && std::strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// From GL_EXT_texture_compression_s3tc, which glad was not generated with
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
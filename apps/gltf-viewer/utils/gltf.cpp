@@ -3,8 +3,84 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
+namespace
+{
+
+// Value of a component as the vertex shader sees it (KHR_mesh_quantization)
+float dequantize(double value, int componentType, bool normalized)
+{
+  if (!normalized) {
+    return float(value);
+  }
+  switch (componentType) {
+  case TINYGLTF_COMPONENT_TYPE_BYTE:
+    return std::max(float(value) / 127.f, -1.f);
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return float(value) / 255.f;
+  case TINYGLTF_COMPONENT_TYPE_SHORT:
+    return std::max(float(value) / 32767.f, -1.f);
+  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+    return float(value) / 65535.f;
+  default:
+    return float(value);
+  }
+}
+
+template <typename T> double readComponent(const unsigned char *bytes)
+{
+  T value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return double(value);
+}
+
+// An element of up to 4 components of any component type allowed by
+// KHR_mesh_quantization, remaining components are 0
+glm::vec4 readElement(
+    const tinygltf::Accessor &accessor, const unsigned char *bytes)
+{
+  const auto componentSize =
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType));
+  const auto componentCount =
+      std::min(tinygltf::GetNumComponentsInType(uint32_t(accessor.type)), 4);
+  glm::vec4 element{0};
+  for (int i = 0; i < componentCount; ++i) {
+    const auto *component = bytes + i * componentSize;
+    double value = 0;
+    switch (accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      value = readComponent<int8_t>(component);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      value = readComponent<uint8_t>(component);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+      value = readComponent<int16_t>(component);
+      break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      value = readComponent<uint16_t>(component);
+      break;
+    default:
+      value = readComponent<float>(component);
+    }
+    element[i] =
+        dequantize(value, accessor.componentType, accessor.normalized);
+  }
+  return element;
+}
+
+// A VEC3 POSITION of any component type allowed by KHR_mesh_quantization
+glm::vec3 readPosition(
+    const tinygltf::Accessor &accessor, const unsigned char *bytes)
+{
+  return glm::vec3(readElement(accessor, bytes));
+}
+
+} // namespace
+
 glm::mat4 getLocalToWorldMatrix(
     const tinygltf::Node &node, const glm::mat4 &parentMatrix)
 {
@@ -35,119 +111,206 @@ glm::mat4 getLocalToWorldMatrix(
                                                  node.scale[1], node.scale[2]));
 };
 
-void computeSceneBounds(
-    const tinygltf::Model &model, glm::vec3 &bboxMin, glm::vec3 &bboxMax)
+std::vector<glm::mat4> getInstanceMatrices(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, const tinygltf::Node &node)
 {
-  // Compute scene bounding box
-  // todo refactor with scene drawing
-  // todo need a visitScene generic function that takes a accept() functor
-  bboxMin = glm::vec3(std::numeric_limits<float>::max());
-  bboxMax = glm::vec3(std::numeric_limits<float>::lowest());
-  if (model.defaultScene >= 0) {
-    const std::function<void(int, const glm::mat4 &)> updateBounds =
-        [&](int nodeIdx, const glm::mat4 &parentMatrix) {
-          const auto &node = model.nodes[nodeIdx];
-          const glm::mat4 modelMatrix =
-              getLocalToWorldMatrix(node, parentMatrix);
-          if (node.mesh >= 0) {
-            const auto &mesh = model.meshes[node.mesh];
-            for (size_t pIdx = 0; pIdx < mesh.primitives.size(); ++pIdx) {
-              const auto &primitive = mesh.primitives[pIdx];
-              const auto positionAttrIdxIt =
-                  primitive.attributes.find("POSITION");
-              if (positionAttrIdxIt == end(primitive.attributes)) {
-                continue;
-              }
-              const auto &positionAccessor =
-                  model.accessors[(*positionAttrIdxIt).second];
-              if (positionAccessor.type != 3) {
-                std::cerr << "Position accessor with type != VEC3, skipping"
-                          << std::endl;
-                continue;
-              }
-              const auto &positionBufferView =
-                  model.bufferViews[positionAccessor.bufferView];
-              const auto byteOffset =
-                  positionAccessor.byteOffset + positionBufferView.byteOffset;
-              const auto &positionBuffer =
-                  model.buffers[positionBufferView.buffer];
-              const auto positionByteStride =
-                  positionBufferView.byteStride ? positionBufferView.byteStride
-                                                : 3 * sizeof(float);
-
-              if (primitive.indices >= 0) {
-                const auto &indexAccessor = model.accessors[primitive.indices];
-                const auto &indexBufferView =
-                    model.bufferViews[indexAccessor.bufferView];
-                const auto indexByteOffset =
-                    indexAccessor.byteOffset + indexBufferView.byteOffset;
-                const auto &indexBuffer = model.buffers[indexBufferView.buffer];
-                auto indexByteStride = indexBufferView.byteStride;
-
-                switch (indexAccessor.componentType) {
-                default:
-                  std::cerr
-                      << "Primitive index accessor with bad componentType "
-                      << indexAccessor.componentType << ", skipping it."
-                      << std::endl;
-                  continue;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                  indexByteStride =
-                      indexByteStride ? indexByteStride : sizeof(uint8_t);
-                  break;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                  indexByteStride =
-                      indexByteStride ? indexByteStride : sizeof(uint16_t);
-                  break;
-                case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                  indexByteStride =
-                      indexByteStride ? indexByteStride : sizeof(uint32_t);
-                  break;
-                }
-
-                for (size_t i = 0; i < indexAccessor.count; ++i) {
-                  uint32_t index = 0;
-                  switch (indexAccessor.componentType) {
-                  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
-                    index = *((const uint8_t *)&indexBuffer
-                                  .data[indexByteOffset + indexByteStride * i]);
-                    break;
-                  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
-                    index = *((const uint16_t *)&indexBuffer
-                                  .data[indexByteOffset + indexByteStride * i]);
-                    break;
-                  case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
-                    index = *((const uint32_t *)&indexBuffer
-                                  .data[indexByteOffset + indexByteStride * i]);
-                    break;
-                  }
-                  const auto &localPosition =
-                      *((const glm::vec3 *)&positionBuffer
-                              .data[byteOffset + positionByteStride * index]);
-                  const auto worldPosition =
-                      glm::vec3(modelMatrix * glm::vec4(localPosition, 1.f));
-                  bboxMin = glm::min(bboxMin, worldPosition);
-                  bboxMax = glm::max(bboxMax, worldPosition);
-                }
-              } else {
-                for (size_t i = 0; i < positionAccessor.count; ++i) {
-                  const auto &localPosition =
-                      *((const glm::vec3 *)&positionBuffer
-                              .data[byteOffset + positionByteStride * i]);
-                  const auto worldPosition =
-                      glm::vec3(modelMatrix * glm::vec4(localPosition, 1.f));
-                  bboxMin = glm::min(bboxMin, worldPosition);
-                  bboxMax = glm::max(bboxMax, worldPosition);
-                }
-              }
-            }
-          }
-          for (const auto childNodeIdx : node.children) {
-            updateBounds(childNodeIdx, modelMatrix);
-          }
-        };
-    for (const auto nodeIdx : model.scenes[model.defaultScene].nodes) {
-      updateBounds(nodeIdx, glm::mat4(1));
+  const auto it = node.extensions.find("EXT_mesh_gpu_instancing");
+  if (node.mesh < 0 || it == end(node.extensions) ||
+      !(*it).second.IsObject()) {
+    return {};
+  }
+  const auto &attributes = (*it).second.Get("attributes");
+  const char *const names[3] = {"TRANSLATION", "ROTATION", "SCALE"};
+  const int types[3] = {
+      TINYGLTF_TYPE_VEC3, TINYGLTF_TYPE_VEC4, TINYGLTF_TYPE_VEC3};
+  // Of each attribute, nullptr if the instances do not have it
+  const tinygltf::Accessor *accessors[3] = {};
+  const unsigned char *bytes[3] = {};
+  size_t byteStrides[3] = {};
+  size_t count = 0;
+  bool valid = attributes.IsObject();
+  for (int i = 0; valid && i < 3; ++i) {
+    const auto &accessorIdx = attributes.Get(names[i]);
+    if (!accessorIdx.IsNumber()) {
+      continue;
+    }
+    const auto index = accessorIdx.GetNumberAsDouble();
+    if (index < 0. || index >= double(model.accessors.size())) {
+      valid = false;
+      break;
+    }
+    const auto &accessor = model.accessors[size_t(index)];
+    if (accessor.type != types[i] || accessor.bufferView < 0 ||
+        size_t(accessor.bufferView) >= model.bufferViews.size() ||
+        ((accessors[0] || accessors[1]) && accessor.count != count)) {
+      valid = false;
+      break;
     }
+    const auto &bufferView = model.bufferViews[accessor.bufferView];
+    const auto elementSize =
+        size_t(tinygltf::GetComponentSizeInBytes(
+            uint32_t(accessor.componentType))) *
+        size_t(tinygltf::GetNumComponentsInType(uint32_t(accessor.type)));
+    const auto byteStride =
+        bufferView.byteStride ? bufferView.byteStride : elementSize;
+    const auto byteOffset = accessor.byteOffset + bufferView.byteOffset;
+    if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= buffers.size() ||
+        elementSize == 0 ||
+        (accessor.count > 0 &&
+            byteOffset + (accessor.count - 1) * byteStride + elementSize >
+                buffers[bufferView.buffer].size)) {
+      valid = false;
+      break;
+    }
+    accessors[i] = &accessor;
+    bytes[i] = buffers[bufferView.buffer].data + byteOffset;
+    byteStrides[i] = byteStride;
+    count = accessor.count;
+  }
+  if (!valid) {
+    std::cerr << "Invalid EXT_mesh_gpu_instancing attributes, the node is "
+                 "drawn without its instances"
+              << std::endl;
+    return {};
+  }
+
+  // Same order as node transforms: translation, then rotation, then scale
+  std::vector<glm::mat4> matrices(count);
+  for (size_t instanceIdx = 0; instanceIdx < count; ++instanceIdx) {
+    const auto read = [&](int i, const glm::vec4 &defaultValue) {
+      return accessors[i] ? readElement(*accessors[i],
+                                bytes[i] + instanceIdx * byteStrides[i])
+                          : defaultValue;
+    };
+    const auto translation = read(0, glm::vec4(0));
+    const auto rotation = read(1, glm::vec4(0, 0, 0, 1));
+    const auto scale = read(2, glm::vec4(1));
+    const auto TR =
+        glm::translate(glm::mat4(1), glm::vec3(translation)) *
+        glm::mat4_cast(
+            glm::quat(rotation.w, rotation.x, rotation.y, rotation.z));
+    matrices[instanceIdx] = glm::scale(TR, glm::vec3(scale));
+  }
+  return matrices;
+}
+
+void computeMeshBounds(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, const tinygltf::Mesh &mesh,
+    const glm::mat4 &matrix, glm::vec3 &bboxMin, glm::vec3 &bboxMax)
+{
+  const auto updateBoundsWith = [&](const glm::vec3 &localPosition) {
+    const auto position = glm::vec3(matrix * glm::vec4(localPosition, 1.f));
+    bboxMin = glm::min(bboxMin, position);
+    bboxMax = glm::max(bboxMax, position);
+  };
+  for (size_t pIdx = 0; pIdx < mesh.primitives.size(); ++pIdx) {
+    const auto &primitive = mesh.primitives[pIdx];
+    const auto positionAttrIdxIt = primitive.attributes.find("POSITION");
+    if (positionAttrIdxIt == end(primitive.attributes)) {
+      continue;
+    }
+    const auto &positionAccessor = model.accessors[(*positionAttrIdxIt).second];
+    if (positionAccessor.type != 3) {
+      std::cerr << "Position accessor with type != VEC3, skipping" << std::endl;
+      continue;
+    }
+    const auto positionSize = 3 * tinygltf::GetComponentSizeInBytes(
+                                      uint32_t(positionAccessor.componentType));
+    if (positionSize <= 0) {
+      std::cerr << "Position accessor with bad componentType "
+                << positionAccessor.componentType << ", skipping" << std::endl;
+      continue;
+    }
+    const auto &positionBufferView =
+        model.bufferViews[positionAccessor.bufferView];
+    const auto byteOffset =
+        positionAccessor.byteOffset + positionBufferView.byteOffset;
+    const auto &positionBuffer = buffers[positionBufferView.buffer];
+    const auto positionByteStride =
+        positionBufferView.byteStride ? positionBufferView.byteStride
+                                      : size_t(positionSize);
+
+    if (primitive.indices >= 0) {
+      const auto &indexAccessor = model.accessors[primitive.indices];
+      const auto &indexBufferView = model.bufferViews[indexAccessor.bufferView];
+      const auto indexByteOffset =
+          indexAccessor.byteOffset + indexBufferView.byteOffset;
+      const auto &indexBuffer = buffers[indexBufferView.buffer];
+      auto indexByteStride = indexBufferView.byteStride;
+
+      switch (indexAccessor.componentType) {
+      default:
+        std::cerr << "Primitive index accessor with bad componentType "
+                  << indexAccessor.componentType << ", skipping it."
+                  << std::endl;
+        continue;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        indexByteStride = indexByteStride ? indexByteStride : sizeof(uint8_t);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        indexByteStride = indexByteStride ? indexByteStride : sizeof(uint16_t);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        indexByteStride = indexByteStride ? indexByteStride : sizeof(uint32_t);
+        break;
+      }
+
+      for (size_t i = 0; i < indexAccessor.count; ++i) {
+        uint32_t index = 0;
+        switch (indexAccessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+          index = *((const uint8_t *)&indexBuffer.data[indexByteOffset +
+                                                       indexByteStride * i]);
+          break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+          index = *((const uint16_t *)&indexBuffer.data[indexByteOffset +
+                                                        indexByteStride * i]);
+          break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+          index = *((const uint32_t *)&indexBuffer.data[indexByteOffset +
+                                                        indexByteStride * i]);
+          break;
+        }
+        updateBoundsWith(readPosition(positionAccessor,
+            &positionBuffer.data[byteOffset + positionByteStride * index]));
+      }
+    } else {
+      for (size_t i = 0; i < positionAccessor.count; ++i) {
+        updateBoundsWith(readPosition(positionAccessor,
+            &positionBuffer.data[byteOffset + positionByteStride * i]));
+      }
+    }
+  }
+}
+
+glm::vec4 computeMeshBoundingSphere(
+    const tinygltf::Model &model, const tinygltf::Mesh &mesh)
+{
+  glm::vec3 bboxMin(std::numeric_limits<float>::max());
+  glm::vec3 bboxMax(std::numeric_limits<float>::lowest());
+  for (const auto &primitive : mesh.primitives) {
+    const auto it = primitive.attributes.find("POSITION");
+    if (it == end(primitive.attributes)) {
+      continue;
+    }
+    const auto &accessor = model.accessors[(*it).second];
+    if (accessor.minValues.size() != 3 || accessor.maxValues.size() != 3) {
+      continue;
+    }
+    // min and max are stored values, before normalization
+    glm::vec3 accessorMin, accessorMax;
+    for (int i = 0; i < 3; ++i) {
+      accessorMin[i] = dequantize(accessor.minValues[i],
+          accessor.componentType, accessor.normalized);
+      accessorMax[i] = dequantize(accessor.maxValues[i],
+          accessor.componentType, accessor.normalized);
+    }
+    bboxMin = glm::min(bboxMin, accessorMin);
+    bboxMax = glm::max(bboxMax, accessorMax);
+  }
+  if (bboxMin.x > bboxMax.x) {
+    return glm::vec4(0); // No bounds available
   }
+  return glm::vec4(
+      0.5f * (bboxMin + bboxMax), 0.5f * glm::length(bboxMax - bboxMin));
 }
\ No newline at end of file
@@ -3,8 +3,39 @@
 #include <glm/glm.hpp>
 #include <tiny_gltf.h>
 
+#include <vector>
+
+// Read-only view on the bytes of a glTF buffer. Depending on how the file has
+// been loaded, the bytes are owned by tinygltf::Buffer::data or by a memory
+// mapped file (see GltfLoader).
+struct BufferSpan
+{
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+};
+
+// A mipmap level of a decoded image, texels are tightly packed rows
+struct ImageLevel
+{
+  uint32_t width = 0, height = 0;
+  BufferSpan texels;
+};
+
 glm::mat4 getLocalToWorldMatrix(
     const tinygltf::Node &node, const glm::mat4 &parentMatrix);
 
-void computeSceneBounds(
-    const tinygltf::Model &model, glm::vec3 &bboxMin, glm::vec3 &bboxMax);
\ No newline at end of file
+// Transforms of the instances of the mesh of node (EXT_mesh_gpu_instancing),
+// relative to node. Empty if node has no instances, or if they cannot be read
+// from buffers, buffers[i] being the bytes of model.buffers[i].
+std::vector<glm::mat4> getInstanceMatrices(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, const tinygltf::Node &node);
+
+// Grow bboxMin/bboxMax to the vertices of mesh, transformed by matrix
+void computeMeshBounds(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, const tinygltf::Mesh &mesh,
+    const glm::mat4 &matrix, glm::vec3 &bboxMin, glm::vec3 &bboxMax);
+
+// Bounding sphere (center, radius) of a mesh in local space, computed from the
+// min/max values of the POSITION accessors of its primitives
+glm::vec4 computeMeshBoundingSphere(
+    const tinygltf::Model &model, const tinygltf::Mesh &mesh);
\ No newline at end of file
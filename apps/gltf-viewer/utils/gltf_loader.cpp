@@ -0,0 +1,1018 @@
+#include "gltf_loader.hpp"
+#include "base64.hpp"
+#include "hash.hpp"
+#include "meshopt.hpp"
+#include "sparse_accessors.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <json.hpp>
+#include <stb_image.h>
+#include <stdexcept>
+
+namespace
+{
+
+// A 1-byte data URI given to tinygltf in place of the buffers that we map, so
+// that it does not load them itself
+const char *const kPlaceholderBufferUri =
+    "data:application/octet-stream;base64,AA==";
+
+// Uri given to tinygltf in place of images stored in a mapped buffer or in a
+// base64 data URI, followed by the image index
+const std::string kMappedImageUriPrefix = "mapped-image-bytes:";
+
+const char *const kMeshoptExtension = "EXT_meshopt_compression";
+const char *const kBasisuExtension = "KHR_texture_basisu";
+
+const uint32_t kGlbMagic = 0x46546C67; // "glTF"
+const uint32_t kGlbChunkJson = 0x4E4F534A; // "JSON"
+const uint32_t kGlbChunkBin = 0x004E4942; // "BIN\0"
+
+uint32_t readUint32(const unsigned char *bytes)
+{
+  // glb is little endian, as are all platforms we target
+  uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+bool isGlb(const MappedFile &file)
+{
+  return file.size() >= 12 && readUint32(file.data()) == kGlbMagic;
+}
+
+// Extract the JSON and BIN chunks of a .glb file
+// https://github.com/KhronosGroup/glTF/tree/master/specification/2.0#glb-file-format-specification
+bool parseGlb(const MappedFile &file, BufferSpan &json, BufferSpan &bin,
+    std::string *err)
+{
+  const auto *bytes = file.data();
+  const size_t length = readUint32(bytes + 8);
+  if (length > file.size() || length < 20) {
+    *err += "Invalid glTF binary: bad length.\n";
+    return false;
+  }
+  const size_t jsonLength = readUint32(bytes + 12);
+  if (readUint32(bytes + 16) != kGlbChunkJson || 20 + jsonLength > length) {
+    *err += "Invalid glTF binary: bad JSON chunk.\n";
+    return false;
+  }
+  json = {bytes + 20, jsonLength};
+
+  // BIN chunk is optional
+  const size_t binHeaderOffset = 20 + jsonLength;
+  if (binHeaderOffset + 8 <= length &&
+      readUint32(bytes + binHeaderOffset + 4) == kGlbChunkBin) {
+    const size_t binLength = readUint32(bytes + binHeaderOffset);
+    if (binHeaderOffset + 8 + binLength > length) {
+      *err += "Invalid glTF binary: bad BIN chunk.\n";
+      return false;
+    }
+    bin = {bytes + binHeaderOffset + 8, binLength};
+  }
+  return true;
+}
+
+// Member of an object of a JSON text, as ranges of the text
+struct JsonMember
+{
+  std::string key;
+  const char *keyBegin = nullptr; // Opening quote
+  const char *valueBegin = nullptr, *valueEnd = nullptr; // Quotes included
+};
+
+// Object element of a top-level array of a JSON text
+struct JsonElement
+{
+  const char *begin = nullptr; // Opening brace
+  std::vector<JsonMember> members;
+
+  // As with the parser, the last of duplicated keys wins
+  const JsonMember *find(const char *key) const
+  {
+    const auto it = std::find_if(members.rbegin(), members.rend(),
+        [&](const JsonMember &member) { return member.key == key; });
+    return (it != members.rend() && it->valueEnd) ? &*it : nullptr;
+  }
+};
+
+// Elements of the top-level arrays of a glTF JSON text that the loader rewrites
+struct JsonArrays
+{
+  std::vector<JsonElement> buffers, bufferViews, images;
+};
+
+// Find the members of the elements of the buffers, bufferViews and images
+// arrays of json without parsing it: the text is only split into tokens, as
+// deep as these members, whose values are not read. Malformed text is left to
+// the parser to report.
+JsonArrays scanJsonArrays(const BufferSpan &json)
+{
+  const auto *begin = (const char *)json.data;
+  const auto *end = begin + json.size;
+  JsonArrays arrays;
+  // The top-level object is at depth 1, the elements of its arrays at depth 3
+  int depth = 0;
+  std::vector<JsonElement> *keyArray = nullptr; // Of the last top-level key
+  std::vector<JsonElement> *array = nullptr; // Whose elements are scanned
+  JsonMember *member = nullptr; // Whose value is being scanned
+  const char *stringBegin = nullptr, *stringEnd = nullptr; // Last string
+  const char *tokenEnd = nullptr; // End of the last token
+  for (auto it = begin; it != end; ++it) {
+    if (*it == ' ' || *it == '\n' || *it == '\r' || *it == '\t') {
+      continue;
+    }
+    if (member && !member->valueBegin) {
+      member->valueBegin = it;
+    }
+    switch (*it) {
+    case '"': {
+      // Find the closing quote, skipping escaped ones
+      auto closing = std::find(it + 1, end, '"');
+      while (closing != end) {
+        auto backslash = closing;
+        while (backslash > it + 1 && backslash[-1] == '\\') {
+          --backslash;
+        }
+        if ((closing - backslash) % 2 == 0) {
+          break;
+        }
+        closing = std::find(closing + 1, end, '"');
+      }
+      if (closing == end) {
+        return arrays; // Let the parser report the error
+      }
+      stringBegin = it;
+      stringEnd = closing + 1;
+      it = closing;
+      break;
+    }
+    case ':': {
+      const auto isKey = [&](const char *key) {
+        return stringBegin &&
+               std::string::traits_type::length(key) + 2 ==
+                   size_t(stringEnd - stringBegin) &&
+               std::equal(stringBegin + 1, stringEnd - 1, key);
+      };
+      if (depth == 1) {
+        keyArray = isKey("buffers")       ? &arrays.buffers
+                   : isKey("bufferViews") ? &arrays.bufferViews
+                   : isKey("images")      ? &arrays.images
+                                          : nullptr;
+      } else if (depth == 3 && array && !array->empty() && stringBegin) {
+        JsonMember newMember;
+        newMember.key = std::string(stringBegin + 1, stringEnd - 1);
+        newMember.keyBegin = stringBegin;
+        array->back().members.push_back(std::move(newMember));
+        member = &array->back().members.back();
+      }
+      break;
+    }
+    case '{':
+    case '[':
+      if (depth == 1) {
+        array = *it == '[' ? keyArray : nullptr;
+      } else if (depth == 2 && array && *it == '{') {
+        array->emplace_back();
+        array->back().begin = it;
+      }
+      ++depth;
+      break;
+    case '}':
+    case ']':
+    case ',':
+      if (depth == 3 && member) {
+        member->valueEnd = tokenEnd;
+        member = nullptr;
+      }
+      if (*it != ',') {
+        --depth;
+      }
+      break;
+    default:
+      break;
+    }
+    tokenEnd = it + 1;
+  }
+  return arrays;
+}
+
+// Value of member key of element parsed on its own, discarded if it is
+// missing or invalid
+nlohmann::json parseMember(const JsonElement &element, const char *key)
+{
+  const auto *member = element.find(key);
+  if (!member) {
+    return nlohmann::json(nlohmann::json::value_t::discarded);
+  }
+  return nlohmann::json::parse(
+      member->valueBegin, member->valueEnd, nullptr, false);
+}
+
+size_t getUnsigned(const JsonElement &element, const char *key)
+{
+  const auto value = parseMember(element, key);
+  return value.is_number_unsigned() ? value.get<size_t>() : 0;
+}
+
+// Empty if member key of element is not a string
+std::string getString(const JsonElement &element, const char *key)
+{
+  const auto value = parseMember(element, key);
+  return value.is_string() ? value.get<std::string>() : std::string{};
+}
+
+// Text of string member key of element, without its quotes, if it has no
+// escape sequence
+bool getRawString(const JsonElement &element, const char *key,
+    const char **begin, const char **end)
+{
+  const auto *member = element.find(key);
+  if (!member || *member->valueBegin != '"' ||
+      std::find(member->valueBegin, member->valueEnd, '\\') !=
+          member->valueEnd) {
+    return false;
+  }
+  *begin = member->valueBegin + 1;
+  *end = member->valueEnd - 1;
+  return true;
+}
+
+// Buffers flagged as fallback by EXT_meshopt_compression have no meaningful
+// data, only compressed bufferViews are decoded to them
+bool isMeshoptFallback(const JsonElement &buffer)
+{
+  const auto extensions = parseMember(buffer, "extensions");
+  if (!extensions.is_object()) {
+    return false;
+  }
+  const auto extension = extensions.find(kMeshoptExtension);
+  if (extension == extensions.end() || !extension->is_object()) {
+    return false;
+  }
+  const auto fallback = extension->find("fallback");
+  return fallback != extension->end() && fallback->is_boolean() &&
+         fallback->get<bool>();
+}
+
+// Replacement of the range [begin, end) of a text
+struct TextPatch
+{
+  const char *begin = nullptr, *end = nullptr;
+  std::string text;
+};
+
+// Copy of text with patches, which must not overlap, applied
+std::string applyPatches(const BufferSpan &text, std::vector<TextPatch> patches)
+{
+  std::sort(begin(patches), end(patches),
+      [](const TextPatch &a, const TextPatch &b) { return a.begin < b.begin; });
+  size_t size = text.size;
+  for (const auto &patch : patches) {
+    size += patch.text.size() - size_t(patch.end - patch.begin);
+  }
+  std::string output;
+  output.reserve(size);
+  const auto *copied = (const char *)text.data;
+  for (const auto &patch : patches) {
+    output.append(copied, patch.begin);
+    output += patch.text;
+    copied = patch.end;
+  }
+  output.append(copied, (const char *)text.data + text.size);
+  return output;
+}
+
+bool isMappedImagePath(const std::string &path)
+{
+  // tinygltf prepends the base directory to the uri
+  return path.rfind(kMappedImageUriPrefix) != std::string::npos;
+}
+
+// bufferView compressed by EXT_meshopt_compression
+struct MeshoptBufferView
+{
+  size_t bufferViewIdx = 0;
+  size_t buffer = 0; // Of the compressed bytes
+  size_t byteOffset = 0, byteLength = 0;
+  size_t byteStride = 0, count = 0;
+  MeshoptMode mode = MeshoptAttributes;
+  MeshoptFilter filter = MeshoptFilterNone;
+  const unsigned char *source = nullptr;
+  unsigned char *destination = nullptr;
+};
+
+bool parseMeshoptExtension(
+    const tinygltf::Value &extension, MeshoptBufferView &bufferView)
+{
+  if (!extension.IsObject()) {
+    return false;
+  }
+  const auto getSize = [&](const char *key, size_t *value) {
+    const auto &number = extension.Get(key);
+    if (!number.IsNumber() || number.GetNumberAsDouble() < 0.) {
+      return false;
+    }
+    *value = size_t(number.GetNumberAsDouble());
+    return true;
+  };
+  const auto &mode = extension.Get("mode");
+  const auto &filter = extension.Get("filter");
+  bufferView.byteOffset = 0; // Optional
+  return getSize("buffer", &bufferView.buffer) &&
+         (!extension.Has("byteOffset") ||
+             getSize("byteOffset", &bufferView.byteOffset)) &&
+         getSize("byteLength", &bufferView.byteLength) &&
+         getSize("byteStride", &bufferView.byteStride) &&
+         getSize("count", &bufferView.count) && mode.IsString() &&
+         parseMeshoptMode(mode.Get<std::string>(), &bufferView.mode) &&
+         (!filter.IsString() ||
+             parseMeshoptFilter(filter.Get<std::string>(), &bufferView.filter));
+}
+
+} // namespace
+
+bool GltfLoader::load(const fs::path &path, tinygltf::Model &model,
+    std::string *err, std::string *warn)
+{
+  m_MappedFiles.clear();
+  m_BufferSpans.clear();
+  m_MappedImages.clear();
+  m_CachedImages.clear();
+  m_CompressedImages.clear();
+  m_PendingImages.clear();
+  m_ImageHashes.clear();
+  m_OwnedBuffers.clear();
+  m_MeshoptDecodedSize = 0;
+  m_MeshoptDecodeSeconds = 0.;
+
+  // tinygltf parses the JSON text once. Buffers that we map and images that
+  // are stored in them or in base64 data URIs are hidden from it beforehand,
+  // by rewriting only their members in a copy of the text.
+  Timings::Scope jsonParseTiming{m_pTimings, "JSON parse"};
+  try {
+    m_MappedFiles.emplace_back(path);
+  } catch (const std::runtime_error &e) {
+    *err += std::string(e.what()) + "\n";
+    return false;
+  }
+
+  const auto &file = m_MappedFiles.back();
+  BufferSpan jsonChunk{file.data(), file.size()};
+  BufferSpan binChunk;
+  if (isGlb(file) && !parseGlb(file, jsonChunk, binChunk, err)) {
+    return false;
+  }
+
+  const auto baseDir = path.parent_path();
+  const auto arrays = scanJsonArrays(jsonChunk);
+  std::vector<TextPatch> patches;
+
+  // Base64 data URIs are decoded by decodeDataUris() rather than by tinygltf,
+  // straight from the file mapping. Returns false if the uri of element is
+  // not one, data URIs with escape sequences are left to tinygltf.
+  std::vector<DataUri> dataUris;
+  const auto takeDataUri = [&](const JsonElement &element,
+                               std::string *header, std::string *mediaType) {
+    const char *text, *textEnd;
+    if (!getRawString(element, "uri", &text, &textEnd)) {
+      return false;
+    }
+    const auto comma = std::find(text, textEnd, ',');
+    *header = std::string(text, comma == textEnd ? comma : comma + 1);
+    DataUri dataUri;
+    size_t textOffset;
+    if (!parseBase64DataUri(*header, &textOffset, mediaType) ||
+        !getBase64DecodedSize(text + textOffset,
+            size_t(textEnd - text) - textOffset, &dataUri.decodedSize)) {
+      return false;
+    }
+    dataUri.text = text + textOffset;
+    dataUri.length = size_t(textEnd - text) - textOffset;
+    m_OwnedBuffers.emplace_back(dataUri.decodedSize);
+    dataUri.output = m_OwnedBuffers.back().data();
+    dataUris.emplace_back(dataUri);
+    return true;
+  };
+
+  // Buffers that are not data URIs tinygltf can only decode itself are
+  // mapped once the document is parsed, and given to tinygltf as a
+  // placeholder
+  const size_t bufferCount = arrays.buffers.size();
+  std::vector<bool> isMapped(bufferCount, false);
+  std::vector<bool> isFile(bufferCount, false);
+  std::vector<bool> isOwned(bufferCount, false); // Writable
+  std::vector<size_t> byteLengths(bufferCount, 0);
+  std::vector<std::string> mappedUris(bufferCount);
+  m_BufferSpans.resize(bufferCount);
+  for (size_t bufferIdx = 0; bufferIdx < bufferCount; ++bufferIdx) {
+    const auto &buffer = arrays.buffers[bufferIdx];
+    const auto *byteLengthMember = buffer.find("byteLength");
+    const auto byteLength = getUnsigned(buffer, "byteLength");
+    std::string header, mediaType;
+    if (!byteLengthMember) {
+      continue; // Let tinygltf report the error
+    } else if (isMeshoptFallback(buffer)) {
+      // Its uri, if any, is not loaded
+      m_OwnedBuffers.emplace_back(byteLength);
+      m_BufferSpans[bufferIdx] = {m_OwnedBuffers.back().data(), byteLength};
+      isOwned[bufferIdx] = true;
+    } else if (!buffer.find("uri")) {
+      // Stored in the BIN chunk of the .glb
+      if (!binChunk.data || byteLength > binChunk.size) {
+        continue; // Let tinygltf report the error
+      }
+      m_BufferSpans[bufferIdx] = {binChunk.data, byteLength};
+    } else if (takeDataUri(buffer, &header, &mediaType)) {
+      if (dataUris.back().decodedSize < byteLength) {
+        *err += "buffer[" + std::to_string(bufferIdx) +
+                "] data URI is shorter than its byteLength.\n";
+        return false;
+      }
+      m_BufferSpans[bufferIdx] = {dataUris.back().output, byteLength};
+      mappedUris[bufferIdx] = header; // The text is not kept
+      isOwned[bufferIdx] = true;
+    } else {
+      const auto uri = getString(buffer, "uri");
+      if (uri.empty() || tinygltf::IsDataURI(uri)) {
+        continue;
+      }
+      mappedUris[bufferIdx] = uri;
+      isFile[bufferIdx] = true;
+    }
+    isMapped[bufferIdx] = true;
+    byteLengths[bufferIdx] = byteLength;
+    const std::string placeholder =
+        std::string("\"") + kPlaceholderBufferUri + "\"";
+    if (const auto *uri = buffer.find("uri")) {
+      patches.push_back({uri->valueBegin, uri->valueEnd, placeholder});
+    } else {
+      patches.push_back(
+          {buffer.begin + 1, buffer.begin + 1, "\"uri\":" + placeholder + ","});
+    }
+    patches.push_back(
+        {byteLengthMember->valueBegin, byteLengthMember->valueEnd, "1"});
+  }
+
+  // Images stored in a bufferView of a mapped buffer or in a data URI are
+  // given a fake uri, read through our filesystem callbacks
+  struct BufferViewImage
+  {
+    size_t imageIdx = 0, bufferViewIdx = 0, bufferIdx = 0;
+    size_t byteOffset = 0, byteLength = 0;
+    std::string mimeType;
+  };
+  std::vector<BufferViewImage> bufferViewImages;
+  std::vector<std::pair<size_t, std::string>> dataUriImages; // Media type
+  const size_t imageCount = arrays.images.size();
+  m_MappedImages.resize(imageCount);
+  for (size_t imageIdx = 0; imageIdx < imageCount; ++imageIdx) {
+    const auto &image = arrays.images[imageIdx];
+    const auto uri =
+        "\"" + kMappedImageUriPrefix + std::to_string(imageIdx) + "\"";
+    std::string header, mediaType;
+    if (takeDataUri(image, &header, &mediaType)) {
+      const auto &dataUri = dataUris.back();
+      const auto *member = image.find("uri");
+      m_MappedImages[imageIdx] = {dataUri.output, dataUri.decodedSize};
+      dataUriImages.emplace_back(imageIdx, mediaType);
+      patches.push_back({member->valueBegin, member->valueEnd, uri});
+      continue;
+    }
+    const auto *member = image.find("bufferView");
+    const auto bufferViewValue = parseMember(image, "bufferView");
+    if (!bufferViewValue.is_number_unsigned() ||
+        bufferViewValue.get<size_t>() >= arrays.bufferViews.size()) {
+      continue;
+    }
+    BufferViewImage bufferViewImage;
+    bufferViewImage.imageIdx = imageIdx;
+    bufferViewImage.bufferViewIdx = bufferViewValue.get<size_t>();
+    const auto &bufferView = arrays.bufferViews[bufferViewImage.bufferViewIdx];
+    bufferViewImage.bufferIdx = getUnsigned(bufferView, "buffer");
+    if (bufferViewImage.bufferIdx >= bufferCount ||
+        !isMapped[bufferViewImage.bufferIdx]) {
+      continue;
+    }
+    bufferViewImage.byteOffset = getUnsigned(bufferView, "byteOffset");
+    bufferViewImage.byteLength = getUnsigned(bufferView, "byteLength");
+    if (bufferViewImage.byteOffset + bufferViewImage.byteLength >
+        byteLengths[bufferViewImage.bufferIdx]) {
+      *err += "image[" + std::to_string(imageIdx) +
+              "] bufferView is out of buffer bounds.\n";
+      return false;
+    }
+    // tinygltf only reads the mimeType of images with a bufferView
+    bufferViewImage.mimeType = getString(image, "mimeType");
+    bufferViewImages.emplace_back(std::move(bufferViewImage));
+    patches.push_back({member->keyBegin, member->valueEnd, "\"uri\":" + uri});
+  }
+
+  // tinygltf decodes data URIs that are not base64
+  tinygltf::TinyGLTF loader;
+  loader.SetFsCallbacks({&GltfLoader::fileExists, &GltfLoader::expandFilePath,
+      &GltfLoader::readWholeFile, &tinygltf::WriteWholeFile, this});
+  loader.SetImageLoader(&GltfLoader::loadImageData, this);
+  std::string patchedJson;
+  if (!patches.empty()) {
+    patchedJson = applyPatches(jsonChunk, std::move(patches));
+    jsonChunk = {(const unsigned char *)patchedJson.data(), patchedJson.size()};
+  }
+  if (!loader.LoadASCIIFromString(&model, err, warn,
+          (const char *)jsonChunk.data, (unsigned int)jsonChunk.size,
+          baseDir.string())) {
+    return false;
+  }
+  jsonParseTiming.stop();
+
+  Timings::Scope bufferLoadTiming{m_pTimings, "buffer load"};
+  for (size_t bufferIdx = 0; bufferIdx < bufferCount; ++bufferIdx) {
+    if (!isFile[bufferIdx]) {
+      continue;
+    }
+    const auto &uri = mappedUris[bufferIdx];
+    try {
+      m_MappedFiles.emplace_back(baseDir / uri);
+    } catch (const std::runtime_error &e) {
+      *err += std::string(e.what()) + "\n";
+      return false;
+    }
+    const auto &binFile = m_MappedFiles.back();
+    if (binFile.size() < byteLengths[bufferIdx]) {
+      *err += "File size mismatch : " + uri + ", requested " +
+              std::to_string(byteLengths[bufferIdx]) + " bytes, but got " +
+              std::to_string(binFile.size()) + "\n";
+      return false;
+    }
+    m_BufferSpans[bufferIdx] = {binFile.data(), byteLengths[bufferIdx]};
+  }
+  for (const auto &image : bufferViewImages) {
+    m_MappedImages[image.imageIdx] = {
+        m_BufferSpans[image.bufferIdx].data + image.byteOffset,
+        image.byteLength};
+  }
+  bufferLoadTiming.stop();
+
+  if (!decodeDataUris(dataUris, err)) {
+    return false;
+  }
+
+  // loadImageData() has left the bytes of mapped images to us
+  for (size_t imageIdx = 0; imageIdx < m_PendingImages.size(); ++imageIdx) {
+    auto &pendingImage = m_PendingImages[imageIdx];
+    if (!pendingImage.pending) {
+      continue;
+    }
+    if (!pendingImage.bytes.data && imageIdx < m_MappedImages.size()) {
+      pendingImage.bytes = m_MappedImages[imageIdx];
+    }
+    m_ImageHashes[imageIdx] =
+        hashBytes(pendingImage.bytes.data, pendingImage.bytes.size);
+  }
+
+  // Restore what has been rewritten
+  m_BufferSpans.resize(model.buffers.size());
+  isOwned.resize(model.buffers.size(), false);
+  for (size_t bufferIdx = 0; bufferIdx < model.buffers.size(); ++bufferIdx) {
+    auto &buffer = model.buffers[bufferIdx];
+    if (bufferIdx < bufferCount && isMapped[bufferIdx]) {
+      buffer.uri = mappedUris[bufferIdx];
+      std::vector<unsigned char>().swap(buffer.data);
+    } else {
+      m_BufferSpans[bufferIdx] = {buffer.data.data(), buffer.data.size()};
+      isOwned[bufferIdx] = true;
+    }
+  }
+
+  if (!decodeMeshoptBufferViews(model, isOwned, err)) {
+    return false;
+  }
+
+  {
+    Timings::Scope timing{m_pTimings, "sparse accessors"};
+    std::vector<unsigned char> storage;
+    if (!materializeSparseAccessors(
+            model, m_BufferSpans, storage, m_pThreadPool, err)) {
+      return false;
+    }
+    if (!storage.empty()) {
+      m_OwnedBuffers.emplace_back(std::move(storage)); // Keeps its bytes
+    }
+  }
+  for (const auto &bufferViewImage : bufferViewImages) {
+    if (bufferViewImage.imageIdx < model.images.size()) {
+      auto &image = model.images[bufferViewImage.imageIdx];
+      image.uri.clear();
+      image.bufferView = int(bufferViewImage.bufferViewIdx);
+      image.mimeType = bufferViewImage.mimeType;
+    }
+  }
+  for (const auto &dataUriImage : dataUriImages) {
+    // The text of the data URI is not kept
+    if (dataUriImage.first < model.images.size()) {
+      auto &image = model.images[dataUriImage.first];
+      image.uri = "data:" + dataUriImage.second + ";base64,";
+      if (image.mimeType.empty()) {
+        image.mimeType = dataUriImage.second;
+      }
+    }
+  }
+
+  selectKtx2Sources(model);
+
+  // Sized now so that decodeImage() can fill them concurrently
+  m_CachedImages.resize(m_PendingImages.size());
+  m_CompressedImages.resize(m_PendingImages.size());
+
+  if (m_bDeferImageDecoding) {
+    return true;
+  }
+  Timings::Scope imageDecodeTiming{m_pTimings, "image decode"};
+  return decodeAllImages(model, err);
+}
+
+bool GltfLoader::decodeImage(
+    tinygltf::Model &model, int imageIdx, std::string *err)
+{
+  if (size_t(imageIdx) >= m_PendingImages.size()) {
+    return true;
+  }
+  auto &pendingImage = m_PendingImages[imageIdx];
+  if (!pendingImage.pending) {
+    return true;
+  }
+  auto &image = model.images[imageIdx];
+  if (isKtx2(pendingImage.bytes.data, pendingImage.bytes.size)) {
+    const bool returnValue =
+        decodeKtx2Image(image, imageIdx, pendingImage, err);
+    pendingImage = PendingImage{};
+    return returnValue;
+  }
+
+  uint64_t cacheKey = 0;
+  if (m_pTextureCache) {
+    cacheKey = TextureCache::computeKey(
+        pendingImage.bytes.data, pendingImage.bytes.size);
+    auto entry = std::make_unique<TextureCache::Entry>();
+    if (m_pTextureCache->find(cacheKey, *entry) &&
+        setImageFromCache(image, *entry)) {
+      m_CachedImages[imageIdx] = std::move(entry);
+      pendingImage = PendingImage{};
+      return true;
+    }
+  }
+
+  std::string warn;
+  const bool returnValue = tinygltf::LoadImageData(&image, imageIdx, err,
+      &warn, pendingImage.reqWidth, pendingImage.reqHeight,
+      pendingImage.bytes.data, int(pendingImage.bytes.size), nullptr);
+  pendingImage = PendingImage{};
+
+  if (returnValue && m_pTextureCache &&
+      m_pTextureCache->store(cacheKey, image)) {
+    // Use the stored entry, which also has the mipmap levels, and release
+    // the decoded copy
+    auto entry = std::make_unique<TextureCache::Entry>();
+    if (m_pTextureCache->find(cacheKey, *entry) &&
+        setImageFromCache(image, *entry)) {
+      m_CachedImages[imageIdx] = std::move(entry);
+      std::vector<unsigned char>().swap(image.image);
+    }
+  }
+  return returnValue;
+}
+
+bool GltfLoader::readImageHeader(
+    tinygltf::Model &model, int imageIdx, std::string *err)
+{
+  if (size_t(imageIdx) >= m_PendingImages.size() ||
+      !m_PendingImages[imageIdx].pending) {
+    return true;
+  }
+  const auto &bytes = m_PendingImages[imageIdx].bytes;
+  if (isKtx2(bytes.data, bytes.size)) {
+    return decodeImage(model, imageIdx, err);
+  }
+  int width = 0, height = 0, components = 0;
+  if (!stbi_info_from_memory(
+          bytes.data, int(bytes.size), &width, &height, &components)) {
+    *err += "image[" + std::to_string(imageIdx) +
+            "] has an unknown format: " + stbi_failure_reason() + ".\n";
+    return false;
+  }
+  // tinygltf decodes all images to RGBA, 16-bit PNGs to 16 bits
+  const bool is16Bits =
+      stbi_is_16_bit_from_memory(bytes.data, int(bytes.size)) != 0;
+  auto &image = model.images[imageIdx];
+  image.width = width;
+  image.height = height;
+  image.component = 4;
+  image.bits = is16Bits ? 16 : 8;
+  image.pixel_type = is16Bits ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                              : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  return true;
+}
+
+void GltfLoader::releaseData(tinygltf::Model &model)
+{
+  // Swap with empty vectors, clear() would keep the capacity
+  for (auto &buffer : model.buffers) {
+    std::vector<unsigned char>().swap(buffer.data);
+  }
+  for (auto &image : model.images) {
+    std::vector<unsigned char>().swap(image.image);
+  }
+  std::vector<PendingImage>().swap(m_PendingImages);
+  std::vector<std::unique_ptr<TextureCache::Entry>>().swap(m_CachedImages);
+  std::vector<std::unique_ptr<CompressedImage>>().swap(m_CompressedImages);
+  std::vector<BufferSpan>().swap(m_MappedImages);
+  std::vector<std::vector<unsigned char>>().swap(m_OwnedBuffers);
+  std::vector<BufferSpan>().swap(m_BufferSpans);
+  std::vector<MappedFile>().swap(m_MappedFiles);
+}
+
+bool GltfLoader::decodeKtx2Image(tinygltf::Image &image, int imageIdx,
+    PendingImage &pendingImage, std::string *err)
+{
+  const auto prefix = "image[" + std::to_string(imageIdx) + "] ";
+  Ktx2Image ktx2;
+  if (!parseKtx2(pendingImage.bytes.data, pendingImage.bytes.size, ktx2,
+          err)) {
+    return false;
+  }
+  const auto glFormat = getKtx2GLFormat(ktx2);
+  if (isCompressedFormatSupported(glFormat)) {
+    auto compressed = std::make_unique<CompressedImage>();
+    compressed->glFormat = glFormat;
+    // Moving the vector keeps the bytes the levels point to
+    compressed->ownedBytes = std::move(pendingImage.ownedBytes);
+    for (uint32_t level = 0; level < ktx2.levels.size(); ++level) {
+      compressed->levels.push_back({std::max(ktx2.width >> level, 1u),
+          std::max(ktx2.height >> level, 1u), ktx2.levels[level]});
+    }
+    m_CompressedImages[imageIdx] = std::move(compressed);
+  } else if (!decodeKtx2ToRgba8(ktx2, image.image)) {
+    *err += prefix + "KTX2 format is not supported" +
+            (ktx2.vkFormat == 0 || ktx2.supercompressionScheme != 0
+                    ? " (no Basis Universal transcoder in this build).\n"
+                    : ".\n");
+    return false;
+  }
+  image.width = int(ktx2.width);
+  image.height = int(ktx2.height);
+  image.component = 4;
+  image.bits = 8;
+  image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  return true;
+}
+
+void GltfLoader::selectKtx2Sources(tinygltf::Model &model)
+{
+  // Only headers are parsed here
+  const auto imageCount = std::min(model.images.size(), m_PendingImages.size());
+  std::vector<char> isKtx2Image(imageCount, false);
+  std::vector<char> isUsable(imageCount, false);
+  for (size_t imageIdx = 0; imageIdx < imageCount; ++imageIdx) {
+    const auto &bytes = m_PendingImages[imageIdx].bytes;
+    Ktx2Image ktx2;
+    std::string err;
+    isKtx2Image[imageIdx] = isKtx2(bytes.data, bytes.size);
+    if (isKtx2Image[imageIdx] &&
+        parseKtx2(bytes.data, bytes.size, ktx2, &err)) {
+      const auto glFormat = getKtx2GLFormat(ktx2);
+      isUsable[imageIdx] =
+          isCompressedFormatSupported(glFormat) || canDecodeToRgba8(glFormat);
+    }
+  }
+
+  std::vector<char> isUsed(imageCount, false);
+  for (auto &texture : model.textures) {
+    const auto it = texture.extensions.find(kBasisuExtension);
+    if (it != texture.extensions.end() && it->second.IsObject() &&
+        it->second.Get("source").IsNumber()) {
+      const auto source = int(it->second.Get("source").GetNumberAsInt());
+      // Without a usable fallback, the KTX2 image reports why it cannot be
+      // decoded
+      if (source >= 0 && size_t(source) < imageCount &&
+          (isUsable[source] || texture.source < 0)) {
+        texture.source = source;
+      }
+    }
+    if (texture.source >= 0 && size_t(texture.source) < imageCount) {
+      isUsed[texture.source] = true;
+    }
+  }
+  for (size_t imageIdx = 0; imageIdx < imageCount; ++imageIdx) {
+    if (isKtx2Image[imageIdx] && !isUsable[imageIdx] && !isUsed[imageIdx]) {
+      m_PendingImages[imageIdx] = PendingImage{};
+    }
+  }
+}
+
+bool GltfLoader::isCompressedFormatSupported(uint32_t glFormat) const
+{
+  return glFormat != 0 &&
+         std::find(begin(m_CompressedFormats), end(m_CompressedFormats),
+             glFormat) != end(m_CompressedFormats);
+}
+
+bool GltfLoader::setImageFromCache(
+    tinygltf::Image &image, const TextureCache::Entry &entry)
+{
+  // tinygltf decodes all images to RGBA
+  if (entry.components != 4 ||
+      (entry.bitsPerComponent != 8 && entry.bitsPerComponent != 16)) {
+    return false;
+  }
+  image.width = int(entry.levels[0].width);
+  image.height = int(entry.levels[0].height);
+  image.component = int(entry.components);
+  image.bits = int(entry.bitsPerComponent);
+  image.pixel_type = entry.bitsPerComponent == 16
+                         ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                         : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  return true;
+}
+
+bool GltfLoader::decodeAllImages(tinygltf::Model &model, std::string *err)
+{
+  // Each task writes to its own image and error string, no locking needed
+  std::vector<std::string> errors(m_PendingImages.size());
+  std::vector<char> succeeded(m_PendingImages.size(), false);
+  const auto decode = [&](size_t i) {
+    succeeded[i] = decodeImage(model, int(i), &errors[i]);
+  };
+  if (m_pThreadPool) {
+    m_pThreadPool->parallelFor(m_PendingImages.size(), decode);
+  } else {
+    for (size_t i = 0; i < m_PendingImages.size(); ++i) {
+      decode(i);
+    }
+  }
+
+  for (const auto &error : errors) {
+    *err += error;
+  }
+  return std::find(begin(succeeded), end(succeeded), false) == end(succeeded);
+}
+
+bool GltfLoader::decodeDataUris(
+    const std::vector<DataUri> &dataUris, std::string *err) const
+{
+  Timings::Scope timing{m_pTimings, "data URI decode"};
+  std::vector<char> succeeded(dataUris.size(), false);
+  const auto decode = [&](size_t i) {
+    const auto &dataUri = dataUris[i];
+    succeeded[i] = decodeBase64(dataUri.text, dataUri.length, dataUri.output);
+  };
+  if (m_pThreadPool) {
+    m_pThreadPool->parallelFor(dataUris.size(), decode);
+  } else {
+    for (size_t i = 0; i < dataUris.size(); ++i) {
+      decode(i);
+    }
+  }
+  if (std::find(begin(succeeded), end(succeeded), false) != end(succeeded)) {
+    *err += "Invalid base64 data URI.\n";
+    return false;
+  }
+  return true;
+}
+
+bool GltfLoader::decodeMeshoptBufferViews(
+    tinygltf::Model &model, std::vector<bool> &isOwned, std::string *err)
+{
+  std::vector<MeshoptBufferView> bufferViews;
+  for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+    const auto &bufferView = model.bufferViews[i];
+    const auto it = bufferView.extensions.find(kMeshoptExtension);
+    if (it == bufferView.extensions.end()) {
+      continue;
+    }
+    MeshoptBufferView compressed;
+    compressed.bufferViewIdx = i;
+    const auto prefix = "bufferView[" + std::to_string(i) + "] ";
+    if (!parseMeshoptExtension(it->second, compressed)) {
+      *err += prefix + "has an invalid " + kMeshoptExtension + " extension.\n";
+      return false;
+    }
+    const auto destinationIdx = size_t(bufferView.buffer);
+    if (compressed.buffer >= m_BufferSpans.size() ||
+        compressed.byteOffset + compressed.byteLength >
+            m_BufferSpans[compressed.buffer].size ||
+        destinationIdx >= m_BufferSpans.size() ||
+        bufferView.byteOffset + bufferView.byteLength >
+            m_BufferSpans[destinationIdx].size ||
+        compressed.count * compressed.byteStride > bufferView.byteLength) {
+      *err += prefix + "is out of buffer bounds.\n";
+      return false;
+    }
+    bufferViews.emplace_back(compressed);
+  }
+  if (bufferViews.empty()) {
+    return true;
+  }
+
+  Timings::Scope timing{m_pTimings, "meshopt decode"};
+  const auto start = std::chrono::steady_clock::now();
+
+  // Decoded bytes are written to the buffer storage, which gets copied out of
+  // read-only mappings first
+  for (auto &bufferView : bufferViews) {
+    const auto &destinationView = model.bufferViews[bufferView.bufferViewIdx];
+    const auto destinationIdx = size_t(destinationView.buffer);
+    auto &span = m_BufferSpans[destinationIdx];
+    if (!isOwned[destinationIdx]) {
+      m_OwnedBuffers.emplace_back(span.data, span.data + span.size);
+      span.data = m_OwnedBuffers.back().data();
+      isOwned[destinationIdx] = true;
+    }
+    // Owned spans point to m_OwnedBuffers or to model.buffers[i].data
+    bufferView.destination =
+        const_cast<unsigned char *>(span.data) + destinationView.byteOffset;
+  }
+  // Sources are looked up once all copies are made, as a buffer may hold both
+  for (auto &bufferView : bufferViews) {
+    bufferView.source =
+        m_BufferSpans[bufferView.buffer].data + bufferView.byteOffset;
+  }
+
+  std::vector<char> succeeded(bufferViews.size(), false);
+  const auto decode = [&](size_t i) {
+    const auto &bufferView = bufferViews[i];
+    succeeded[i] = decodeMeshopt(bufferView.destination, bufferView.count,
+        bufferView.byteStride, bufferView.source, bufferView.byteLength,
+        bufferView.mode, bufferView.filter);
+  };
+  if (m_pThreadPool) {
+    m_pThreadPool->parallelFor(bufferViews.size(), decode);
+  } else {
+    for (size_t i = 0; i < bufferViews.size(); ++i) {
+      decode(i);
+    }
+  }
+
+  for (size_t i = 0; i < bufferViews.size(); ++i) {
+    if (!succeeded[i]) {
+      *err += "bufferView[" + std::to_string(bufferViews[i].bufferViewIdx) +
+              "] has invalid " + kMeshoptExtension + " data.\n";
+      return false;
+    }
+    m_MeshoptDecodedSize += bufferViews[i].count * bufferViews[i].byteStride;
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  m_MeshoptDecodeSeconds = elapsed.count();
+  return true;
+}
+
+bool GltfLoader::loadImageData(tinygltf::Image *image, const int imageIdx,
+    std::string *, std::string *, int reqWidth, int reqHeight,
+    const unsigned char *bytes, int size, void *userData)
+{
+  // image is a temporary that tinygltf moves to model.images after this call,
+  // so only its index is kept
+  auto *self = (GltfLoader *)userData;
+  if (size_t(imageIdx) >= self->m_PendingImages.size()) {
+    self->m_PendingImages.resize(imageIdx + 1);
+    self->m_ImageHashes.resize(imageIdx + 1);
+  }
+  auto &pendingImage = self->m_PendingImages[imageIdx];
+  pendingImage.pending = true;
+  pendingImage.reqWidth = reqWidth;
+  pendingImage.reqHeight = reqHeight;
+  // The bytes of mapped images are the placeholder given by readWholeFile,
+  // load() sets them to the mapping once it is made
+  if (!isMappedImagePath(image->uri)) {
+    pendingImage.ownedBytes.assign(bytes, bytes + size);
+    pendingImage.bytes = {
+        pendingImage.ownedBytes.data(), pendingImage.ownedBytes.size()};
+  }
+  return true;
+}
+
+bool GltfLoader::fileExists(const std::string &absFilename, void *)
+{
+  return isMappedImagePath(absFilename) ||
+         tinygltf::FileExists(absFilename, nullptr);
+}
+
+std::string GltfLoader::expandFilePath(const std::string &path, void *)
+{
+  return isMappedImagePath(path) ? path
+                                 : tinygltf::ExpandFilePath(path, nullptr);
+}
+
+bool GltfLoader::readWholeFile(std::vector<unsigned char> *out,
+    std::string *err, const std::string &filepath, void *)
+{
+  if (isMappedImagePath(filepath)) {
+    // tinygltf rejects empty images, the mapping is not copied
+    out->assign(1, 0);
+    return true;
+  }
+  return tinygltf::ReadWholeFile(out, err, filepath, nullptr);
+}
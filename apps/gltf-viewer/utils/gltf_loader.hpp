@@ -0,0 +1,216 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "gltf.hpp"
+#include "ktx2.hpp"
+#include "mapped_file.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+#include "timings.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+// Loader for .gltf and .glb files.
+//
+// The file is memory mapped, and so are the buffers stored in the binary chunk
+// of a .glb or in external .bin files: their bytes are not copied to
+// model.buffers[i].data, which is left empty. bufferSpans()[i] gives access to
+// the bytes of buffer i whatever its storage.
+//
+// The JSON text is parsed once, by tinygltf. Mapped buffers and the images
+// stored in them are hidden from it by rewriting their members in a copy of
+// the text, found by a scan that does not parse it.
+// Base64 data URIs of buffers and images are hidden the same way, and decoded
+// from the file mapping directly into storage owned by the loader by a SIMD
+// decoder (see base64.hpp), in parallel on threadPool. Their uri in model only
+// keeps the "data:<media type>;base64," header. Data URIs with JSON escape
+// sequences are left to tinygltf.
+// bufferViews compressed by EXT_meshopt_compression are decoded in parallel on
+// threadPool once the file is parsed, into buffer storage owned by the loader,
+// so that bufferSpans() give the decoded bytes that are uploaded. Buffers
+// flagged as fallback are not loaded.
+// Sparse accessors are then replaced by dense ones, stored in an extra buffer
+// (see sparse_accessors.hpp).
+// The spans remain valid until the loader is destroyed or load() is called
+// again.
+//
+// Images are not decoded while tinygltf parses the file: their encoded bytes
+// are collected and decoded once parsing is done, in parallel on threadPool
+// if one is given. When image decoding is deferred, load() returns with
+// model.images[i].image left empty and decodeImage() must be called for each
+// image.
+//
+// With a texture cache, decoding an image first looks its encoded bytes up in
+// the cache. On a hit the image is not decoded: model.images[i] only gets its
+// size and format, its image vector stays empty and the texels of all mipmap
+// levels are given by cachedImage(i). On a miss the decoded image is stored in
+// the cache.
+//
+// Textures with a KHR_texture_basisu KTX2 image use it in place of their
+// source when it can be used (see ktx2.hpp). Decoding a KTX2 image in a GL
+// format given to setCompressedFormats() keeps its levels as they are, given
+// by compressedImage(i); other formats are decoded to RGBA8 in image.image.
+// KTX2 images bypass the texture cache.
+class GltfLoader
+{
+public:
+  explicit GltfLoader(ThreadPool *threadPool = nullptr) :
+      m_pThreadPool(threadPool)
+  {
+  }
+
+  // Returns false and fill err if the file cannot be loaded
+  bool load(const fs::path &path, tinygltf::Model &model, std::string *err,
+      std::string *warn);
+
+  const std::vector<BufferSpan> &bufferSpans() const { return m_BufferSpans; }
+
+  void setDeferImageDecoding(bool defer) { m_bDeferImageDecoding = defer; }
+
+  // cache must outlive the loader, nullptr disables caching
+  void setTextureCache(const TextureCache *cache) { m_pTextureCache = cache; }
+
+  // GL internal formats that KTX2 images can be uploaded in (see
+  // getSupportedCompressedFormats()), none by default
+  void setCompressedFormats(std::vector<uint32_t> glFormats)
+  {
+    m_CompressedFormats = std::move(glFormats);
+  }
+
+  // Record the time of the "JSON parse", "buffer load", "data URI decode",
+  // "meshopt decode", "sparse accessors" and "image decode" phases of load(),
+  // nullptr to disable
+  void setTimings(Timings *timings) { m_pTimings = timings; }
+
+  // Size of the EXT_meshopt_compression bufferViews decoded by the last load()
+  // and wall-clock time it took
+  size_t meshoptDecodedSize() const { return m_MeshoptDecodedSize; }
+  double meshoptDecodeSeconds() const { return m_MeshoptDecodeSeconds; }
+
+  // Decode image imageIdx of the last loaded model if it has not been decoded
+  // yet. Can be called concurrently for distinct images.
+  bool decodeImage(tinygltf::Model &model, int imageIdx, std::string *err);
+
+  // Set the size and texel format of image imageIdx from its header, as
+  // decodeImage() would, without decoding it: the image stays pending and its
+  // image vector empty. KTX2 images are decoded, which only parses their
+  // levels when their format is given to setCompressedFormats(). Can be
+  // called concurrently for distinct images.
+  bool readImageHeader(
+      tinygltf::Model &model, int imageIdx, std::string *err);
+
+  // Free the bytes of the buffers and images of the last loaded model once
+  // they have been uploaded: model.buffers[i].data, model.images[i].image,
+  // memory mappings and texture cache entries. bufferSpans() becomes empty.
+  // No image must be being decoded.
+  void releaseData(tinygltf::Model &model);
+
+  // Hash of the encoded bytes of image imageIdx (see hashBytes()), kept by
+  // releaseData()
+  uint64_t imageHash(int imageIdx) const
+  {
+    return size_t(imageIdx) < m_ImageHashes.size() ? m_ImageHashes[imageIdx]
+                                                   : 0;
+  }
+
+  // Cache entry of image imageIdx if it has been found in or stored to the
+  // texture cache by decodeImage(), nullptr otherwise
+  const TextureCache::Entry *cachedImage(int imageIdx) const
+  {
+    return size_t(imageIdx) < m_CachedImages.size()
+               ? m_CachedImages[imageIdx].get()
+               : nullptr;
+  }
+
+  // Levels of KTX2 image imageIdx if decodeImage() kept it compressed, nullptr
+  // otherwise
+  const CompressedImage *compressedImage(int imageIdx) const
+  {
+    return size_t(imageIdx) < m_CompressedImages.size()
+               ? m_CompressedImages[imageIdx].get()
+               : nullptr;
+  }
+
+private:
+  // Filesystem callbacks given to tinygltf: images stored in a bufferView of
+  // a mapped buffer or in a base64 data URI are renamed to a fake uri, read
+  // as a placeholder byte, other paths are forwarded to tinygltf default
+  // callbacks
+  static bool fileExists(const std::string &absFilename, void *userData);
+  static std::string expandFilePath(const std::string &path, void *userData);
+  static bool readWholeFile(std::vector<unsigned char> *out, std::string *err,
+      const std::string &filepath, void *userData);
+
+  // Image loader given to tinygltf, store the image in m_PendingImages. The
+  // bytes of images with a fake uri are set by load().
+  static bool loadImageData(tinygltf::Image *image, const int imageIdx,
+      std::string *err, std::string *warn, int reqWidth, int reqHeight,
+      const unsigned char *bytes, int size, void *userData);
+
+  bool decodeAllImages(tinygltf::Model &model, std::string *err);
+
+  // Base64 text of a data URI hidden from tinygltf
+  struct DataUri
+  {
+    const char *text = nullptr; // Points to the file mapping
+    size_t length = 0;
+    size_t decodedSize = 0;
+    unsigned char *output = nullptr; // Points to m_OwnedBuffers
+  };
+
+  bool decodeDataUris(
+      const std::vector<DataUri> &dataUris, std::string *err) const;
+
+  // Decode the bufferViews compressed by EXT_meshopt_compression into the
+  // storage of their buffer, copied to m_OwnedBuffers if not already there
+  bool decodeMeshoptBufferViews(tinygltf::Model &model,
+      std::vector<bool> &isOwned, std::string *err);
+
+  // Replace the source of textures by their KHR_texture_basisu image when it
+  // can be used, and skip decoding of the KTX2 images that cannot and that no
+  // texture uses
+  void selectKtx2Sources(tinygltf::Model &model);
+
+  bool isCompressedFormatSupported(uint32_t glFormat) const;
+
+  // Fill image from a cache entry, returns false if the entry does not match
+  // what tinygltf would have decoded
+  static bool setImageFromCache(
+      tinygltf::Image &image, const TextureCache::Entry &entry);
+
+  // Encoded image waiting to be decoded
+  struct PendingImage
+  {
+    bool pending = false;
+    int reqWidth = 0, reqHeight = 0;
+    BufferSpan bytes; // Points either to a mapping or to ownedBytes
+    std::vector<unsigned char> ownedBytes;
+  };
+
+  bool decodeKtx2Image(tinygltf::Image &image, int imageIdx,
+      PendingImage &pendingImage, std::string *err);
+
+  ThreadPool *m_pThreadPool = nullptr;
+  bool m_bDeferImageDecoding = false;
+  const TextureCache *m_pTextureCache = nullptr;
+  std::vector<uint32_t> m_CompressedFormats;
+  Timings *m_pTimings = nullptr;
+  std::vector<PendingImage> m_PendingImages; // Indexed by image index
+  std::vector<uint64_t> m_ImageHashes; // Indexed by image index
+  std::vector<MappedFile> m_MappedFiles;
+  std::vector<BufferSpan> m_BufferSpans;
+  std::vector<BufferSpan> m_MappedImages; // Indexed by image index
+  // Bytes of the data URIs of buffers and images, and of the buffers that
+  // EXT_meshopt_compression bufferViews are decoded to
+  std::vector<std::vector<unsigned char>> m_OwnedBuffers;
+  size_t m_MeshoptDecodedSize = 0;
+  double m_MeshoptDecodeSeconds = 0.;
+  // Indexed by image index
+  std::vector<std::unique_ptr<TextureCache::Entry>> m_CachedImages;
+  // Indexed by image index
+  std::vector<std::unique_ptr<CompressedImage>> m_CompressedImages;
+};
@@ -0,0 +1,213 @@
+#include "gpu_buffers.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace
+{
+
+const uint64_t kRangeAlignment = 16;
+
+uint64_t alignUp(uint64_t value)
+{
+  return (value + kRangeAlignment - 1) / kRangeAlignment * kRangeAlignment;
+}
+
+void addRange(const Scene &scene, int32_t sceneBuffer, uint64_t byteOffset,
+    uint64_t byteLength, std::vector<GpuBufferLayout::Range> &ranges)
+{
+  if (sceneBuffer < 0 || size_t(sceneBuffer) >= scene.buffers.size() ||
+      byteLength == 0) {
+    return;
+  }
+  // Bytes out of the buffer are left to GL, as before packing
+  const uint64_t bufferSize = scene.buffers[sceneBuffer].size;
+  if (byteOffset >= bufferSize) {
+    return;
+  }
+  GpuBufferLayout::Range range;
+  range.sceneBuffer = sceneBuffer;
+  range.byteOffset = byteOffset / kRangeAlignment * kRangeAlignment;
+  range.byteLength =
+      std::min(byteOffset + byteLength, bufferSize) - range.byteOffset;
+  ranges.push_back(range);
+}
+
+} // namespace
+
+uint64_t GpuBufferLayout::uploadedSize() const
+{
+  uint64_t size = 0;
+  for (const auto bufferSize : gpuBufferSizes) {
+    size += bufferSize;
+  }
+  return size;
+}
+
+GpuBufferLayout computeGpuBufferLayout(
+    const Scene &scene, uint64_t maxBufferSize)
+{
+  std::vector<GpuBufferLayout::Range> ranges;
+  for (const auto &primitive : scene.primitives) {
+    if (primitive.vertexCount > 0) {
+      for (const auto &attrib : primitive.attributes) {
+        const uint64_t elementSize =
+            uint64_t(std::max(attrib.size, 0)) *
+            std::max(tinygltf::GetComponentSizeInBytes(attrib.componentType),
+                0);
+        const uint64_t byteStride =
+            attrib.byteStride > 0 ? uint64_t(attrib.byteStride) : elementSize;
+        addRange(scene, attrib.buffer, attrib.byteOffset,
+            (primitive.vertexCount - 1) * byteStride + elementSize, ranges);
+      }
+    }
+    if (primitive.indexBuffer >= 0) {
+      const uint64_t indexSize = uint64_t(std::max(
+          tinygltf::GetComponentSizeInBytes(primitive.indexType), 0));
+      addRange(scene, primitive.indexBuffer, primitive.indexByteOffset,
+          primitive.count * indexSize, ranges);
+    }
+  }
+
+  // Ranges closer than the alignment padding are merged
+  std::sort(begin(ranges), end(ranges),
+      [](const GpuBufferLayout::Range &a, const GpuBufferLayout::Range &b) {
+        return std::tie(a.sceneBuffer, a.byteOffset) <
+               std::tie(b.sceneBuffer, b.byteOffset);
+      });
+  GpuBufferLayout layout;
+  for (const auto &range : ranges) {
+    if (!layout.ranges.empty()) {
+      auto &last = layout.ranges.back();
+      const auto lastEnd = last.byteOffset + last.byteLength;
+      if (last.sceneBuffer == range.sceneBuffer &&
+          range.byteOffset <= alignUp(lastEnd)) {
+        last.byteLength =
+            std::max(lastEnd, range.byteOffset + range.byteLength) -
+            last.byteOffset;
+        continue;
+      }
+    }
+    layout.ranges.push_back(range);
+  }
+
+  for (auto &range : layout.ranges) {
+    if (layout.gpuBufferSizes.empty() ||
+        (layout.gpuBufferSizes.back() > 0 &&
+            alignUp(layout.gpuBufferSizes.back()) + range.byteLength >
+                maxBufferSize)) {
+      layout.gpuBufferSizes.push_back(0);
+    }
+    auto &bufferSize = layout.gpuBufferSizes.back();
+    range.gpuBuffer = uint32_t(layout.gpuBufferSizes.size() - 1);
+    range.gpuByteOffset = alignUp(bufferSize);
+    bufferSize = range.gpuByteOffset + range.byteLength;
+  }
+  return layout;
+}
+
+void GpuBuffers::upload(const Scene &scene, uint64_t maxBufferSize)
+{
+  clear();
+  m_MaxBufferSize = maxBufferSize;
+  m_Layout = computeGpuBufferLayout(scene, maxBufferSize);
+  m_BufferObjects.resize(m_Layout.gpuBufferSizes.size(), 0);
+  glGenBuffers(GLsizei(m_BufferObjects.size()), m_BufferObjects.data());
+  for (size_t i = 0; i < m_BufferObjects.size(); ++i) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_BufferObjects[i]);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_Layout.gpuBufferSizes[i]),
+        nullptr, GL_STATIC_DRAW);
+  }
+  for (const auto &range : m_Layout.ranges) {
+    uploadRange(scene, range);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool GpuBuffers::update(
+    const Scene &scene, const std::vector<size_t> &bufferIndices)
+{
+  const auto layout = computeGpuBufferLayout(scene, m_MaxBufferSize);
+  if (layout.ranges != m_Layout.ranges ||
+      layout.gpuBufferSizes != m_Layout.gpuBufferSizes) {
+    upload(scene, m_MaxBufferSize);
+    return false;
+  }
+  for (const auto &range : m_Layout.ranges) {
+    if (std::find(begin(bufferIndices), end(bufferIndices),
+            size_t(range.sceneBuffer)) != end(bufferIndices)) {
+      uploadRange(scene, range);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return true;
+}
+
+void GpuBuffers::clear()
+{
+  if (!m_BufferObjects.empty()) {
+    glDeleteBuffers(GLsizei(m_BufferObjects.size()), m_BufferObjects.data());
+  }
+  m_BufferObjects.clear();
+  m_Layout = GpuBufferLayout{};
+}
+
+bool GpuBuffers::locate(int32_t sceneBuffer, uint64_t byteOffset,
+    GLuint &bufferObject, uint64_t &gpuByteOffset) const
+{
+  // Last range starting at or before the byte
+  const auto it = std::upper_bound(begin(m_Layout.ranges),
+      end(m_Layout.ranges), std::make_tuple(sceneBuffer, byteOffset),
+      [](const std::tuple<int32_t, uint64_t> &key,
+          const GpuBufferLayout::Range &range) {
+        return key < std::tie(range.sceneBuffer, range.byteOffset);
+      });
+  if (it == begin(m_Layout.ranges)) {
+    return false;
+  }
+  const auto &range = *(it - 1);
+  if (range.sceneBuffer != sceneBuffer ||
+      byteOffset >= range.byteOffset + range.byteLength) {
+    return false;
+  }
+  bufferObject = m_BufferObjects[range.gpuBuffer];
+  gpuByteOffset = range.gpuByteOffset + (byteOffset - range.byteOffset);
+  return true;
+}
+
+void GpuBuffers::uploadRange(
+    const Scene &scene, const GpuBufferLayout::Range &range)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, m_BufferObjects[range.gpuBuffer]);
+  glBufferSubData(GL_ARRAY_BUFFER, GLintptr(range.gpuByteOffset),
+      GLsizeiptr(range.byteLength),
+      scene.buffers[range.sceneBuffer].data + range.byteOffset);
+}
+
+uint64_t setupVertexArrayObject(
+    const Scene::Primitive &primitive, const GpuBuffers &gpuBuffers)
+{
+  GLuint bufferObject = 0;
+  uint64_t byteOffset = 0;
+  for (GLuint attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &attrib = primitive.attributes[attribIdx];
+    if (attrib.buffer < 0 || !gpuBuffers.locate(attrib.buffer,
+                                 attrib.byteOffset, bufferObject, byteOffset)) {
+      continue;
+    }
+    glEnableVertexAttribArray(attribIdx);
+    glBindBuffer(GL_ARRAY_BUFFER, bufferObject);
+    // Quantized attributes are fetched as they are stored, the GPU converts
+    // them to float
+    glVertexAttribPointer(attribIdx, attrib.size, attrib.componentType,
+        GLboolean(attrib.normalized), attrib.byteStride,
+        (const GLvoid *)byteOffset);
+  }
+  if (primitive.indexBuffer >= 0 &&
+      gpuBuffers.locate(primitive.indexBuffer, primitive.indexByteOffset,
+          bufferObject, byteOffset)) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferObject);
+    return byteOffset;
+  }
+  return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// Placement in GL buffers of the bytes of scene buffers that vertex
+// attributes and indices of primitives reference. Other bytes (images stored
+// in a .glb, animations, unused data) are not uploaded.
+//
+// Referenced bytes of a scene buffer are merged into ranges, which start on a
+// 16-byte boundary both in the scene buffer and in the GL buffer so that
+// attributes and indices keep their alignment. Ranges are packed one after
+// the other into GL buffers of at most maxBufferSize bytes, larger ranges
+// getting a buffer of their own.
+struct GpuBufferLayout
+{
+  struct Range
+  {
+    int32_t sceneBuffer = -1; // Index in Scene::buffers
+    uint64_t byteOffset = 0; // In the scene buffer
+    uint64_t byteLength = 0;
+    uint32_t gpuBuffer = 0; // Index in gpuBufferSizes
+    uint64_t gpuByteOffset = 0;
+
+    bool operator==(const Range &other) const
+    {
+      return sceneBuffer == other.sceneBuffer &&
+             byteOffset == other.byteOffset &&
+             byteLength == other.byteLength && gpuBuffer == other.gpuBuffer &&
+             gpuByteOffset == other.gpuByteOffset;
+    }
+  };
+
+  std::vector<Range> ranges; // Sorted by scene buffer and byte offset
+  std::vector<uint64_t> gpuBufferSizes;
+
+  // Bytes uploaded, including alignment padding
+  uint64_t uploadedSize() const;
+};
+
+const uint64_t kDefaultGpuBufferSize = 256 * 1024 * 1024;
+
+GpuBufferLayout computeGpuBufferLayout(
+    const Scene &scene, uint64_t maxBufferSize = kDefaultGpuBufferSize);
+
+// GL buffers holding the vertex attributes and indices of a scene, see
+// GpuBufferLayout. Needs a current GL context, from construction to
+// destruction.
+class GpuBuffers
+{
+public:
+  GpuBuffers() = default;
+
+  ~GpuBuffers() { clear(); }
+
+  GpuBuffers(const GpuBuffers &) = delete;
+
+  GpuBuffers &operator=(const GpuBuffers &) = delete;
+
+  // Upload the referenced bytes of scene.buffers to new buffer objects of at
+  // most maxBufferSize bytes (see GpuBufferLayout), deleting the current ones
+  void upload(
+      const Scene &scene, uint64_t maxBufferSize = kDefaultGpuBufferSize);
+
+  // Upload again the ranges of the scene buffers bufferIndices if the layout
+  // of scene is the same as the current one: buffer objects and offsets then
+  // stay valid. Otherwise upload everything with upload(), with the same
+  // maxBufferSize, and return false.
+  bool update(const Scene &scene, const std::vector<size_t> &bufferIndices);
+
+  void clear();
+
+  // Buffer object and offset in it of byte byteOffset of scene buffer
+  // sceneBuffer. Returns false if that byte has not been uploaded.
+  bool locate(int32_t sceneBuffer, uint64_t byteOffset, GLuint &bufferObject,
+      uint64_t &gpuByteOffset) const;
+
+  const GpuBufferLayout &layout() const { return m_Layout; }
+
+private:
+  void uploadRange(const Scene &scene, const GpuBufferLayout::Range &range);
+
+  GpuBufferLayout m_Layout;
+  uint64_t m_MaxBufferSize = kDefaultGpuBufferSize;
+  std::vector<GLuint> m_BufferObjects; // Indexed like gpuBufferSizes
+};
+
+// Set up the vertex array object currently bound to read the attributes and
+// indices of primitive from gpuBuffers. Returns the offset of the indices of
+// primitive in its element array buffer.
+uint64_t setupVertexArrayObject(
+    const Scene::Primitive &primitive, const GpuBuffers &gpuBuffers);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 64-bit FNV-1a style hash of a byte range, processing 8 bytes at a time.
+// Meant to identify content (cache keys, change detection), not for security.
+inline uint64_t hashBytes(
+    const unsigned char *bytes, size_t size, uint64_t seed = 0)
+{
+  const uint64_t prime = 0x100000001b3ull;
+  uint64_t hash = 0xcbf29ce484222325ull ^ seed;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29;
+  }
+  for (; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * prime;
+  }
+  hash ^= uint64_t(size);
+  hash *= prime;
+  return hash ^ (hash >> 32);
+}
+
+// Hexadecimal representation of a hash, usable as a file name
+inline std::string hashToString(uint64_t hash)
+{
+  static const char digits[] = "0123456789abcdef";
+  std::string str(16, '0');
+  for (int i = 15; i >= 0; --i, hash >>= 4) {
+    str[i] = digits[hash & 0xf];
+  }
+  return str;
+}
@@ -0,0 +1,162 @@
+#include "hot_reload.hpp"
+#include "gltf.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+
+std::vector<size_t> allIndices(size_t count)
+{
+  std::vector<size_t> indices(count);
+  std::iota(begin(indices), end(indices), size_t(0));
+  return indices;
+}
+
+uint64_t getImageHash(const SceneHashes &hashes, int32_t imageIdx)
+{
+  return imageIdx >= 0 && size_t(imageIdx) < hashes.images.size()
+             ? hashes.images[imageIdx]
+             : 0;
+}
+
+} // namespace
+
+SceneHashes computeSceneHashes(const Scene &scene,
+    const tinygltf::Model &model, const GltfLoader &loader)
+{
+  SceneHashes hashes;
+  for (const auto &buffer : scene.buffers) {
+    hashes.buffers.push_back(hashBytes(buffer.data, buffer.size));
+  }
+  for (size_t imageIdx = 0; imageIdx < model.images.size(); ++imageIdx) {
+    hashes.images.push_back(loader.imageHash(int(imageIdx)));
+  }
+  return hashes;
+}
+
+SceneDiff diffScenes(const Scene &oldScene, const SceneHashes &oldHashes,
+    const Scene &newScene, const SceneHashes &newHashes)
+{
+  SceneDiff diff;
+
+  diff.buffersResized = oldHashes.buffers.size() != newHashes.buffers.size();
+  if (diff.buffersResized) {
+    diff.buffers = allIndices(newHashes.buffers.size());
+  } else {
+    for (size_t i = 0; i < newHashes.buffers.size(); ++i) {
+      if (oldHashes.buffers[i] != newHashes.buffers[i]) {
+        diff.buffers.push_back(i);
+      }
+    }
+  }
+
+  // Vertex array objects reference buffer objects by name: re-uploading the
+  // data of a buffer does not require to set them up again, unless buffer
+  // objects are all created again
+  diff.primitivesResized =
+      diff.buffersResized ||
+      oldScene.primitives.size() != newScene.primitives.size();
+  if (diff.primitivesResized) {
+    diff.primitives = allIndices(newScene.primitives.size());
+  } else {
+    for (size_t i = 0; i < newScene.primitives.size(); ++i) {
+      // Records are trivially copyable and have no padding
+      if (std::memcmp(&oldScene.primitives[i], &newScene.primitives[i],
+              sizeof(Scene::Primitive)) != 0) {
+        diff.primitives.push_back(i);
+      }
+    }
+  }
+
+  diff.texturesResized = oldScene.textures.size() != newScene.textures.size();
+  if (diff.texturesResized) {
+    diff.textures = allIndices(newScene.textures.size());
+  } else {
+    for (size_t i = 0; i < newScene.textures.size(); ++i) {
+      const auto &oldTexture = oldScene.textures[i];
+      const auto &newTexture = newScene.textures[i];
+      if (std::memcmp(&oldTexture, &newTexture, sizeof(Scene::Texture)) != 0 ||
+          getImageHash(oldHashes, oldTexture.image) !=
+              getImageHash(newHashes, newTexture.image)) {
+        diff.textures.push_back(i);
+      }
+    }
+  }
+
+  return diff;
+}
+
+std::future<std::unique_ptr<ReloadedGltf>> reloadGltfFile(const fs::path &path,
+    ThreadPool *threadPool, const TextureCache *textureCache,
+    std::vector<uint32_t> compressedFormats, GeometryOptions geometryOptions,
+    Scene currentScene, SceneHashes currentHashes)
+{
+  // Not a task of threadPool, so that image decoding can use parallelFor()
+  currentScene.buffers.clear(); // May have been released, never read
+  return std::async(std::launch::async, [=]() {
+    auto result = std::make_unique<ReloadedGltf>();
+    auto &loader = result->loader;
+    auto &model = result->model;
+    loader = GltfLoader{threadPool};
+    loader.setTextureCache(textureCache);
+    loader.setCompressedFormats(compressedFormats);
+    loader.setDeferImageDecoding(true);
+    if (!loader.load(path, model, &result->error, &result->warning)) {
+      return result;
+    }
+
+    auto &scene = result->scene;
+    scene = extractScene(model, loader.bufferSpans());
+    computeSceneBounds(model, loader.bufferSpans(), scene);
+    applyGeometryOptions(scene, geometryOptions, result->geometryStorage,
+        threadPool, nullptr);
+    result->hashes = computeSceneHashes(scene, model, loader);
+    result->diff =
+        diffScenes(currentScene, currentHashes, scene, result->hashes);
+
+    // Images shared by changed and unchanged textures are decoded once
+    std::vector<int> images;
+    for (const auto textureIdx : result->diff.textures) {
+      const auto imageIdx = scene.textures[textureIdx].image;
+      if (imageIdx >= 0 && std::find(begin(images), end(images), imageIdx) ==
+                               end(images)) {
+        images.push_back(imageIdx);
+      }
+    }
+    std::vector<std::string> errors(images.size());
+    threadPool->parallelFor(images.size(), [&](size_t i) {
+      loader.decodeImage(model, images[i], &errors[i]);
+    });
+    for (const auto &error : errors) {
+      result->warning += error;
+    }
+
+    result->succeeded = true;
+    return result;
+  });
+}
+
+std::vector<fs::path> getGltfFileDependencies(
+    const fs::path &path, const tinygltf::Model &model)
+{
+  std::vector<fs::path> dependencies{path};
+  const auto baseDir = path.parent_path();
+  const auto addUri = [&](const std::string &uri) {
+    // GltfLoader only keeps the header of data URIs, which tinygltf may not
+    // recognize
+    if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+      dependencies.emplace_back(baseDir / uri);
+    }
+  };
+  for (const auto &buffer : model.buffers) {
+    addUri(buffer.uri);
+  }
+  for (const auto &image : model.images) {
+    addUri(image.uri);
+  }
+  return dependencies;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "geometry_options.hpp"
+#include "gltf_loader.hpp"
+#include "scene.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+// Incremental reload of a glTF file edited while it is displayed: the file is
+// parsed again in background and compared with the displayed scene so that
+// only the GL objects whose data changed are uploaded again.
+
+// Content hashes of the data uploaded to GL objects for a scene
+struct SceneHashes
+{
+  std::vector<uint64_t> buffers; // Indexed like Scene::buffers
+  std::vector<uint64_t> images; // Of encoded bytes, indexed like model.images
+};
+
+// buffers of scene must still be valid, images of model must have been loaded
+// by loader
+SceneHashes computeSceneHashes(const Scene &scene,
+    const tinygltf::Model &model, const GltfLoader &loader);
+
+// GL objects to update after a reload. The index lists give what changed; when
+// a count changed, the corresponding resized flag is set and the lists hold
+// all indices so that every object of that kind is created again.
+struct SceneDiff
+{
+  bool buffersResized = false;
+  std::vector<size_t> buffers;
+  bool primitivesResized = false;
+  std::vector<size_t> primitives; // Vertex array objects
+  bool texturesResized = false;
+  std::vector<size_t> textures;
+
+  bool empty() const
+  {
+    return buffers.empty() && primitives.empty() && textures.empty();
+  }
+};
+
+// Materials, nodes and meshes are plain records and need no diff: they are
+// replaced as a whole.
+SceneDiff diffScenes(const Scene &oldScene, const SceneHashes &oldHashes,
+    const Scene &newScene, const SceneHashes &newHashes);
+
+// Result of a background reload. On success scene.buffers point to the
+// mappings of loader and to geometryStorage, and the images of the textures in
+// diff.textures are decoded (the others are not).
+struct ReloadedGltf
+{
+  bool succeeded = false;
+  std::string error, warning;
+  GltfLoader loader;
+  tinygltf::Model model;
+  Scene scene;
+  // See applyGeometryOptions()
+  std::vector<std::vector<unsigned char>> geometryStorage;
+  SceneHashes hashes;
+  SceneDiff diff;
+};
+
+// Load path on a dedicated thread, diff it with the displayed scene described
+// by currentScene and currentHashes, and decode only the images of changed
+// textures. threadPool must not be null. It and textureCache (null to disable
+// caching) must outlive the returned future. compressedFormats are given to
+// GltfLoader::setCompressedFormats(), geometryOptions are applied as to the
+// displayed scene.
+std::future<std::unique_ptr<ReloadedGltf>> reloadGltfFile(const fs::path &path,
+    ThreadPool *threadPool, const TextureCache *textureCache,
+    std::vector<uint32_t> compressedFormats, GeometryOptions geometryOptions,
+    Scene currentScene, SceneHashes currentHashes);
+
+// Files a glTF file depends on: itself and its external buffers and images
+std::vector<fs::path> getGltfFileDependencies(
+    const fs::path &path, const tinygltf::Model &model);
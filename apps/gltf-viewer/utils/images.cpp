@@ -1,8 +1,76 @@
 #include "images.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <glad/glad.h>
 #include <iostream>
+#include <vector>
+
+namespace
+{
+
+template <typename ComponentType>
+void downsample(const ComponentType *src, uint32_t srcWidth, uint32_t srcHeight,
+    ComponentType *dst, uint32_t dstWidth, uint32_t dstHeight,
+    uint32_t components)
+{
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    const uint32_t y0 = std::min(2 * y, srcHeight - 1);
+    const uint32_t y1 = std::min(2 * y + 1, srcHeight - 1);
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+      const uint32_t x0 = std::min(2 * x, srcWidth - 1);
+      const uint32_t x1 = std::min(2 * x + 1, srcWidth - 1);
+      for (uint32_t c = 0; c < components; ++c) {
+        const uint32_t sum = src[(y0 * srcWidth + x0) * components + c] +
+                             src[(y0 * srcWidth + x1) * components + c] +
+                             src[(y1 * srcWidth + x0) * components + c] +
+                             src[(y1 * srcWidth + x1) * components + c];
+        dst[(y * dstWidth + x) * components + c] = ComponentType((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+template <typename ComponentType>
+void computeMipmaps(uint32_t width, uint32_t height, uint32_t components,
+    const ComponentType *texels,
+    const std::function<void(uint32_t, uint32_t, uint32_t,
+        const unsigned char *, size_t)> &onLevel)
+{
+  onLevel(0, width, height, (const unsigned char *)texels,
+      size_t(width) * height * components * sizeof(ComponentType));
+  std::vector<ComponentType> previous, current;
+  const ComponentType *src = texels;
+  for (uint32_t level = 1; width > 1 || height > 1; ++level) {
+    const uint32_t levelWidth = std::max(width / 2, 1u);
+    const uint32_t levelHeight = std::max(height / 2, 1u);
+    current.resize(size_t(levelWidth) * levelHeight * components);
+    downsample(src, width, height, current.data(), levelWidth, levelHeight,
+        components);
+    onLevel(level, levelWidth, levelHeight,
+        (const unsigned char *)current.data(),
+        current.size() * sizeof(ComponentType));
+    std::swap(previous, current);
+    src = previous.data();
+    width = levelWidth;
+    height = levelHeight;
+  }
+}
+
+} // namespace
+
+void computeMipmaps(uint32_t width, uint32_t height, uint32_t components,
+    uint32_t bitsPerComponent, const unsigned char *texels,
+    const std::function<void(uint32_t, uint32_t, uint32_t,
+        const unsigned char *, size_t)> &onLevel)
+{
+  if (bitsPerComponent == 16) {
+    computeMipmaps(
+        width, height, components, (const uint16_t *)texels, onLevel);
+  } else {
+    computeMipmaps(width, height, components, texels, onLevel);
+  }
+}
 
 void renderToImage(size_t width, size_t height, size_t numComponents,
     unsigned char *outPixels, std::function<void()> drawScene)
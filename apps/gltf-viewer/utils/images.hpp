@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 
 template <typename ComponentType>
@@ -17,6 +19,15 @@ void flipImageYAxis(
   }
 }
 
+// Compute the mipmap chain of an image with a 2x2 box filter, clamping at the
+// borders for odd sizes. bitsPerComponent must be 8 or 16.
+// onLevel(level, width, height, texels, byteCount) is called for each level,
+// from the image itself (level 0) to 1x1.
+void computeMipmaps(uint32_t width, uint32_t height, uint32_t components,
+    uint32_t bitsPerComponent, const unsigned char *texels,
+    const std::function<void(uint32_t, uint32_t, uint32_t,
+        const unsigned char *, size_t)> &onLevel);
+
 void renderToImage(size_t width, size_t height, size_t numComponents,
     unsigned char *outPixels, std::function<void()> drawScene);
 // Setup GL state in order to render in texture, call drawScene() then get the
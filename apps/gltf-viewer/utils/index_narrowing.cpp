@@ -0,0 +1,137 @@
+#include "index_narrowing.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+
+namespace
+{
+
+// Primitive restart is never enabled, glTF having no restart index, so all
+// 16-bit values are valid indices
+const uint32_t kMaxNarrowIndex = 65535;
+
+// Indices of one or more primitives
+struct IndexList
+{
+  size_t primitive = 0; // First one using them
+  bool narrowable = false;
+  uint32_t minIndex = 0; // Subtracted from the narrowed indices
+  uint64_t byteOffset = 0; // Of the narrowed indices in storage
+};
+
+const unsigned char *getIndexBytes(
+    const Scene &scene, const Scene::Primitive &primitive)
+{
+  if (size_t(primitive.indexBuffer) >= scene.buffers.size() ||
+      primitive.indexByteOffset + uint64_t(primitive.count) * 4 >
+          scene.buffers[primitive.indexBuffer].size) {
+    return nullptr;
+  }
+  return scene.buffers[primitive.indexBuffer].data + primitive.indexByteOffset;
+}
+
+void findIndexRange(const Scene &scene, IndexList &list)
+{
+  const auto &primitive = scene.primitives[list.primitive];
+  const auto *bytes = getIndexBytes(scene, primitive);
+  if (!bytes || primitive.count == 0) {
+    return;
+  }
+  uint32_t minIndex = std::numeric_limits<uint32_t>::max(), maxIndex = 0;
+  for (uint32_t i = 0; i < primitive.count; ++i) {
+    uint32_t index;
+    std::memcpy(&index, bytes + 4 * i, 4);
+    minIndex = std::min(minIndex, index);
+    maxIndex = std::max(maxIndex, index);
+  }
+  list.minIndex = maxIndex <= kMaxNarrowIndex ? 0 : minIndex;
+  list.narrowable = maxIndex - list.minIndex <= kMaxNarrowIndex;
+}
+
+void writeNarrowIndices(
+    const Scene &scene, const IndexList &list, unsigned char *storage)
+{
+  const auto &primitive = scene.primitives[list.primitive];
+  const auto *bytes = getIndexBytes(scene, primitive);
+  auto *output = storage + list.byteOffset;
+  for (uint32_t i = 0; i < primitive.count; ++i) {
+    uint32_t index;
+    std::memcpy(&index, bytes + 4 * i, 4);
+    const auto narrowIndex = uint16_t(index - list.minIndex);
+    std::memcpy(output + 2 * i, &narrowIndex, 2);
+  }
+}
+
+} // namespace
+
+void narrowIndices(
+    Scene &scene, std::vector<unsigned char> &storage, ThreadPool *threadPool)
+{
+  std::map<std::tuple<int32_t, uint64_t, uint32_t>, size_t> listIndices;
+  std::vector<IndexList> lists;
+  std::vector<int64_t> primitiveLists(scene.primitives.size(), -1);
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    const auto &primitive = scene.primitives[primIdx];
+    if (primitive.indexBuffer < 0 ||
+        primitive.indexType != GL_UNSIGNED_INT) {
+      continue;
+    }
+    const auto key = std::make_tuple(
+        primitive.indexBuffer, primitive.indexByteOffset, primitive.count);
+    const auto it = listIndices.emplace(key, lists.size()).first;
+    if (it->second == lists.size()) {
+      IndexList list;
+      list.primitive = primIdx;
+      lists.push_back(list);
+    }
+    primitiveLists[primIdx] = int64_t(it->second);
+  }
+
+  const auto forEachList = [&](const auto &f) {
+    if (threadPool) {
+      threadPool->parallelFor(lists.size(), f);
+    } else {
+      for (size_t i = 0; i < lists.size(); ++i) {
+        f(i);
+      }
+    }
+  };
+  forEachList([&](size_t i) { findIndexRange(scene, lists[i]); });
+
+  // Packed one after the other, 4-byte aligned
+  uint64_t storageSize = 0;
+  for (auto &list : lists) {
+    if (list.narrowable) {
+      list.byteOffset = storageSize;
+      storageSize += (uint64_t(scene.primitives[list.primitive].count) * 2 +
+                         3) / 4 * 4;
+    }
+  }
+  if (storageSize == 0) {
+    return;
+  }
+  storage.assign(storageSize, 0);
+  forEachList([&](size_t i) {
+    if (lists[i].narrowable) {
+      writeNarrowIndices(scene, lists[i], storage.data());
+    }
+  });
+
+  const auto bufferIdx = int32_t(scene.buffers.size());
+  scene.buffers.push_back({storage.data(), storage.size()});
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    if (primitiveLists[primIdx] < 0 ||
+        !lists[primitiveLists[primIdx]].narrowable) {
+      continue;
+    }
+    const auto &list = lists[primitiveLists[primIdx]];
+    auto &primitive = scene.primitives[primIdx];
+    primitive.indexBuffer = bufferIdx;
+    primitive.indexType = GL_UNSIGNED_SHORT;
+    primitive.indexByteOffset = list.byteOffset;
+    primitive.baseVertex += int32_t(list.minIndex);
+  }
+}
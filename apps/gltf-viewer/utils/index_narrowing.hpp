@@ -0,0 +1,22 @@
+#pragma once
+
+#include "scene.hpp"
+#include "thread_pool.hpp"
+
+#include <vector>
+
+// Rewrite the 32-bit indices of primitives as 16-bit ones when the range of
+// their values fits, which halves the bytes uploaded and fetched for them.
+// Primitives whose indices exceed 16 bits but span at most 65536 vertices
+// are rebased: their smallest index becomes their baseVertex (see
+// glDrawElementsBaseVertex()). Primitive restart must stay disabled, 65535
+// being a valid narrowed index.
+//
+// Narrowed indices are packed into storage, which is appended to
+// scene.buffers: they are uploaded as one compact index range, the 32-bit
+// ones not being referenced anymore. Primitives with the same indices share
+// their narrowed ones. Indices out of the bounds of their buffer are left
+// unchanged. Indices are narrowed in parallel on threadPool if not null.
+// storage must stay alive and unchanged as long as scene.buffers are used.
+void narrowIndices(
+    Scene &scene, std::vector<unsigned char> &storage, ThreadPool *threadPool);
@@ -0,0 +1,287 @@
+#include "ktx2.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+const unsigned char kKtx2Identifier[12] = {
+    0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a};
+
+const size_t kHeaderSize = 80; // Identifier, header and index
+const size_t kLevelIndexEntrySize = 24;
+
+// VkFormat values
+const uint32_t kVkFormatR8G8B8A8Unorm = 37;
+const uint32_t kVkFormatR8G8B8A8Srgb = 43;
+const uint32_t kVkFormatBc1RgbUnorm = 131;
+const uint32_t kVkFormatBc1RgbSrgb = 132;
+const uint32_t kVkFormatBc1RgbaUnorm = 133;
+const uint32_t kVkFormatBc1RgbaSrgb = 134;
+const uint32_t kVkFormatBc3Unorm = 137;
+const uint32_t kVkFormatBc3Srgb = 138;
+const uint32_t kVkFormatBc4Unorm = 139;
+const uint32_t kVkFormatBc5Unorm = 141;
+const uint32_t kVkFormatBc7Unorm = 145;
+const uint32_t kVkFormatBc7Srgb = 146;
+
+uint32_t readUint32(const unsigned char *bytes)
+{
+  uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+uint64_t readUint64(const unsigned char *bytes)
+{
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+// Bytes per 4x4 block, 0 for uncompressed formats
+size_t getBlockSize(uint32_t glFormat)
+{
+  switch (glFormat) {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RED_RGTC1:
+    return 8;
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_RG_RGTC2:
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+size_t getLevelSize(uint32_t glFormat, uint32_t width, uint32_t height)
+{
+  const auto blockSize = getBlockSize(glFormat);
+  return blockSize ? size_t((width + 3) / 4) * ((height + 3) / 4) * blockSize
+                   : size_t(width) * height * 4;
+}
+
+// Decode the 4x4 RGB(A) texels of a BC1 block. The 3-color mode has
+// transparent black texels only if hasAlpha, the color blocks of BC3 always
+// use the 4-color mode.
+void decodeBc1Block(const unsigned char *block, bool hasAlpha,
+    bool isBc3Color, unsigned char texels[16][4])
+{
+  const uint32_t c0 = block[0] | (block[1] << 8);
+  const uint32_t c1 = block[2] | (block[3] << 8);
+  unsigned char palette[4][4];
+  for (int i = 0; i < 2; ++i) {
+    // Expand 5:6:5 to 8 bits per channel
+    const uint32_t c = i == 0 ? c0 : c1;
+    const uint32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    palette[i][0] = (unsigned char)((r << 3) | (r >> 2));
+    palette[i][1] = (unsigned char)((g << 2) | (g >> 4));
+    palette[i][2] = (unsigned char)((b << 3) | (b >> 2));
+    palette[i][3] = 255;
+  }
+  const bool fourColors = c0 > c1 || isBc3Color;
+  for (int k = 0; k < 3; ++k) {
+    if (fourColors) {
+      palette[2][k] = (unsigned char)((2 * palette[0][k] + palette[1][k]) / 3);
+      palette[3][k] = (unsigned char)((palette[0][k] + 2 * palette[1][k]) / 3);
+    } else {
+      palette[2][k] = (unsigned char)((palette[0][k] + palette[1][k]) / 2);
+      palette[3][k] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = !fourColors && hasAlpha ? 0 : 255;
+  const uint32_t indices = readUint32(block + 4);
+  for (int i = 0; i < 16; ++i) {
+    std::memcpy(texels[i], palette[(indices >> (2 * i)) & 3], 4);
+  }
+}
+
+// Decode the 16 values of a BC4 block (also the alpha of BC3) to channel
+// channel of texels
+void decodeBc4Block(
+    const unsigned char *block, int channel, unsigned char texels[16][4])
+{
+  const uint32_t v0 = block[0], v1 = block[1];
+  unsigned char values[8] = {(unsigned char)v0, (unsigned char)v1};
+  for (uint32_t i = 1; i < 7; ++i) {
+    if (v0 > v1) {
+      values[i + 1] = (unsigned char)(((7 - i) * v0 + i * v1) / 7);
+    } else if (i < 5) {
+      values[i + 1] = (unsigned char)(((5 - i) * v0 + i * v1) / 5);
+    } else {
+      values[i + 1] = i == 5 ? 0 : 255;
+    }
+  }
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= uint64_t(block[2 + i]) << (8 * i);
+  }
+  for (int i = 0; i < 16; ++i) {
+    texels[i][channel] = values[(indices >> (3 * i)) & 7];
+  }
+}
+
+} // namespace
+
+bool isKtx2(const unsigned char *bytes, size_t size)
+{
+  return size >= sizeof(kKtx2Identifier) &&
+         std::memcmp(bytes, kKtx2Identifier, sizeof(kKtx2Identifier)) == 0;
+}
+
+bool parseKtx2(const unsigned char *bytes, size_t size, Ktx2Image &image,
+    std::string *err)
+{
+  if (!isKtx2(bytes, size) || size < kHeaderSize) {
+    *err += "Invalid KTX2 file: bad header.\n";
+    return false;
+  }
+  image.vkFormat = readUint32(bytes + 12);
+  image.width = readUint32(bytes + 20);
+  image.height = readUint32(bytes + 24);
+  const uint32_t depth = readUint32(bytes + 28);
+  const uint32_t layerCount = readUint32(bytes + 32);
+  const uint32_t faceCount = readUint32(bytes + 36);
+  // 0 asks the loader to generate mipmaps, the file then has one level
+  const uint32_t levelCount = std::max(readUint32(bytes + 40), 1u);
+  image.supercompressionScheme = readUint32(bytes + 44);
+  if (image.width == 0 || image.height == 0 || depth > 1 ||
+      layerCount > 1 || faceCount != 1) {
+    *err += "KTX2 file is not a 2D texture.\n";
+    return false;
+  }
+  if (levelCount > 32 ||
+      kHeaderSize + levelCount * kLevelIndexEntrySize > size) {
+    *err += "Invalid KTX2 file: bad level index.\n";
+    return false;
+  }
+
+  image.levels.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    const auto *entry = bytes + kHeaderSize + level * kLevelIndexEntrySize;
+    const auto byteOffset = readUint64(entry);
+    const auto byteLength = readUint64(entry + 8);
+    if (byteOffset > size || byteLength > size - byteOffset) {
+      *err += "Invalid KTX2 file: level " + std::to_string(level) +
+              " is out of bounds.\n";
+      return false;
+    }
+    image.levels[level] = {bytes + byteOffset, size_t(byteLength)};
+  }
+  return true;
+}
+
+uint32_t getKtx2GLFormat(const Ktx2Image &image)
+{
+  if (image.supercompressionScheme != 0) {
+    return 0;
+  }
+  uint32_t glFormat = 0;
+  switch (image.vkFormat) {
+  case kVkFormatR8G8B8A8Unorm:
+  case kVkFormatR8G8B8A8Srgb:
+    glFormat = GL_RGBA8;
+    break;
+  case kVkFormatBc1RgbUnorm:
+  case kVkFormatBc1RgbSrgb:
+    glFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    break;
+  case kVkFormatBc1RgbaUnorm:
+  case kVkFormatBc1RgbaSrgb:
+    glFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    break;
+  case kVkFormatBc3Unorm:
+  case kVkFormatBc3Srgb:
+    glFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    break;
+  case kVkFormatBc4Unorm:
+    glFormat = GL_COMPRESSED_RED_RGTC1;
+    break;
+  case kVkFormatBc5Unorm:
+    glFormat = GL_COMPRESSED_RG_RGTC2;
+    break;
+  case kVkFormatBc7Unorm:
+  case kVkFormatBc7Srgb:
+    glFormat = GL_COMPRESSED_RGBA_BPTC_UNORM;
+    break;
+  default:
+    return 0;
+  }
+  // Levels must be large enough to be uploaded or decoded
+  for (uint32_t level = 0; level < image.levels.size(); ++level) {
+    const auto width = std::max(image.width >> level, 1u);
+    const auto height = std::max(image.height >> level, 1u);
+    if (image.levels[level].size < getLevelSize(glFormat, width, height)) {
+      return 0;
+    }
+  }
+  return glFormat;
+}
+
+bool canDecodeToRgba8(uint32_t glFormat)
+{
+  // BC7 has too many modes to be worth a CPU decoder, it is core since
+  // OpenGL 4.2
+  return glFormat != 0 && glFormat != GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+bool decodeKtx2ToRgba8(
+    const Ktx2Image &image, std::vector<unsigned char> &texels)
+{
+  const auto glFormat = getKtx2GLFormat(image);
+  if (!canDecodeToRgba8(glFormat)) {
+    return false;
+  }
+  const auto &level = image.levels[0];
+  const size_t rowSize = size_t(image.width) * 4;
+  if (glFormat == GL_RGBA8) {
+    texels.assign(level.data, level.data + rowSize * image.height);
+    return true;
+  }
+
+  texels.resize(rowSize * image.height);
+  const auto blockSize = getBlockSize(glFormat);
+  const uint32_t blockCountX = (image.width + 3) / 4;
+  const uint32_t blockCountY = (image.height + 3) / 4;
+  for (uint32_t by = 0; by < blockCountY; ++by) {
+    for (uint32_t bx = 0; bx < blockCountX; ++bx) {
+      const auto *block = level.data + (by * blockCountX + bx) * blockSize;
+      unsigned char blockTexels[16][4];
+      switch (glFormat) {
+      case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        decodeBc1Block(block, false, false, blockTexels);
+        break;
+      case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        decodeBc1Block(block, true, false, blockTexels);
+        break;
+      case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        decodeBc1Block(block + 8, false, true, blockTexels);
+        decodeBc4Block(block, 3, blockTexels);
+        break;
+      default:
+        // BC4 and BC5, sampled as (r, 0, 0, 1) and (r, g, 0, 1)
+        std::memset(blockTexels, 0, sizeof(blockTexels));
+        for (auto &texel : blockTexels) {
+          texel[3] = 255;
+        }
+        decodeBc4Block(block, 0, blockTexels);
+        if (glFormat == GL_COMPRESSED_RG_RGTC2) {
+          decodeBc4Block(block + 8, 1, blockTexels);
+        }
+      }
+      // Blocks on the right and bottom edges are clipped
+      for (uint32_t y = 0; y < 4 && by * 4 + y < image.height; ++y) {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < image.width; ++x) {
+          std::memcpy(&texels[(by * 4 + y) * rowSize + (bx * 4 + x) * 4],
+              blockTexels[y * 4 + x], 4);
+        }
+      }
+    }
+  }
+  return true;
+}
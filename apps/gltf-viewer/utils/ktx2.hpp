@@ -0,0 +1,55 @@
+#pragma once
+
+#include "gltf.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// KTX2 images of KHR_texture_basisu textures.
+// https://github.khronos.org/KTX-Specification/
+//
+// Images whose vkFormat is a block-compressed BCn format or RGBA8 are handled,
+// without supercompression: their levels are uploaded as they are stored in
+// the file with glCompressedTexSubImage2D(), or decoded to RGBA8 on the CPU
+// when the context does not support their format. Basis Universal encoded
+// images (ETC1S/BasisLZ and UASTC, vkFormat undefined) are not: this build has
+// no Basis Universal transcoder, such textures use their fallback image.
+
+// A KTX2 image with a single layer and face
+struct Ktx2Image
+{
+  uint32_t vkFormat = 0;
+  uint32_t width = 0, height = 0;
+  uint32_t supercompressionScheme = 0;
+  std::vector<BufferSpan> levels; // levels[0] is the full resolution image
+};
+
+// Levels of an image in a GL compressed format, uploaded as is
+struct CompressedImage
+{
+  uint32_t glFormat = 0; // e.g. GL_COMPRESSED_RGBA_BPTC_UNORM
+  std::vector<ImageLevel> levels; // levels[0] is the full resolution image
+  std::vector<unsigned char> ownedBytes; // Unless levels point to a mapping
+};
+
+bool isKtx2(const unsigned char *bytes, size_t size);
+
+// image.levels point to bytes. Returns false and fill err if the file is not
+// valid or has several layers or faces.
+bool parseKtx2(const unsigned char *bytes, size_t size, Ktx2Image &image,
+    std::string *err);
+
+// GL internal format to upload the levels of image to, 0 if its vkFormat or
+// supercompression is not handled. sRGB formats give the same format as
+// their UNORM counterpart since shaders convert colors themselves.
+uint32_t getKtx2GLFormat(const Ktx2Image &image);
+
+// True if the first level of an image with getKtx2GLFormat() glFormat can be
+// decoded by decodeKtx2ToRgba8()
+bool canDecodeToRgba8(uint32_t glFormat);
+
+// Decode the first level of image to tightly packed RGBA8 texels
+bool decodeKtx2ToRgba8(
+    const Ktx2Image &image, std::vector<unsigned char> &texels);
@@ -0,0 +1,126 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const fs::path &path)
+{
+  const auto hFile = CreateFileW(path.wstring().c_str(), GENERIC_READ,
+      FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    throw std::runtime_error("Unable to open file " + path.string());
+  }
+  m_hFile = hFile;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(hFile, &fileSize)) {
+    release();
+    throw std::runtime_error("Unable to get size of file " + path.string());
+  }
+  if (fileSize.QuadPart == 0) {
+    return; // Empty files cannot be mapped, keep an empty mapping
+  }
+
+  m_hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!m_hMapping) {
+    release();
+    throw std::runtime_error("Unable to map file " + path.string());
+  }
+  m_pData = (const unsigned char *)MapViewOfFile(
+      m_hMapping, FILE_MAP_READ, 0, 0, 0);
+  if (!m_pData) {
+    release();
+    throw std::runtime_error("Unable to map file " + path.string());
+  }
+  m_nSize = size_t(fileSize.QuadPart);
+}
+
+void MappedFile::release()
+{
+  if (m_pData) {
+    UnmapViewOfFile(m_pData);
+  }
+  if (m_hMapping) {
+    CloseHandle(m_hMapping);
+  }
+  if (m_hFile) {
+    CloseHandle(m_hFile);
+  }
+  m_pData = nullptr;
+  m_nSize = 0;
+  m_hMapping = nullptr;
+  m_hFile = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const fs::path &path)
+{
+  const auto fd = open(path.string().c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open file " + path.string());
+  }
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) < 0) {
+    close(fd);
+    throw std::runtime_error("Unable to get size of file " + path.string());
+  }
+  if (fileStat.st_size == 0) {
+    close(fd);
+    return; // Empty files cannot be mapped, keep an empty mapping
+  }
+
+  void *pData =
+      mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps a reference on the file, we don't need the descriptor
+  close(fd);
+  if (pData == MAP_FAILED) {
+    throw std::runtime_error("Unable to map file " + path.string());
+  }
+  m_pData = (const unsigned char *)pData;
+  m_nSize = size_t(fileStat.st_size);
+}
+
+void MappedFile::release()
+{
+  if (m_pData) {
+    munmap((void *)m_pData, m_nSize);
+  }
+  m_pData = nullptr;
+  m_nSize = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile &&rvalue) { *this = std::move(rvalue); }
+
+MappedFile &MappedFile::operator=(MappedFile &&rvalue)
+{
+  if (this != &rvalue) {
+    release();
+    std::swap(m_pData, rvalue.m_pData);
+    std::swap(m_nSize, rvalue.m_nSize);
+#ifdef _WIN32
+    std::swap(m_hFile, rvalue.m_hFile);
+    std::swap(m_hMapping, rvalue.m_hMapping);
+#endif
+  }
+  return *this;
+}
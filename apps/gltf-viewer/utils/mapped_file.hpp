@@ -0,0 +1,43 @@
+#pragma once
+
+#include "filesystem.hpp"
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+// The mapping is released when the object is destroyed, so pointers obtained
+// with data() must not outlive it.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+
+  // Throws std::runtime_error if the file cannot be opened or mapped
+  explicit MappedFile(const fs::path &path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&rvalue);
+
+  MappedFile &operator=(MappedFile &&rvalue);
+
+  const unsigned char *data() const { return m_pData; }
+
+  size_t size() const { return m_nSize; }
+
+  bool empty() const { return m_nSize == 0; }
+
+private:
+  void release();
+
+  const unsigned char *m_pData = nullptr;
+  size_t m_nSize = 0;
+#ifdef _WIN32
+  void *m_hFile = nullptr;
+  void *m_hMapping = nullptr;
+#endif
+};
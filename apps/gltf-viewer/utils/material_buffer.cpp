@@ -0,0 +1,62 @@
+#include "material_buffer.hpp"
+
+#include "uniform_ring_buffer.hpp"
+
+#include <cstring>
+#include <vector>
+
+static_assert(sizeof(MaterialBuffer::Factors) == 80,
+    "MaterialBuffer::Factors must match the std140 layout of Material");
+
+void MaterialBuffer::create(const Scene &scene)
+{
+  clear();
+  const auto alignment = UniformRingBuffer::getOffsetAlignment();
+  m_Stride = (sizeof(Factors) + alignment - 1) / alignment * alignment;
+  // The default material is last
+  m_MaterialCount = scene.materials.size() + 1;
+  std::vector<unsigned char> data(m_MaterialCount * m_Stride, 0);
+  for (size_t materialIdx = 0; materialIdx < m_MaterialCount; ++materialIdx) {
+    const auto &material = materialIdx < scene.materials.size()
+                               ? scene.materials[materialIdx]
+                               : Scene::Material{};
+    Factors factors{};
+    factors.baseColorFactor = material.baseColorFactor;
+    factors.emissiveFactor = material.emissiveFactor;
+    factors.metallicFactor = material.metallicFactor;
+    factors.roughnessFactor = material.roughnessFactor;
+    factors.texCoordTransform[0] = material.texCoordTransform[0];
+    factors.texCoordTransform[1] = material.texCoordTransform[1];
+    std::memcpy(
+        data.data() + materialIdx * m_Stride, &factors, sizeof(factors));
+  }
+  glGenBuffers(1, &m_Buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(data.size()), data.data(),
+      GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialBuffer::clear()
+{
+  if (m_Buffer) {
+    glDeleteBuffers(1, &m_Buffer);
+    m_Buffer = 0;
+  }
+  m_MaterialCount = 0;
+  unbind();
+}
+
+void MaterialBuffer::bind(GLuint binding, int32_t materialIdx)
+{
+  const auto defaultIndex = int64_t(m_MaterialCount) - 1;
+  const auto index = materialIdx >= 0 && materialIdx < defaultIndex
+                         ? int64_t(materialIdx)
+                         : defaultIndex;
+  if (index == m_BoundMaterial || index < 0) {
+    return;
+  }
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer,
+      GLintptr(size_t(index) * m_Stride), GLsizeiptr(sizeof(Factors)));
+  m_BoundMaterial = index;
+}
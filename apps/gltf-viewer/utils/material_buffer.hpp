@@ -0,0 +1,59 @@
+#pragma once
+
+#include "scene.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// Uniform buffer holding the factors of all materials of a scene, uploaded
+// once. Drawing with a material selects its factors for the Material block of
+// the fragment shader with one glBindBufferRange() call, instead of a
+// glUniform*() call per factor.
+//
+// Needs a current GL context, from construction to destruction.
+class MaterialBuffer
+{
+public:
+  // std140 layout of the Material block
+  struct Factors
+  {
+    glm::vec4 baseColorFactor;
+    glm::vec3 emissiveFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float reserved[3];
+    glm::vec4 texCoordTransform[2];
+  };
+
+  MaterialBuffer() = default;
+
+  ~MaterialBuffer() { clear(); }
+
+  MaterialBuffer(const MaterialBuffer &) = delete;
+
+  MaterialBuffer &operator=(const MaterialBuffer &) = delete;
+
+  // Upload the factors of all materials of scene, deleting the current ones
+  void create(const Scene &scene);
+
+  void clear();
+
+  // Bind the factors of material materialIdx, -1 for the default material, to
+  // the uniform block binding point binding. Skipped if they are bound already.
+  void bind(GLuint binding, int32_t materialIdx);
+
+  // Forget the bound material, to be called when something else may have been
+  // bound to the binding point
+  void unbind() { m_BoundMaterial = -2; }
+
+  // Number of materials, the default one included
+  size_t size() const { return m_MaterialCount; }
+
+private:
+  GLuint m_Buffer = 0;
+  size_t m_Stride = 0; // Bytes of each material, aligned
+  size_t m_MaterialCount = 0;
+  int64_t m_BoundMaterial = -2; // -2 if unknown
+};
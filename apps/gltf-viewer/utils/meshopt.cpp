@@ -0,0 +1,476 @@
+#include "meshopt.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+
+const unsigned char kVertexHeader = 0xa0;
+const unsigned char kTriangleHeader = 0xe0;
+const unsigned char kSequenceHeader = 0xd0;
+
+const size_t kByteGroupSize = 16;
+// Max bytes read by a group: 8 bytes of 4-bit values and 16 escaped bytes
+const size_t kByteGroupDecodeLimit = 24;
+const size_t kVertexBlockSizeBytes = 8192;
+const size_t kVertexBlockMaxSize = 256;
+const size_t kTailMaxSize = 32;
+
+// Attributes
+
+size_t getVertexBlockSize(size_t vertexSize)
+{
+  const size_t result =
+      (kVertexBlockSizeBytes / vertexSize) & ~(kByteGroupSize - 1);
+  return result < kVertexBlockMaxSize ? result : kVertexBlockMaxSize;
+}
+
+unsigned char unzigzag8(unsigned char v)
+{
+  return (unsigned char)(-(v & 1) ^ (v >> 1));
+}
+
+// Values of bits bits, most significant first, a value of all ones meaning
+// that the actual value follows the packed ones
+template <int bits>
+const unsigned char *decodeBytesGroupPacked(
+    const unsigned char *data, unsigned char *buffer)
+{
+  const int valuesPerByte = 8 / bits;
+  const unsigned char escape = (1 << bits) - 1;
+  const unsigned char *escaped = data + kByteGroupSize / valuesPerByte;
+  for (size_t i = 0; i < kByteGroupSize / valuesPerByte; ++i) {
+    unsigned char byte = data[i];
+    for (int j = 0; j < valuesPerByte; ++j) {
+      const unsigned char value = byte >> (8 - bits);
+      byte = (unsigned char)(byte << bits);
+      *buffer++ = value == escape ? *escaped++ : value;
+    }
+  }
+  return escaped;
+}
+
+const unsigned char *decodeBytesGroup(
+    const unsigned char *data, unsigned char *buffer, int bitsLog2)
+{
+  switch (bitsLog2) {
+  case 0:
+    std::memset(buffer, 0, kByteGroupSize);
+    return data;
+  case 1:
+    return decodeBytesGroupPacked<2>(data, buffer);
+  case 2:
+    return decodeBytesGroupPacked<4>(data, buffer);
+  default:
+    std::memcpy(buffer, data, kByteGroupSize);
+    return data + kByteGroupSize;
+  }
+}
+
+// Decode bufferSize bytes (a multiple of kByteGroupSize), preceded by the 2-bit
+// modes of their groups
+const unsigned char *decodeBytes(const unsigned char *data,
+    const unsigned char *dataEnd, unsigned char *buffer, size_t bufferSize)
+{
+  const unsigned char *header = data;
+  const size_t headerSize = (bufferSize / kByteGroupSize + 3) / 4;
+  if (size_t(dataEnd - data) < headerSize) {
+    return nullptr;
+  }
+  data += headerSize;
+  for (size_t i = 0; i < bufferSize; i += kByteGroupSize) {
+    if (size_t(dataEnd - data) < kByteGroupDecodeLimit) {
+      return nullptr;
+    }
+    const size_t groupIdx = i / kByteGroupSize;
+    const int bitsLog2 = (header[groupIdx / 4] >> ((groupIdx % 4) * 2)) & 3;
+    data = decodeBytesGroup(data, buffer + i, bitsLog2);
+  }
+  return data;
+}
+
+// Bytes are stored by position in the vertex: all first bytes, then all
+// second bytes, etc. Each is a delta with the same byte of the previous vertex.
+const unsigned char *decodeVertexBlock(const unsigned char *data,
+    const unsigned char *dataEnd, unsigned char *vertexData,
+    size_t vertexCount, size_t vertexSize, unsigned char lastVertex[256])
+{
+  unsigned char buffer[kVertexBlockMaxSize];
+  const size_t alignedVertexCount =
+      (vertexCount + kByteGroupSize - 1) & ~(kByteGroupSize - 1);
+  for (size_t k = 0; k < vertexSize; ++k) {
+    data = decodeBytes(data, dataEnd, buffer, alignedVertexCount);
+    if (!data) {
+      return nullptr;
+    }
+    unsigned char previous = lastVertex[k];
+    for (size_t i = 0; i < vertexCount; ++i) {
+      previous = (unsigned char)(unzigzag8(buffer[i]) + previous);
+      vertexData[i * vertexSize + k] = previous;
+    }
+    lastVertex[k] = previous;
+  }
+  return data;
+}
+
+bool decodeVertexBuffer(unsigned char *destination, size_t vertexCount,
+    size_t vertexSize, const unsigned char *source, size_t sourceSize)
+{
+  if (vertexSize == 0 || vertexSize > 256 || vertexSize % 4 != 0 ||
+      sourceSize < 1 + vertexSize) {
+    return false;
+  }
+  const unsigned char *data = source;
+  const unsigned char *dataEnd = source + sourceSize;
+  if (*data++ != kVertexHeader) {
+    return false; // Only version 0 exists
+  }
+
+  // The tail holds the vertex that deltas of the first one are relative to
+  unsigned char lastVertex[256];
+  std::memcpy(lastVertex, dataEnd - vertexSize, vertexSize);
+
+  const size_t blockSize = getVertexBlockSize(vertexSize);
+  for (size_t vertexOffset = 0; vertexOffset < vertexCount;
+       vertexOffset += blockSize) {
+    const size_t count = vertexOffset + blockSize < vertexCount
+                             ? blockSize
+                             : vertexCount - vertexOffset;
+    data = decodeVertexBlock(data, dataEnd,
+        destination + vertexOffset * vertexSize, count, vertexSize,
+        lastVertex);
+    if (!data) {
+      return false;
+    }
+  }
+  const size_t tailSize = vertexSize < kTailMaxSize ? kTailMaxSize : vertexSize;
+  return size_t(dataEnd - data) == tailSize;
+}
+
+// Indices
+
+uint32_t decodeVByte(const unsigned char *&data)
+{
+  const unsigned char lead = *data++;
+  if (lead < 128) {
+    return lead;
+  }
+  // Up to 4 more bytes, so that malformed data cannot make it read further
+  uint32_t result = lead & 127;
+  uint32_t shift = 7;
+  for (int i = 0; i < 4; ++i) {
+    const unsigned char group = *data++;
+    result |= uint32_t(group & 127) << shift;
+    shift += 7;
+    if (group < 128) {
+      break;
+    }
+  }
+  return result;
+}
+
+uint32_t decodeIndex(const unsigned char *&data, uint32_t last)
+{
+  const uint32_t v = decodeVByte(data);
+  return last + ((v >> 1) ^ (0u - (v & 1)));
+}
+
+void writeIndex(unsigned char *destination, size_t i, size_t indexSize,
+    uint32_t index)
+{
+  if (indexSize == 2) {
+    const auto value = uint16_t(index);
+    std::memcpy(destination + i * 2, &value, 2);
+  } else {
+    std::memcpy(destination + i * 4, &index, 4);
+  }
+}
+
+// Recently seen edges and vertices, referenced by the encoded triangles
+struct TriangleFifos
+{
+  uint32_t edges[16][2];
+  uint32_t vertices[16];
+  size_t edgeOffset = 0;
+  size_t vertexOffset = 0;
+
+  TriangleFifos()
+  {
+    std::memset(edges, -1, sizeof(edges));
+    std::memset(vertices, -1, sizeof(vertices));
+  }
+
+  void pushEdge(uint32_t a, uint32_t b)
+  {
+    edges[edgeOffset][0] = a;
+    edges[edgeOffset][1] = b;
+    edgeOffset = (edgeOffset + 1) & 15;
+  }
+
+  void pushVertex(uint32_t v, bool condition = true)
+  {
+    vertices[vertexOffset] = v;
+    vertexOffset = (vertexOffset + (condition ? 1 : 0)) & 15;
+  }
+};
+
+bool decodeTriangles(unsigned char *destination, size_t indexCount,
+    size_t indexSize, const unsigned char *source, size_t sourceSize)
+{
+  // At least the header, 1 code per triangle and the 16 byte codeaux table
+  if (indexCount % 3 != 0 || (indexSize != 2 && indexSize != 4) ||
+      sourceSize < 1 + indexCount / 3 + 16 ||
+      (source[0] & 0xf0) != kTriangleHeader) {
+    return false;
+  }
+  const int version = source[0] & 0x0f;
+  if (version > 1) {
+    return false;
+  }
+
+  TriangleFifos fifos;
+  uint32_t next = 0; // Next index never seen
+  uint32_t last = 0; // Last explicitly encoded index
+  const int fecMax = version >= 1 ? 13 : 15;
+  const unsigned char *code = source + 1;
+  const unsigned char *data = code + indexCount / 3;
+  const unsigned char *dataSafeEnd = source + sourceSize - 16;
+  const unsigned char *codeAuxTable = dataSafeEnd;
+
+  for (size_t i = 0; i < indexCount; i += 3) {
+    // A triangle reads at most 16 bytes, the size of the codeaux table
+    if (data > dataSafeEnd) {
+      return false;
+    }
+    uint32_t a, b, c;
+    const unsigned char codeTri = *code++;
+    if (codeTri < 0xf0) {
+      // Edge from the fifo and a vertex either new, from the fifo or explicit
+      const size_t edgeIdx = (fifos.edgeOffset - 1 - (codeTri >> 4)) & 15;
+      const auto &edge = fifos.edges[edgeIdx];
+      a = edge[0];
+      b = edge[1];
+      const int fec = codeTri & 15;
+      if (fec < fecMax) {
+        c = fec == 0 ? next++
+                     : fifos.vertices[(fifos.vertexOffset - 1 - fec) & 15];
+        fifos.pushVertex(c, fec == 0);
+      } else {
+        // 13 and 14 encode last - 1 and last + 1
+        last = c =
+            fec != 15 ? last + (fec - (fec ^ 3)) : decodeIndex(data, last);
+        fifos.pushVertex(c);
+      }
+      fifos.pushEdge(c, b);
+      fifos.pushEdge(a, c);
+    } else {
+      // Three vertices, each new, from the fifo or explicit
+      int fea, feb, fec;
+      if (codeTri < 0xfe) {
+        const unsigned char codeAux = codeAuxTable[codeTri & 15];
+        fea = 0;
+        feb = codeAux >> 4;
+        fec = codeAux & 15;
+      } else {
+        const unsigned char codeAux = *data++;
+        if (codeAux == 0) {
+          next = 0; // Reset
+        }
+        fea = codeTri == 0xfe ? 0 : 15;
+        feb = codeAux >> 4;
+        fec = codeAux & 15;
+      }
+      a = fea == 0 ? next++ : 0;
+      b = feb == 0 ? next++
+                   : fifos.vertices[(fifos.vertexOffset - feb) & 15];
+      c = fec == 0 ? next++
+                   : fifos.vertices[(fifos.vertexOffset - fec) & 15];
+      if (fea == 15) {
+        last = a = decodeIndex(data, last);
+      }
+      if (feb == 15) {
+        last = b = decodeIndex(data, last);
+      }
+      if (fec == 15) {
+        last = c = decodeIndex(data, last);
+      }
+      fifos.pushVertex(a);
+      fifos.pushVertex(b, feb == 0 || feb == 15);
+      fifos.pushVertex(c, fec == 0 || fec == 15);
+      fifos.pushEdge(b, a);
+      fifos.pushEdge(c, b);
+      fifos.pushEdge(a, c);
+    }
+    writeIndex(destination, i, indexSize, a);
+    writeIndex(destination, i + 1, indexSize, b);
+    writeIndex(destination, i + 2, indexSize, c);
+  }
+  return data == dataSafeEnd;
+}
+
+bool decodeIndexSequence(unsigned char *destination, size_t indexCount,
+    size_t indexSize, const unsigned char *source, size_t sourceSize)
+{
+  // At least the header, 1 byte per index and a 4 byte tail
+  if ((indexSize != 2 && indexSize != 4) ||
+      sourceSize < 1 + indexCount + 4 ||
+      (source[0] & 0xf0) != kSequenceHeader || (source[0] & 0x0f) > 1) {
+    return false;
+  }
+  const unsigned char *data = source + 1;
+  const unsigned char *dataSafeEnd = source + sourceSize - 4;
+  // Deltas are relative to one of two baselines, given by the low bit
+  uint32_t last[2] = {0, 0};
+  for (size_t i = 0; i < indexCount; ++i) {
+    // An index reads at most 5 bytes, the tail is 4 bytes
+    if (data >= dataSafeEnd) {
+      return false;
+    }
+    uint32_t v = decodeVByte(data);
+    const uint32_t baseline = v & 1;
+    v >>= 1;
+    last[baseline] += (v >> 1) ^ (0u - (v & 1));
+    writeIndex(destination, i, indexSize, last[baseline]);
+  }
+  return data == dataSafeEnd;
+}
+
+// Filters
+
+int roundToInt(float value)
+{
+  return int(value + (value >= 0.f ? 0.5f : -0.5f));
+}
+
+// Octahedral encoded unit vectors: x, y and a z storing 1 at the same scale
+template <typename T> void decodeFilterOctahedral(T *data, size_t count)
+{
+  const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+  for (size_t i = 0; i < count; ++i) {
+    float x = float(data[i * 4 + 0]);
+    float y = float(data[i * 4 + 1]);
+    const float z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+    // Fold back the lower hemisphere
+    const float t = z < 0.f ? z : 0.f;
+    x += x >= 0.f ? t : -t;
+    y += y >= 0.f ? t : -t;
+    const float scale = max / std::sqrt(x * x + y * y + z * z);
+    data[i * 4 + 0] = T(roundToInt(x * scale));
+    data[i * 4 + 1] = T(roundToInt(y * scale));
+    data[i * 4 + 2] = T(roundToInt(z * scale));
+  }
+}
+
+// Unit quaternions: the 3 smallest components, and in the 4th one the index
+// of the largest in the 2 low bits and the scale in the others
+void decodeFilterQuaternion(int16_t *data, size_t count)
+{
+  const float scale = 1.f / std::sqrt(2.f);
+  for (size_t i = 0; i < count; ++i) {
+    const int sf = data[i * 4 + 3] | 3;
+    const float ss = scale / float(sf);
+    const float x = float(data[i * 4 + 0]) * ss;
+    const float y = float(data[i * 4 + 1]) * ss;
+    const float z = float(data[i * 4 + 2]) * ss;
+    const float ww = 1.f - x * x - y * y - z * z;
+    const float w = std::sqrt(ww >= 0.f ? ww : 0.f);
+    const int qc = data[i * 4 + 3] & 3;
+    data[i * 4 + ((qc + 1) & 3)] = int16_t(roundToInt(x * 32767.f));
+    data[i * 4 + ((qc + 2) & 3)] = int16_t(roundToInt(y * 32767.f));
+    data[i * 4 + ((qc + 3) & 3)] = int16_t(roundToInt(z * 32767.f));
+    data[i * 4 + ((qc + 0) & 3)] = int16_t(roundToInt(w * 32767.f));
+  }
+}
+
+// Floats stored as a 24-bit mantissa and an 8-bit exponent
+void decodeFilterExponential(uint32_t *data, size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t v = data[i];
+    const int32_t mantissa = int32_t(v << 8) >> 8;
+    const int32_t exponent = int32_t(v) >> 24;
+    const float value = std::ldexp(float(mantissa), exponent);
+    std::memcpy(&data[i], &value, sizeof(value));
+  }
+}
+
+} // namespace
+
+bool parseMeshoptMode(const std::string &name, MeshoptMode *mode)
+{
+  if (name == "ATTRIBUTES") {
+    *mode = MeshoptAttributes;
+  } else if (name == "TRIANGLES") {
+    *mode = MeshoptTriangles;
+  } else if (name == "INDICES") {
+    *mode = MeshoptIndices;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parseMeshoptFilter(const std::string &name, MeshoptFilter *filter)
+{
+  if (name.empty() || name == "NONE") {
+    *filter = MeshoptFilterNone;
+  } else if (name == "OCTAHEDRAL") {
+    *filter = MeshoptFilterOctahedral;
+  } else if (name == "QUATERNION") {
+    *filter = MeshoptFilterQuaternion;
+  } else if (name == "EXPONENTIAL") {
+    *filter = MeshoptFilterExponential;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool decodeMeshopt(unsigned char *destination, size_t count, size_t byteStride,
+    const unsigned char *source, size_t sourceSize, MeshoptMode mode,
+    MeshoptFilter filter)
+{
+  switch (mode) {
+  case MeshoptAttributes:
+    if (!decodeVertexBuffer(
+            destination, count, byteStride, source, sourceSize)) {
+      return false;
+    }
+    break;
+  case MeshoptTriangles:
+    return filter == MeshoptFilterNone &&
+           decodeTriangles(destination, count, byteStride, source, sourceSize);
+  case MeshoptIndices:
+    return filter == MeshoptFilterNone &&
+           decodeIndexSequence(
+               destination, count, byteStride, source, sourceSize);
+  }
+
+  // Data is aligned enough for the filters: byteStride is a multiple of 4 and
+  // bufferViews of vertex attributes start at multiples of 4
+  switch (filter) {
+  case MeshoptFilterNone:
+    return true;
+  case MeshoptFilterOctahedral:
+    if (byteStride == 4) {
+      decodeFilterOctahedral((int8_t *)destination, count);
+    } else if (byteStride == 8) {
+      decodeFilterOctahedral((int16_t *)destination, count);
+    } else {
+      return false;
+    }
+    return true;
+  case MeshoptFilterQuaternion:
+    if (byteStride != 8) {
+      return false;
+    }
+    decodeFilterQuaternion((int16_t *)destination, count);
+    return true;
+  case MeshoptFilterExponential:
+    decodeFilterExponential((uint32_t *)destination, count * byteStride / 4);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Decoder for bufferViews compressed by EXT_meshopt_compression
+// https://github.com/KhronosGroup/glTF/tree/main/extensions/2.0/Vendor/EXT_meshopt_compression
+//
+// Vertex attributes are stored as byte deltas between consecutive elements,
+// packed in groups of 16 with 0, 2, 4 or 8 bits per delta. Triangle indices
+// are stored as references to recently seen edges and vertices, other index
+// sequences as variable length deltas. Filters are applied after decoding.
+
+enum MeshoptMode { MeshoptAttributes = 0, MeshoptTriangles, MeshoptIndices };
+
+enum MeshoptFilter {
+  MeshoptFilterNone = 0,
+  MeshoptFilterOctahedral,
+  MeshoptFilterQuaternion,
+  MeshoptFilterExponential
+};
+
+// Parse the "mode" and "filter" properties of the extension, returns false if
+// unknown
+bool parseMeshoptMode(const std::string &name, MeshoptMode *mode);
+bool parseMeshoptFilter(const std::string &name, MeshoptFilter *filter);
+
+// Decode count elements of byteStride bytes from source to destination, which
+// must hold count * byteStride bytes. Returns false if the parameters are not
+// allowed by the extension or if source is not a valid stream; destination
+// may then be partially written.
+bool decodeMeshopt(unsigned char *destination, size_t count, size_t byteStride,
+    const unsigned char *source, size_t sourceSize, MeshoptMode mode,
+    MeshoptFilter filter);
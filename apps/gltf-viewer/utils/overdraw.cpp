@@ -0,0 +1,152 @@
+#include "overdraw.hpp"
+#include "vertex_cache.hpp"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace
+{
+
+// FIFO vertex cache, as simulated by analyzeVertexCache()
+class VertexCacheSimulation
+{
+public:
+  explicit VertexCacheSimulation(size_t vertexCount) :
+      m_MissTimes(vertexCount, 0), m_Time(kVertexCacheSize + 1)
+  {
+  }
+
+  // Returns the number of vertices of triangle that miss
+  uint32_t drawTriangle(const uint32_t *triangle)
+  {
+    uint32_t missCount = 0;
+    for (size_t i = 0; i < 3; ++i) {
+      auto &missTime = m_MissTimes[triangle[i]];
+      if (m_Time - missTime > kVertexCacheSize) {
+        missTime = m_Time++;
+        ++missCount;
+      }
+    }
+    return missCount;
+  }
+
+  // Empty the cache
+  void flush() { m_Time += kVertexCacheSize + 1; }
+
+private:
+  std::vector<uint64_t> m_MissTimes;
+  uint64_t m_Time;
+};
+
+// Clusters are ranges of triangles, given by the first triangle of each and
+// ending with the triangle count
+std::vector<size_t> splitClusters(const uint32_t *indices,
+    size_t triangleCount, size_t vertexCount, float threshold)
+{
+  // The cache order starts over where all the vertices of a triangle miss,
+  // clusters can start there without hurting it
+  VertexCacheSimulation cache{vertexCount};
+  std::vector<size_t> hardBoundaries;
+  for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+    if (cache.drawTriangle(indices + 3 * triangle) == 3 || triangle == 0) {
+      hardBoundaries.push_back(triangle);
+    }
+  }
+  hardBoundaries.push_back(triangleCount);
+
+  // Then they are cut where their ACMR from their start is low enough, the
+  // cache starting empty for the next one
+  std::vector<size_t> boundaries;
+  for (size_t i = 0; i + 1 < hardBoundaries.size(); ++i) {
+    const auto start = hardBoundaries[i], end = hardBoundaries[i + 1];
+    cache.flush();
+    uint64_t missCount = 0;
+    for (auto triangle = start; triangle < end; ++triangle) {
+      missCount += cache.drawTriangle(indices + 3 * triangle);
+    }
+    const float maxAcmr = threshold * float(missCount) / float(end - start);
+
+    cache.flush();
+    boundaries.push_back(start);
+    missCount = 0;
+    size_t clusterTriangleCount = 0;
+    for (auto triangle = start; triangle + 1 < end; ++triangle) {
+      missCount += cache.drawTriangle(indices + 3 * triangle);
+      ++clusterTriangleCount;
+      if (float(missCount) <= maxAcmr * float(clusterTriangleCount)) {
+        boundaries.push_back(triangle + 1);
+        cache.flush();
+        missCount = 0;
+        clusterTriangleCount = 0;
+      }
+    }
+  }
+  boundaries.push_back(triangleCount);
+  return boundaries;
+}
+
+} // namespace
+
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+    const float *positions, size_t vertexCount, float threshold)
+{
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+  const auto boundaries =
+      splitClusters(indices, triangleCount, vertexCount, threshold);
+  const size_t clusterCount = boundaries.size() - 1;
+  if (clusterCount < 2) {
+    return;
+  }
+
+  const auto getPosition = [&](uint32_t vertex) {
+    return glm::vec3(positions[3 * vertex], positions[3 * vertex + 1],
+        positions[3 * vertex + 2]);
+  };
+  glm::vec3 meshCentroid{0};
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    meshCentroid += getPosition(indices[i]);
+  }
+  meshCentroid /= float(triangleCount * 3);
+
+  // Clusters far from the centroid in the direction they face are on the
+  // outside of the mesh
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+    glm::vec3 centroid{0}, normal{0};
+    float area = 0.f;
+    for (auto triangle = boundaries[cluster];
+         triangle < boundaries[cluster + 1]; ++triangle) {
+      const auto p0 = getPosition(indices[3 * triangle]);
+      const auto p1 = getPosition(indices[3 * triangle + 1]);
+      const auto p2 = getPosition(indices[3 * triangle + 2]);
+      const auto triangleNormal = glm::cross(p1 - p0, p2 - p0);
+      const auto triangleArea = glm::length(triangleNormal);
+      centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+      normal += triangleNormal;
+      area += triangleArea;
+    }
+    const float normalLength = glm::length(normal);
+    sortKeys[cluster] = area > 0.f && normalLength > 0.f
+                            ? glm::dot(centroid / area - meshCentroid,
+                                  normal / normalLength)
+                            : 0.f;
+  }
+
+  std::vector<size_t> clusters(clusterCount);
+  for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+    clusters[cluster] = cluster;
+  }
+  std::stable_sort(begin(clusters), end(clusters),
+      [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  for (const auto cluster : clusters) {
+    output.insert(end(output), indices + 3 * boundaries[cluster],
+        indices + 3 * boundaries[cluster + 1]);
+  }
+  std::copy(begin(output), end(output), indices);
+}
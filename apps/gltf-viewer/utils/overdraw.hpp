@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Triangle reordering reducing overdraw, after Sander et al. "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw".
+//
+// Triangles already ordered for the vertex cache are split into clusters
+// where the order can change without hurting the cache much, then clusters
+// are sorted so that those on the outside of the mesh and facing out, likely
+// to occlude the others, are drawn first. Early depth tests then reject more
+// fragments of the clusters drawn after them.
+
+// Reorder the triangles of the list indices, whose vertices have the
+// positions (3 floats each). threshold is the max ratio between the ACMR of a
+// cluster and that of the triangles it is cut from (see vertex_cache.hpp),
+// larger values giving smaller clusters: more overdraw reduction, less vertex
+// cache efficiency. Indices must be lower than vertexCount.
+void optimizeOverdraw(uint32_t *indices, size_t indexCount,
+    const float *positions, size_t vertexCount, float threshold);
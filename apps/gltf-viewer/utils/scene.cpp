@@ -0,0 +1,293 @@
+#include "scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+static_assert(std::is_trivially_copyable<Scene::Primitive>::value &&
+                  std::is_trivially_copyable<Scene::Mesh>::value &&
+                  std::is_trivially_copyable<Scene::Node>::value &&
+                  std::is_trivially_copyable<Scene::Material>::value &&
+                  std::is_trivially_copyable<Scene::Texture>::value,
+    "Scene records are written to disk as is");
+
+namespace
+{
+
+const char *const kAttributeNames[VertexAttribCount] = {
+    "POSITION", "NORMAL", "TEXCOORD_0"};
+
+Scene::VertexAttrib extractVertexAttrib(
+    const tinygltf::Model &model, const tinygltf::Accessor &accessor)
+{
+  Scene::VertexAttrib attrib;
+  if (accessor.bufferView < 0) {
+    return attrib;
+  }
+  const auto &bufferView = model.bufferViews[accessor.bufferView];
+  attrib.buffer = bufferView.buffer;
+  attrib.size = tinygltf::GetNumComponentsInType(accessor.type);
+  attrib.componentType = uint32_t(accessor.componentType);
+  attrib.byteStride = int32_t(bufferView.byteStride);
+  attrib.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+  attrib.byteOffset = accessor.byteOffset + bufferView.byteOffset;
+  return attrib;
+}
+
+Scene::Primitive extractPrimitive(
+    const tinygltf::Model &model, const tinygltf::Primitive &primitive)
+{
+  Scene::Primitive result;
+  for (int attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto it = primitive.attributes.find(kAttributeNames[attribIdx]);
+    if (it != end(primitive.attributes)) {
+      const auto &accessor = model.accessors[(*it).second];
+      result.attributes[attribIdx] = extractVertexAttrib(model, accessor);
+      result.vertexCount = uint32_t(accessor.count);
+    }
+  }
+  if (primitive.indices >= 0) {
+    const auto &accessor = model.accessors[primitive.indices];
+    const auto &bufferView = model.bufferViews[accessor.bufferView];
+    result.indexBuffer = bufferView.buffer;
+    result.indexType = uint32_t(accessor.componentType);
+    result.indexByteOffset = accessor.byteOffset + bufferView.byteOffset;
+    result.count = uint32_t(accessor.count);
+  } else if (!primitive.attributes.empty()) {
+    // All attributes have the same count
+    const int accessorIdx = (*begin(primitive.attributes)).second;
+    result.count = uint32_t(model.accessors[accessorIdx].count);
+  }
+  result.mode = uint32_t(primitive.mode);
+  result.material = primitive.material;
+  return result;
+}
+
+// Number of value, or defaultValue
+float getNumber(const tinygltf::Value &value, float defaultValue)
+{
+  return value.IsNumber() ? float(value.GetNumberAsDouble()) : defaultValue;
+}
+
+// Set transform to the KHR_texture_transform of a texture of a material, if
+// it has one. Quantized texture coordinates (KHR_mesh_quantization) rely on it.
+bool getTexCoordTransform(
+    const tinygltf::ExtensionMap &extensions, glm::vec4 transform[2])
+{
+  const auto it = extensions.find("KHR_texture_transform");
+  if (it == end(extensions) || !(*it).second.IsObject()) {
+    return false;
+  }
+  const auto &extension = (*it).second;
+  const auto &offset = extension.Get("offset");
+  const auto &scale = extension.Get("scale");
+  const auto rotation = getNumber(extension.Get("rotation"), 0.f);
+  const auto getComponent = [](const tinygltf::Value &value, int i,
+                                float defaultValue) {
+    return value.IsArray() && value.ArrayLen() == 2
+               ? getNumber(value.Get(i), defaultValue)
+               : defaultValue;
+  };
+  const glm::vec2 t(getComponent(offset, 0, 0.f), getComponent(offset, 1, 0.f));
+  const glm::vec2 s(getComponent(scale, 0, 1.f), getComponent(scale, 1, 1.f));
+  const auto c = std::cos(rotation);
+  const auto r = std::sin(rotation);
+  // Translation * rotation * scale, as the extension defines it
+  transform[0] = glm::vec4(c * s.x, r * s.y, t.x, 0);
+  transform[1] = glm::vec4(-r * s.x, c * s.y, t.y, 0);
+  return true;
+}
+
+Scene::Material extractMaterial(const tinygltf::Material &material)
+{
+  const auto &pbrMetallicRoughness = material.pbrMetallicRoughness;
+  const auto &baseColorFactor = pbrMetallicRoughness.baseColorFactor;
+  const auto &emissiveFactor = material.emissiveFactor;
+  Scene::Material result;
+  result.baseColorFactor = glm::vec4(baseColorFactor[0], baseColorFactor[1],
+      baseColorFactor[2], baseColorFactor[3]);
+  result.emissiveFactor =
+      glm::vec3(emissiveFactor[0], emissiveFactor[1], emissiveFactor[2]);
+  result.metallicFactor = float(pbrMetallicRoughness.metallicFactor);
+  result.roughnessFactor = float(pbrMetallicRoughness.roughnessFactor);
+  result.baseColorTexture = pbrMetallicRoughness.baseColorTexture.index;
+  result.metallicRoughnessTexture =
+      pbrMetallicRoughness.metallicRoughnessTexture.index;
+  result.emissiveTexture = material.emissiveTexture.index;
+  result.normalTexture = material.normalTexture.index;
+  result.occlusionTexture = material.occlusionTexture.index;
+  result.doubleSided = material.doubleSided ? GL_TRUE : GL_FALSE;
+  for (const auto *extensions :
+      {&pbrMetallicRoughness.baseColorTexture.extensions,
+          &pbrMetallicRoughness.metallicRoughnessTexture.extensions,
+          &material.emissiveTexture.extensions,
+          &material.normalTexture.extensions,
+          &material.occlusionTexture.extensions}) {
+    if (getTexCoordTransform(*extensions, result.texCoordTransform)) {
+      break;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+Scene::Texture extractTexture(
+    const tinygltf::Model &model, const tinygltf::Texture &texture)
+{
+  Scene::Texture result;
+  result.image = texture.source;
+  if (texture.sampler >= 0) {
+    const auto &sampler = model.samplers[texture.sampler];
+    result.minFilter = sampler.minFilter != -1 ? sampler.minFilter : GL_LINEAR;
+    result.magFilter = sampler.magFilter != -1 ? sampler.magFilter : GL_LINEAR;
+    result.wrapS = sampler.wrapS;
+    result.wrapT = sampler.wrapT;
+    result.wrapR = sampler.wrapR;
+  }
+  return result;
+}
+
+Scene extractScene(
+    const tinygltf::Model &model, const std::vector<BufferSpan> &buffers)
+{
+  Scene scene;
+
+  for (const auto &node : model.nodes) {
+    Scene::Node result;
+    result.localMatrix = getLocalToWorldMatrix(node, glm::mat4(1));
+    result.mesh = node.mesh;
+    result.firstChild = uint32_t(scene.children.size());
+    result.childCount = uint32_t(node.children.size());
+    const auto instanceMatrices = getInstanceMatrices(model, buffers, node);
+    result.firstInstance = uint32_t(scene.instanceMatrices.size());
+    result.instanceCount = uint32_t(instanceMatrices.size());
+    scene.instanceMatrices.insert(end(scene.instanceMatrices),
+        begin(instanceMatrices), end(instanceMatrices));
+    scene.children.insert(
+        end(scene.children), begin(node.children), end(node.children));
+    scene.nodes.emplace_back(result);
+  }
+  if (model.defaultScene >= 0) {
+    const auto &nodes = model.scenes[model.defaultScene].nodes;
+    scene.rootNodes.assign(begin(nodes), end(nodes));
+  }
+
+  for (const auto &mesh : model.meshes) {
+    Scene::Mesh result;
+    result.firstPrimitive = uint32_t(scene.primitives.size());
+    result.primitiveCount = uint32_t(mesh.primitives.size());
+    result.boundingSphere = computeMeshBoundingSphere(model, mesh);
+    for (const auto &primitive : mesh.primitives) {
+      scene.primitives.emplace_back(extractPrimitive(model, primitive));
+    }
+    scene.meshes.emplace_back(result);
+  }
+
+  for (const auto &material : model.materials) {
+    scene.materials.emplace_back(extractMaterial(material));
+  }
+  for (const auto &texture : model.textures) {
+    scene.textures.emplace_back(extractTexture(model, texture));
+  }
+
+  scene.buffers = buffers;
+  return scene;
+}
+
+void computeSceneBounds(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, Scene &scene)
+{
+  scene.bboxMin = glm::vec3(std::numeric_limits<float>::max());
+  scene.bboxMax = glm::vec3(std::numeric_limits<float>::lowest());
+  // Local bounds of the instanced meshes, computed on first use
+  std::vector<std::pair<glm::vec3, glm::vec3>> meshBounds(scene.meshes.size(),
+      {glm::vec3(std::numeric_limits<float>::max()),
+          glm::vec3(std::numeric_limits<float>::lowest())});
+  std::vector<bool> hasMeshBounds(scene.meshes.size(), false);
+
+  const std::function<void(uint32_t, const glm::mat4 &)> updateBounds =
+      [&](uint32_t nodeIdx, const glm::mat4 &parentMatrix) {
+        const auto &node = scene.nodes[nodeIdx];
+        const auto modelMatrix = parentMatrix * node.localMatrix;
+        if (node.mesh >= 0 && node.instanceCount == 0) {
+          computeMeshBounds(model, buffers, model.meshes[node.mesh],
+              modelMatrix, scene.bboxMin, scene.bboxMax);
+        } else if (node.mesh >= 0) {
+          auto &bounds = meshBounds[node.mesh];
+          if (!hasMeshBounds[node.mesh]) {
+            computeMeshBounds(model, buffers, model.meshes[node.mesh],
+                glm::mat4(1), bounds.first, bounds.second);
+            hasMeshBounds[node.mesh] = true;
+          }
+          if (bounds.first.x <= bounds.second.x) {
+            for (uint32_t i = 0; i < node.instanceCount; ++i) {
+              const auto matrix =
+                  modelMatrix * scene.instanceMatrices[node.firstInstance + i];
+              for (int corner = 0; corner < 8; ++corner) {
+                const glm::vec3 position(
+                    corner & 1 ? bounds.second.x : bounds.first.x,
+                    corner & 2 ? bounds.second.y : bounds.first.y,
+                    corner & 4 ? bounds.second.z : bounds.first.z);
+                const auto worldPosition =
+                    glm::vec3(matrix * glm::vec4(position, 1.f));
+                scene.bboxMin = glm::min(scene.bboxMin, worldPosition);
+                scene.bboxMax = glm::max(scene.bboxMax, worldPosition);
+              }
+            }
+          }
+        }
+        for (uint32_t i = 0; i < node.childCount; ++i) {
+          updateBounds(scene.children[node.firstChild + i], modelMatrix);
+        }
+      };
+  for (const auto nodeIdx : scene.rootNodes) {
+    updateBounds(nodeIdx, glm::mat4(1));
+  }
+}
+
+bool isMirroring(const glm::mat4 &matrix)
+{
+  return glm::determinant(glm::mat3(matrix)) < 0.f;
+}
+
+uint64_t getElementSize(const Scene::VertexAttrib &attrib)
+{
+  return uint64_t(std::max(attrib.size, 0)) *
+         std::max(tinygltf::GetComponentSizeInBytes(attrib.componentType), 0);
+}
+
+uint64_t getByteStride(const Scene::VertexAttrib &attrib)
+{
+  return attrib.byteStride > 0 ? uint64_t(attrib.byteStride)
+                               : getElementSize(attrib);
+}
+
+bool hasAttributesInBounds(
+    const Scene &scene, const Scene::Primitive &primitive)
+{
+  if (primitive.vertexCount == 0) {
+    return false;
+  }
+  bool hasAttribute = false;
+  for (const auto &attrib : primitive.attributes) {
+    if (attrib.buffer < 0) {
+      continue;
+    }
+    const uint64_t elementSize = getElementSize(attrib);
+    if (size_t(attrib.buffer) >= scene.buffers.size() || elementSize == 0) {
+      return false;
+    }
+    const uint64_t lastByteOffset =
+        attrib.byteOffset +
+        uint64_t(primitive.vertexCount - 1) * getByteStride(attrib);
+    if (lastByteOffset + elementSize > scene.buffers[attrib.buffer].size) {
+      return false;
+    }
+    hasAttribute = true;
+  }
+  return hasAttribute;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "gltf.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <tiny_gltf.h>
+
+#include <cstdint>
+#include <vector>
+
+// Vertex attributes read by the shaders, values are attribute locations
+enum VertexAttribute {
+  VertexAttribPosition = 0,
+  VertexAttribNormal,
+  VertexAttribTexCoord0,
+  VertexAttribCount
+};
+
+// Everything the render loop needs to draw a glTF scene, without tinygltf.
+//
+// Nodes, meshes, materials and textures keep the indices of their glTF
+// counterpart. All records are trivially copyable so that a Scene can be
+// written to disk and read back as is (see baked_scene.hpp).
+struct Scene
+{
+  struct VertexAttrib
+  {
+    int32_t buffer = -1; // -1 if the primitive does not have the attribute
+    int32_t size = 0; // Number of components
+    uint32_t componentType = 0;
+    int32_t byteStride = 0;
+    // GL_TRUE if integer components map to [0, 1] or [-1, 1]
+    // (KHR_mesh_quantization), they are converted to float as is otherwise
+    uint32_t normalized = GL_FALSE;
+    uint32_t reserved = 0;
+    uint64_t byteOffset = 0;
+  };
+
+  struct Primitive
+  {
+    VertexAttrib attributes[VertexAttribCount];
+    int32_t indexBuffer = -1; // -1 if the primitive is not indexed
+    uint32_t indexType = 0;
+    uint64_t indexByteOffset = 0;
+    uint32_t count = 0; // Number of indices, or vertices if not indexed
+    uint32_t mode = TINYGLTF_MODE_TRIANGLES;
+    int32_t material = -1;
+    uint32_t vertexCount = 0; // Number of elements of the attributes
+    // Added to indices before reading attributes, see narrowIndices()
+    int32_t baseVertex = 0;
+    uint32_t reserved = 0;
+  };
+
+  struct Mesh
+  {
+    uint32_t firstPrimitive = 0; // Index in primitives
+    uint32_t primitiveCount = 0;
+    glm::vec4 boundingSphere{0}; // Local space center and radius
+  };
+
+  struct Node
+  {
+    glm::mat4 localMatrix{1};
+    int32_t mesh = -1;
+    uint32_t firstChild = 0; // Index in children
+    uint32_t childCount = 0;
+    // Instances of the mesh (EXT_mesh_gpu_instancing), 0 if the mesh is drawn
+    // once with localMatrix
+    uint32_t firstInstance = 0; // Index in instanceMatrices
+    uint32_t instanceCount = 0;
+    uint32_t reserved[3] = {};
+  };
+
+  struct Material
+  {
+    glm::vec4 baseColorFactor{1};
+    glm::vec3 emissiveFactor{0};
+    float metallicFactor = 1.f;
+    float roughnessFactor = 1.f;
+    int32_t baseColorTexture = -1;
+    int32_t metallicRoughnessTexture = -1;
+    int32_t emissiveTexture = -1;
+    int32_t normalTexture = -1;
+    int32_t occlusionTexture = -1;
+    uint32_t doubleSided = GL_FALSE; // Back faces are culled if GL_FALSE
+    // KHR_texture_transform of the texture coordinates, rows of a 2x3 matrix.
+    // That of the first texture of the material applies to all of them.
+    glm::vec4 texCoordTransform[2] = {{1, 0, 0, 0}, {0, 1, 0, 0}};
+  };
+
+  // Sampler parameters are resolved, defaults included
+  struct Texture
+  {
+    int32_t image = -1;
+    int32_t minFilter = GL_LINEAR;
+    int32_t magFilter = GL_LINEAR;
+    int32_t wrapS = GL_REPEAT;
+    int32_t wrapT = GL_REPEAT;
+    int32_t wrapR = GL_REPEAT;
+  };
+
+  std::vector<Node> nodes;
+  std::vector<uint32_t> children; // Node indices, see Node::firstChild
+  std::vector<uint32_t> rootNodes; // Nodes of the default scene
+  // Relative to their node, see Node::firstInstance
+  std::vector<glm::mat4> instanceMatrices;
+  std::vector<Mesh> meshes;
+  std::vector<Primitive> primitives;
+  std::vector<Material> materials;
+  std::vector<Texture> textures;
+  // Bytes of the buffers referenced by vertex attributes and indices, owned
+  // by whoever has built the Scene
+  std::vector<BufferSpan> buffers;
+  glm::vec3 bboxMin{0}, bboxMax{0};
+};
+
+// Resolve the sampler of a glTF texture
+Scene::Texture extractTexture(
+    const tinygltf::Model &model, const tinygltf::Texture &texture);
+
+// Extract the render data of a model. buffers[i] are the bytes of
+// model.buffers[i] (see GltfLoader::bufferSpans()). Bounds are left to the
+// caller, see computeSceneBounds().
+Scene extractScene(
+    const tinygltf::Model &model, const std::vector<BufferSpan> &buffers);
+
+// Set scene.bboxMin/bboxMax from the vertices of the meshes of its nodes.
+// Instanced meshes are bounded by the box of their vertices, transformed by
+// each instance, so the cost does not grow with vertices times instances.
+void computeSceneBounds(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, Scene &scene);
+
+// Whether matrix mirrors what it transforms, flipping the winding of triangles
+bool isMirroring(const glm::mat4 &matrix);
+
+// Bytes of an element of attrib, and between the starts of consecutive
+// elements
+uint64_t getElementSize(const Scene::VertexAttrib &attrib);
+uint64_t getByteStride(const Scene::VertexAttrib &attrib);
+
+// Whether primitive has attributes and all of them are in the bounds of
+// scene.buffers
+bool hasAttributesInBounds(
+    const Scene &scene, const Scene::Primitive &primitive);
@@ -0,0 +1,632 @@
+#include "scene_stats.hpp"
+#include "gl_extensions.hpp"
+#include "gltf_loader.hpp"
+#include "gpu_buffers.hpp"
+#include "hash.hpp"
+#include "textures.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <json.hpp>
+#include <map>
+#include <tiny_gltf.h>
+#include <tuple>
+
+namespace
+{
+
+const double kBytesPerMB = 1024. * 1024.;
+
+// Instances that the viewer draws at once, the size of the uDraws array of its
+// vertex shaders
+const uint64_t kMaxDrawInstances = 64;
+
+// Those of a desktop OpenGL 4.2 driver, see getSupportedCompressedFormats()
+std::vector<uint32_t> getDesktopCompressedFormats()
+{
+  return {GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2,
+      GL_COMPRESSED_RGBA_BPTC_UNORM, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+      GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT};
+}
+
+const char *getFormatName(uint32_t glFormat)
+{
+  switch (glFormat) {
+  case GL_RGBA8:
+    return "RGBA8";
+  case GL_RGBA16:
+    return "RGBA16";
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    return "BC1";
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    return "BC1A";
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    return "BC3";
+  case GL_COMPRESSED_RED_RGTC1:
+    return "BC4";
+  case GL_COMPRESSED_RG_RGTC2:
+    return "BC5";
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+    return "BC7";
+  default:
+    return "none";
+  }
+}
+
+uint64_t getTriangleCount(int mode, uint64_t count)
+{
+  switch (mode) {
+  case TINYGLTF_MODE_TRIANGLES:
+    return count / 3;
+  case TINYGLTF_MODE_TRIANGLE_STRIP:
+  case TINYGLTF_MODE_TRIANGLE_FAN:
+    return count >= 3 ? count - 2 : 0;
+  default:
+    return 0;
+  }
+}
+
+uint64_t getAccessorBytes(const tinygltf::Accessor &accessor)
+{
+  const int componentSize =
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType));
+  const int componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+  return componentSize > 0 && componentCount > 0
+             ? uint64_t(componentSize) * componentCount * accessor.count
+             : 0;
+}
+
+// All attributes of a primitive have the same count
+uint64_t getVertexCount(
+    const tinygltf::Model &model, const tinygltf::Primitive &primitive)
+{
+  if (primitive.attributes.empty()) {
+    return 0;
+  }
+  auto it = primitive.attributes.find("POSITION");
+  if (it == end(primitive.attributes)) {
+    it = begin(primitive.attributes);
+  }
+  return size_t((*it).second) < model.accessors.size()
+             ? model.accessors[(*it).second].count
+             : 0;
+}
+
+// Walk of the indices of primitives with the same indices, vertex count and
+// mode
+struct IndexWalk
+{
+  int indices = -1; // Accessor index
+  uint64_t vertexCount = 0;
+  int mode = TINYGLTF_MODE_TRIANGLES;
+  uint64_t unreferencedVertexCount = 0;
+  uint64_t degenerateTriangleCount = 0;
+  uint64_t invalidIndexCount = 0;
+  VertexCacheStats vertexCache, optimizedVertexCache;
+};
+
+template <typename IndexType>
+void walkIndices(const unsigned char *bytes, size_t byteStride, size_t count,
+    IndexWalk &walk)
+{
+  const auto readIndex = [&](size_t i) {
+    IndexType index;
+    std::memcpy(&index, bytes + i * byteStride, sizeof(index));
+    return uint64_t(index);
+  };
+  std::vector<bool> isReferenced(walk.vertexCount, false);
+  for (size_t i = 0; i < count; ++i) {
+    const auto index = readIndex(i);
+    if (index < walk.vertexCount) {
+      isReferenced[index] = true;
+    } else {
+      ++walk.invalidIndexCount;
+    }
+  }
+  walk.unreferencedVertexCount = uint64_t(
+      std::count(begin(isReferenced), end(isReferenced), false));
+  // Degenerate triangles of strips are usually restarts, not counted
+  if (walk.mode == TINYGLTF_MODE_TRIANGLES) {
+    for (size_t i = 0; i + 3 <= count; i += 3) {
+      const auto a = readIndex(i), b = readIndex(i + 1), c = readIndex(i + 2);
+      if (a == b || b == c || a == c) {
+        ++walk.degenerateTriangleCount;
+      }
+    }
+  }
+
+  if (walk.mode == TINYGLTF_MODE_TRIANGLES && walk.invalidIndexCount == 0) {
+    std::vector<uint32_t> indices(count);
+    for (size_t i = 0; i < count; ++i) {
+      indices[i] = uint32_t(readIndex(i));
+    }
+    walk.vertexCache =
+        analyzeVertexCache(indices.data(), count, walk.vertexCount);
+    optimizeVertexCache(indices.data(), count, walk.vertexCount);
+    walk.optimizedVertexCache =
+        analyzeVertexCache(indices.data(), count, walk.vertexCount);
+  }
+}
+
+void walkIndices(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, IndexWalk &walk)
+{
+  const auto &accessor = model.accessors[walk.indices];
+  const auto indexSize = size_t(
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType)));
+  if (accessor.count == 0 || accessor.bufferView < 0 ||
+      size_t(accessor.bufferView) >= model.bufferViews.size() ||
+      (indexSize != 1 && indexSize != 2 && indexSize != 4)) {
+    return;
+  }
+  const auto &bufferView = model.bufferViews[accessor.bufferView];
+  const auto byteStride =
+      bufferView.byteStride ? bufferView.byteStride : indexSize;
+  const auto byteOffset = bufferView.byteOffset + accessor.byteOffset;
+  if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= buffers.size() ||
+      byteOffset + (accessor.count - 1) * byteStride + indexSize >
+          buffers[bufferView.buffer].size) {
+    walk.invalidIndexCount = accessor.count;
+    return;
+  }
+  const auto *bytes = buffers[bufferView.buffer].data + byteOffset;
+  switch (indexSize) {
+  case 1:
+    walkIndices<uint8_t>(bytes, byteStride, accessor.count, walk);
+    break;
+  case 2:
+    walkIndices<uint16_t>(bytes, byteStride, accessor.count, walk);
+    break;
+  default:
+    walkIndices<uint32_t>(bytes, byteStride, accessor.count, walk);
+  }
+}
+
+uint64_t hashBufferView(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, size_t bufferViewIdx)
+{
+  const auto &bufferView = model.bufferViews[bufferViewIdx];
+  if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= buffers.size() ||
+      bufferView.byteOffset + bufferView.byteLength >
+          buffers[bufferView.buffer].size) {
+    return 0;
+  }
+  return hashBytes(buffers[bufferView.buffer].data + bufferView.byteOffset,
+      bufferView.byteLength);
+}
+
+bool haveSameBytes(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, size_t bufferViewIdx1,
+    size_t bufferViewIdx2)
+{
+  const auto &bufferView1 = model.bufferViews[bufferViewIdx1];
+  const auto &bufferView2 = model.bufferViews[bufferViewIdx2];
+  return bufferView1.byteLength == bufferView2.byteLength &&
+         std::memcmp(buffers[bufferView1.buffer].data + bufferView1.byteOffset,
+             buffers[bufferView2.buffer].data + bufferView2.byteOffset,
+             bufferView1.byteLength) == 0;
+}
+
+SceneStats::Texture getTextureStats(const tinygltf::Model &model,
+    const GltfLoader &loader, size_t texIdx)
+{
+  const auto &texture = model.textures[texIdx];
+  SceneStats::Texture stats;
+  stats.index = int(texIdx);
+  stats.image = texture.source;
+  stats.name = texture.name;
+  if (texture.source < 0 || size_t(texture.source) >= model.images.size()) {
+    return stats;
+  }
+  const auto &image = model.images[texture.source];
+  if (stats.name.empty()) {
+    stats.name = !image.name.empty() ? image.name : image.uri;
+  }
+  const bool mipmaps = usesMipmaps(extractTexture(model, texture).minFilter);
+  if (const auto *compressed = loader.compressedImage(texture.source)) {
+    stats.width = compressed->levels[0].width;
+    stats.height = compressed->levels[0].height;
+    stats.levelCount = mipmaps ? uint32_t(compressed->levels.size()) : 1;
+    stats.glFormat = compressed->glFormat;
+    for (uint32_t level = 0; level < stats.levelCount; ++level) {
+      stats.vramBytes += compressed->levels[level].texels.size;
+    }
+    return stats;
+  }
+  if (image.width <= 0 || image.height <= 0) {
+    return stats; // Its header could not be read
+  }
+  stats.width = uint32_t(image.width);
+  stats.height = uint32_t(image.height);
+  stats.levelCount =
+      mipmaps ? uint32_t(getMipLevelCount(image.width, image.height)) : 1;
+  stats.glFormat = image.bits == 16 ? GL_RGBA16 : GL_RGBA8;
+  const uint64_t texelSize = image.bits == 16 ? 8 : 4;
+  for (uint32_t level = 0; level < stats.levelCount; ++level) {
+    stats.vramBytes += texelSize * std::max(stats.width >> level, 1u) *
+                       std::max(stats.height >> level, 1u);
+  }
+  return stats;
+}
+
+template <typename T> std::vector<T> getTop(std::vector<T> items, size_t count)
+{
+  if (count > 0 && items.size() > count) {
+    items.resize(count);
+  }
+  return items;
+}
+
+} // namespace
+
+bool computeSceneStats(const fs::path &path, ThreadPool &threadPool,
+    SceneStats &stats, std::string *err, std::string *warn)
+{
+  GltfLoader loader{&threadPool};
+  loader.setDeferImageDecoding(true);
+  loader.setCompressedFormats(getDesktopCompressedFormats());
+  tinygltf::Model model;
+  if (!loader.load(path, model, err, warn)) {
+    return false;
+  }
+  const auto &buffers = loader.bufferSpans();
+
+  stats = SceneStats{};
+  stats.nodeCount = model.nodes.size();
+  stats.meshCount = model.meshes.size();
+  stats.materialCount = model.materials.size();
+  stats.textureCount = model.textures.size();
+  stats.imageCount = model.images.size();
+  stats.accessorCount = model.accessors.size();
+  stats.bufferViewCount = model.bufferViews.size();
+
+  // Primitives with the same indices and vertex count share their walk
+  std::vector<IndexWalk> walks;
+  std::map<std::tuple<int, uint64_t, int>, size_t> walksByKey;
+  std::vector<std::vector<size_t>> primitiveWalks(model.meshes.size());
+  for (size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx) {
+    for (const auto &primitive : model.meshes[meshIdx].primitives) {
+      ++stats.primitiveCount;
+      if (primitive.indices < 0 ||
+          size_t(primitive.indices) >= model.accessors.size()) {
+        continue;
+      }
+      IndexWalk walk;
+      walk.indices = primitive.indices;
+      walk.vertexCount = getVertexCount(model, primitive);
+      walk.mode = primitive.mode;
+      const auto key =
+          std::make_tuple(walk.indices, walk.vertexCount, walk.mode);
+      const auto it = walksByKey.find(key);
+      if (it != end(walksByKey)) {
+        primitiveWalks[meshIdx].push_back(it->second);
+      } else {
+        walksByKey[key] = walks.size();
+        primitiveWalks[meshIdx].push_back(walks.size());
+        walks.push_back(walk);
+      }
+    }
+  }
+
+  // Index walks first, they are the longest tasks
+  std::vector<uint64_t> bufferViewHashes(model.bufferViews.size(), 0);
+  std::vector<std::string> imageErrors(model.images.size());
+  const auto walkCount = walks.size();
+  const auto bufferViewCount = model.bufferViews.size();
+  threadPool.parallelFor(
+      walkCount + bufferViewCount + model.images.size(), [&](size_t i) {
+        if (i < walkCount) {
+          walkIndices(model, buffers, walks[i]);
+        } else if (i < walkCount + bufferViewCount) {
+          const auto bufferViewIdx = i - walkCount;
+          bufferViewHashes[bufferViewIdx] =
+              hashBufferView(model, buffers, bufferViewIdx);
+        } else {
+          const auto imageIdx = int(i - walkCount - bufferViewCount);
+          loader.readImageHeader(model, imageIdx, &imageErrors[imageIdx]);
+        }
+      });
+  for (const auto &imageError : imageErrors) {
+    *warn += imageError;
+  }
+
+  // Meshes, and their instances in the default scene grouped as the viewer
+  // draws them: nodes and their EXT_mesh_gpu_instancing instances, in group
+  // 2 * mesh + 1 if they are mirrored
+  const auto scene = extractScene(model, loader.bufferSpans());
+  std::vector<uint64_t> groupInstanceCounts(2 * scene.meshes.size(), 0);
+  const std::function<void(uint32_t, bool)> countInstances =
+      [&](uint32_t nodeIdx, bool mirrored) {
+        const auto &node = scene.nodes[nodeIdx];
+        mirrored = mirrored != isMirroring(node.localMatrix);
+        if (node.mesh >= 0 && node.instanceCount == 0) {
+          ++groupInstanceCounts[2 * node.mesh + mirrored];
+        }
+        for (uint32_t instanceIdx = 0;
+             node.mesh >= 0 && instanceIdx < node.instanceCount;
+             ++instanceIdx) {
+          const auto &instanceMatrix =
+              scene.instanceMatrices[node.firstInstance + instanceIdx];
+          ++groupInstanceCounts[2 * node.mesh +
+                                (mirrored != isMirroring(instanceMatrix))];
+        }
+        for (uint32_t i = 0; i < node.childCount; ++i) {
+          countInstances(scene.children[node.firstChild + i], mirrored);
+        }
+      };
+  for (const auto nodeIdx : scene.rootNodes) {
+    countInstances(nodeIdx, false);
+  }
+  for (size_t meshIdx = 0; meshIdx < model.meshes.size(); ++meshIdx) {
+    const auto &mesh = model.meshes[meshIdx];
+    SceneStats::Mesh meshStats;
+    meshStats.index = int(meshIdx);
+    meshStats.name = mesh.name;
+    const auto instanceCount =
+        groupInstanceCounts[2 * meshIdx] + groupInstanceCounts[2 * meshIdx + 1];
+    meshStats.instanceCount = uint32_t(instanceCount);
+    for (const auto &primitive : mesh.primitives) {
+      const auto vertexCount = getVertexCount(model, primitive);
+      const auto hasIndices =
+          primitive.indices >= 0 &&
+          size_t(primitive.indices) < model.accessors.size();
+      const auto count =
+          hasIndices ? model.accessors[primitive.indices].count : vertexCount;
+      meshStats.triangleCount += getTriangleCount(primitive.mode, count);
+      meshStats.vertexCount += vertexCount;
+      for (const auto &attribute : primitive.attributes) {
+        if (size_t(attribute.second) < model.accessors.size()) {
+          meshStats.geometryBytes +=
+              getAccessorBytes(model.accessors[attribute.second]);
+        }
+      }
+      if (hasIndices) {
+        meshStats.geometryBytes +=
+            getAccessorBytes(model.accessors[primitive.indices]);
+      }
+    }
+    for (const auto walkIdx : primitiveWalks[meshIdx]) {
+      const auto &walk = walks[walkIdx];
+      stats.unreferencedVertexCount += walk.unreferencedVertexCount;
+      stats.degenerateTriangleCount += walk.degenerateTriangleCount;
+      stats.invalidIndexCount += walk.invalidIndexCount;
+      stats.vertexCache += walk.vertexCache;
+      stats.optimizedVertexCache += walk.optimizedVertexCache;
+    }
+    // A draw call per primitive for each kMaxDrawInstances of a group
+    const auto getDrawCount = [](uint64_t instanceCount) {
+      return (instanceCount + kMaxDrawInstances - 1) / kMaxDrawInstances;
+    };
+    stats.drawCallCount +=
+        uint64_t(mesh.primitives.size()) *
+        (getDrawCount(groupInstanceCounts[2 * meshIdx]) +
+            getDrawCount(groupInstanceCounts[2 * meshIdx + 1]));
+    stats.triangleCount += meshStats.triangleCount * instanceCount;
+    stats.vertexCount += meshStats.vertexCount * instanceCount;
+    stats.meshTriangleCount += meshStats.triangleCount;
+    stats.meshVertexCount += meshStats.vertexCount;
+    stats.meshes.push_back(meshStats);
+  }
+
+  // Buffers, as the viewer uploads them
+  const auto layout = computeGpuBufferLayout(scene);
+  for (size_t bufferIdx = 0; bufferIdx < model.buffers.size(); ++bufferIdx) {
+    const auto &buffer = model.buffers[bufferIdx];
+    SceneStats::Buffer bufferStats;
+    bufferStats.index = int(bufferIdx);
+    bufferStats.name = !buffer.name.empty() ? buffer.name : buffer.uri;
+    bufferStats.byteLength =
+        bufferIdx < buffers.size() ? buffers[bufferIdx].size : 0;
+    stats.buffers.push_back(bufferStats);
+  }
+  for (const auto &range : layout.ranges) {
+    stats.buffers[range.sceneBuffer].vramBytes += range.byteLength;
+  }
+  stats.bufferVramBytes = layout.uploadedSize();
+
+  // Hashes only select the bufferViews to compare
+  std::multimap<uint64_t, size_t> bufferViewsByHash;
+  for (size_t bufferViewIdx = 0; bufferViewIdx < bufferViewCount;
+       ++bufferViewIdx) {
+    const auto hash = bufferViewHashes[bufferViewIdx];
+    if (hash == 0) {
+      continue;
+    }
+    const auto range = bufferViewsByHash.equal_range(hash);
+    const bool isDuplicate =
+        std::any_of(range.first, range.second, [&](const auto &other) {
+          return haveSameBytes(model, buffers, other.second, bufferViewIdx);
+        });
+    if (isDuplicate) {
+      stats.duplicatedBufferViewBytes +=
+          model.bufferViews[bufferViewIdx].byteLength;
+    } else {
+      bufferViewsByHash.emplace(hash, bufferViewIdx);
+    }
+  }
+
+  // Textures, one texture object each
+  std::map<std::pair<uint64_t, uint32_t>, size_t> texturesByImage;
+  for (size_t texIdx = 0; texIdx < model.textures.size(); ++texIdx) {
+    const auto textureStats = getTextureStats(model, loader, texIdx);
+    stats.textureVramBytes += textureStats.vramBytes;
+    if (textureStats.vramBytes > 0) {
+      const auto key = std::make_pair(
+          loader.imageHash(textureStats.image), textureStats.levelCount);
+      if (texturesByImage.count(key)) {
+        stats.duplicatedTextureBytes += textureStats.vramBytes;
+      } else {
+        texturesByImage[key] = texIdx;
+      }
+    }
+    stats.textures.push_back(textureStats);
+  }
+
+  std::stable_sort(begin(stats.buffers), end(stats.buffers),
+      [](const SceneStats::Buffer &a, const SceneStats::Buffer &b) {
+        return a.vramBytes > b.vramBytes;
+      });
+  std::stable_sort(begin(stats.textures), end(stats.textures),
+      [](const SceneStats::Texture &a, const SceneStats::Texture &b) {
+        return a.vramBytes > b.vramBytes;
+      });
+  std::stable_sort(begin(stats.meshes), end(stats.meshes),
+      [](const SceneStats::Mesh &a, const SceneStats::Mesh &b) {
+        return a.geometryBytes > b.geometryBytes;
+      });
+  return true;
+}
+
+void printSceneStats(
+    const SceneStats &stats, std::ostream &out, size_t topCount)
+{
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(2);
+  const auto printRow = [&](const char *name, const auto &value) {
+    out << "  " << std::left << std::setw(28) << name << std::right
+        << std::setw(16) << value << std::endl;
+  };
+
+  out << "Objects:" << std::endl;
+  printRow("nodes", stats.nodeCount);
+  printRow("meshes", stats.meshCount);
+  printRow("primitives", stats.primitiveCount);
+  printRow("materials", stats.materialCount);
+  printRow("textures", stats.textureCount);
+  printRow("images", stats.imageCount);
+  printRow("accessors", stats.accessorCount);
+  printRow("bufferViews", stats.bufferViewCount);
+  out << "Default scene, per frame:" << std::endl;
+  printRow("draw calls", stats.drawCallCount);
+  printRow("triangles", stats.triangleCount);
+  printRow("vertices", stats.vertexCount);
+  out << "Meshes, each counted once:" << std::endl;
+  printRow("triangles", stats.meshTriangleCount);
+  printRow("vertices", stats.meshVertexCount);
+  printRow("unreferenced vertices", stats.unreferencedVertexCount);
+  printRow("degenerate triangles", stats.degenerateTriangleCount);
+  printRow("invalid indices", stats.invalidIndexCount);
+  out << "Vertex cache (FIFO of " << kVertexCacheSize
+      << " vertices), triangle lists:" << std::endl;
+  printRow("ACMR", stats.vertexCache.acmr());
+  printRow("ACMR optimized", stats.optimizedVertexCache.acmr());
+  printRow("ATVR", stats.vertexCache.atvr());
+  printRow("ATVR optimized", stats.optimizedVertexCache.atvr());
+  out << "Estimated VRAM (MB):" << std::endl;
+  printRow("buffers", stats.bufferVramBytes / kBytesPerMB);
+  printRow("textures", stats.textureVramBytes / kBytesPerMB);
+  printRow("total",
+      (stats.bufferVramBytes + stats.textureVramBytes) / kBytesPerMB);
+  out << "Duplicated data (MB):" << std::endl;
+  printRow("bufferViews", stats.duplicatedBufferViewBytes / kBytesPerMB);
+  printRow("textures", stats.duplicatedTextureBytes / kBytesPerMB);
+
+  const auto buffers = getTop(stats.buffers, topCount);
+  if (!buffers.empty()) {
+    out << "Largest buffers:" << std::endl;
+    out << std::setw(8) << "index" << std::setw(12) << "VRAM (MB)"
+        << std::setw(12) << "size (MB)"
+        << "  name" << std::endl;
+    for (const auto &buffer : buffers) {
+      out << std::setw(8) << buffer.index << std::setw(12)
+          << buffer.vramBytes / kBytesPerMB << std::setw(12)
+          << buffer.byteLength / kBytesPerMB << "  " << buffer.name
+          << std::endl;
+    }
+  }
+  const auto textures = getTop(stats.textures, topCount);
+  if (!textures.empty()) {
+    out << "Largest textures:" << std::endl;
+    out << std::setw(8) << "index" << std::setw(12) << "VRAM (MB)"
+        << std::setw(12) << "size" << std::setw(8) << "levels" << std::setw(8)
+        << "format"
+        << "  name" << std::endl;
+    for (const auto &texture : textures) {
+      out << std::setw(8) << texture.index << std::setw(12)
+          << texture.vramBytes / kBytesPerMB << std::setw(12)
+          << (std::to_string(texture.width) + "x" +
+                 std::to_string(texture.height))
+          << std::setw(8) << texture.levelCount << std::setw(8)
+          << getFormatName(texture.glFormat) << "  " << texture.name
+          << std::endl;
+    }
+  }
+  const auto meshes = getTop(stats.meshes, topCount);
+  if (!meshes.empty()) {
+    out << "Largest meshes:" << std::endl;
+    out << std::setw(8) << "index" << std::setw(12) << "size (MB)"
+        << std::setw(12) << "triangles" << std::setw(12) << "instances"
+        << "  name" << std::endl;
+    for (const auto &mesh : meshes) {
+      out << std::setw(8) << mesh.index << std::setw(12)
+          << mesh.geometryBytes / kBytesPerMB << std::setw(12)
+          << mesh.triangleCount << std::setw(12) << mesh.instanceCount << "  "
+          << mesh.name << std::endl;
+    }
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void printSceneStatsJson(
+    const SceneStats &stats, std::ostream &out, size_t topCount)
+{
+  auto buffers = nlohmann::json::array();
+  for (const auto &buffer : getTop(stats.buffers, topCount)) {
+    buffers.push_back({{"index", buffer.index}, {"name", buffer.name},
+        {"byte_length", buffer.byteLength},
+        {"vram_bytes", buffer.vramBytes}});
+  }
+  auto textures = nlohmann::json::array();
+  for (const auto &texture : getTop(stats.textures, topCount)) {
+    textures.push_back({{"index", texture.index}, {"name", texture.name},
+        {"image", texture.image}, {"width", texture.width},
+        {"height", texture.height}, {"levels", texture.levelCount},
+        {"format", getFormatName(texture.glFormat)},
+        {"vram_bytes", texture.vramBytes}});
+  }
+  auto meshes = nlohmann::json::array();
+  for (const auto &mesh : getTop(stats.meshes, topCount)) {
+    meshes.push_back({{"index", mesh.index}, {"name", mesh.name},
+        {"instances", mesh.instanceCount}, {"triangles", mesh.triangleCount},
+        {"vertices", mesh.vertexCount},
+        {"geometry_bytes", mesh.geometryBytes}});
+  }
+  const nlohmann::json document = {
+      {"counts",
+          {{"nodes", stats.nodeCount}, {"meshes", stats.meshCount},
+              {"primitives", stats.primitiveCount},
+              {"materials", stats.materialCount},
+              {"textures", stats.textureCount}, {"images", stats.imageCount},
+              {"accessors", stats.accessorCount},
+              {"buffer_views", stats.bufferViewCount}}},
+      {"frame",
+          {{"draw_calls", stats.drawCallCount},
+              {"triangles", stats.triangleCount},
+              {"vertices", stats.vertexCount}}},
+      {"meshes_total",
+          {{"triangles", stats.meshTriangleCount},
+              {"vertices", stats.meshVertexCount},
+              {"unreferenced_vertices", stats.unreferencedVertexCount},
+              {"degenerate_triangles", stats.degenerateTriangleCount},
+              {"invalid_indices", stats.invalidIndexCount}}},
+      {"vertex_cache",
+          {{"cache_size", kVertexCacheSize},
+              {"acmr", stats.vertexCache.acmr()},
+              {"atvr", stats.vertexCache.atvr()},
+              {"optimized_acmr", stats.optimizedVertexCache.acmr()},
+              {"optimized_atvr", stats.optimizedVertexCache.atvr()}}},
+      {"vram",
+          {{"buffers_bytes", stats.bufferVramBytes},
+              {"textures_bytes", stats.textureVramBytes},
+              {"total_bytes", stats.bufferVramBytes + stats.textureVramBytes}}},
+      {"duplicated",
+          {{"buffer_views_bytes", stats.duplicatedBufferViewBytes},
+              {"textures_bytes", stats.duplicatedTextureBytes}}},
+      {"largest_buffers", buffers}, {"largest_textures", textures},
+      {"largest_meshes", meshes}};
+  out << document.dump(2) << std::endl;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "thread_pool.hpp"
+#include "vertex_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Statistics of a glTF file computed by the "stats" command, without a GL
+// context.
+//
+// VRAM is estimated from what the viewer uploads: the bytes of buffers that
+// primitives reference (see GpuBufferLayout), and one texture object per
+// texture with RGBA8 (RGBA16 for 16-bit images) or KTX2 compressed levels,
+// with a full mipmap chain if its sampler uses mipmaps.
+// KTX2 formats are assumed to be supported as on desktop drivers.
+struct SceneStats
+{
+  struct Buffer
+  {
+    int index = -1;
+    std::string name; // glTF name, or uri
+    uint64_t byteLength = 0;
+    uint64_t vramBytes = 0; // Bytes referenced by primitives
+  };
+
+  struct Texture
+  {
+    int index = -1;
+    std::string name; // glTF name of the texture, or uri of its image
+    int image = -1;
+    uint32_t width = 0, height = 0;
+    uint32_t levelCount = 0;
+    uint32_t glFormat = 0; // Internal format
+    uint64_t vramBytes = 0;
+  };
+
+  struct Mesh
+  {
+    int index = -1;
+    std::string name;
+    // Nodes of the default scene using it, and their EXT_mesh_gpu_instancing
+    // instances
+    uint32_t instanceCount = 0;
+    uint64_t triangleCount = 0; // Of one instance
+    uint64_t vertexCount = 0; // Of one instance
+    uint64_t geometryBytes = 0; // Bytes of its attributes and indices
+  };
+
+  size_t nodeCount = 0;
+  size_t meshCount = 0;
+  size_t primitiveCount = 0;
+  size_t materialCount = 0;
+  size_t textureCount = 0;
+  size_t imageCount = 0;
+  size_t accessorCount = 0;
+  size_t bufferViewCount = 0;
+
+  // Drawn by a frame of the default scene, each mesh instance counted. The
+  // viewer draws up to 64 instances of a mesh with the same winding per
+  // draw call.
+  uint64_t drawCallCount = 0;
+  uint64_t triangleCount = 0;
+  uint64_t vertexCount = 0;
+  // Of all meshes, each counted once
+  uint64_t meshTriangleCount = 0;
+  uint64_t meshVertexCount = 0;
+
+  // Found by walking the indices of indexed primitives
+  uint64_t unreferencedVertexCount = 0; // Vertices that no index references
+  uint64_t degenerateTriangleCount = 0; // With two identical indices
+  uint64_t invalidIndexCount = 0; // Out of the bounds of the vertices
+  // Of indexed triangle lists in their order, and once optimized as with
+  // --optimize-vertex-cache
+  VertexCacheStats vertexCache;
+  VertexCacheStats optimizedVertexCache;
+
+  uint64_t bufferVramBytes = 0;
+  uint64_t textureVramBytes = 0;
+  // Bytes of bufferViews with the same content as another one
+  uint64_t duplicatedBufferViewBytes = 0;
+  // VRAM of textures uploading the same image as another one, whether they
+  // share the image or their images have the same bytes
+  uint64_t duplicatedTextureBytes = 0;
+
+  std::vector<Buffer> buffers; // By decreasing VRAM
+  std::vector<Texture> textures; // By decreasing VRAM
+  std::vector<Mesh> meshes; // By decreasing geometry bytes
+};
+
+// Load a glTF file and compute its statistics. Images are not decoded, only
+// their headers are read. Index walks, bufferView hashing and image headers
+// are processed in parallel on threadPool. Returns false and fill err if the
+// file cannot be loaded.
+bool computeSceneStats(const fs::path &path, ThreadPool &threadPool,
+    SceneStats &stats, std::string *err, std::string *warn);
+
+// Human-readable report, listing the topCount largest buffers, textures and
+// meshes (all of them if topCount is 0)
+void printSceneStats(
+    const SceneStats &stats, std::ostream &out, size_t topCount);
+
+// Same report as a JSON document
+void printSceneStatsJson(
+    const SceneStats &stats, std::ostream &out, size_t topCount);
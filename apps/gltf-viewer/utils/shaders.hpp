@@ -66,7 +66,9 @@ public:
   }
 };
 
-inline std::string loadShaderSource(const fs::path &filepath)
+// defines are inserted after the #version line, if any
+inline std::string loadShaderSource(
+    const fs::path &filepath, const std::string &defines = {})
 {
   std::ifstream input(filepath.string());
   if (!input) {
@@ -78,7 +80,15 @@ inline std::string loadShaderSource(const fs::path &filepath)
   std::stringstream buffer;
   buffer << input.rdbuf();
 
-  return buffer.str();
+  auto source = buffer.str();
+  if (!defines.empty()) {
+    const auto version = source.find("#version");
+    const auto lineEnd = version == std::string::npos
+                             ? std::string::npos
+                             : source.find('\n', version);
+    source.insert(lineEnd == std::string::npos ? 0 : lineEnd + 1, defines);
+  }
+  return source;
 }
 
 template <typename StringType>
@@ -98,7 +108,8 @@ GLShader compileShader(GLenum type, StringType &&src)
 // *.fs.glsl -> fragment shader
 // *.gs.glsl -> geometry shader
 // *.cs.glsl -> compute shader
-inline GLShader loadShader(const fs::path &shaderPath)
+inline GLShader loadShader(
+    const fs::path &shaderPath, const std::string &defines = {})
 {
   static auto extToShaderType =
       std::unordered_map<std::string, std::pair<GLenum, std::string>>(
@@ -118,7 +129,7 @@ inline GLShader loadShader(const fs::path &shaderPath)
             << "\n";
 
   GLShader shader{(*it).second.first};
-  shader.setSource(loadShaderSource(shaderPath));
+  shader.setSource(loadShaderSource(shaderPath, defines));
   shader.compile();
   if (!shader.getCompileStatus()) {
     std::cerr << "Shader compilation error:" << shader.getInfoLog()
@@ -244,11 +255,12 @@ template <typename CSrc> GLProgram buildComputeProgram(CSrc &&src)
   ;
 }
 
-inline GLProgram compileProgram(std::vector<fs::path> shaderPaths)
+inline GLProgram compileProgram(
+    std::vector<fs::path> shaderPaths, const std::string &defines = {})
 {
   GLProgram program;
   for (const auto &path : shaderPaths) {
-    auto shader = loadShader(path);
+    auto shader = loadShader(path, defines);
     program.attachShader(shader);
   }
   program.link();
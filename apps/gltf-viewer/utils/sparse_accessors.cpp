@@ -0,0 +1,284 @@
+#include "sparse_accessors.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+
+namespace
+{
+
+// Dense values to compute, for one or several identical sparse accessors
+struct DenseAccessor
+{
+  const tinygltf::Accessor *accessor = nullptr; // The first of them
+  size_t elementSize = 0;
+  BufferSpan base; // Empty if the base values are zeros
+  size_t baseStride = 0;
+  BufferSpan indices;
+  size_t indexSize = 0;
+  BufferSpan values;
+  size_t byteOffset = 0; // In storage
+};
+
+size_t getElementSize(const tinygltf::Accessor &accessor)
+{
+  const int componentSize =
+      tinygltf::GetComponentSizeInBytes(uint32_t(accessor.componentType));
+  const int componentCount = tinygltf::GetNumComponentsInType(accessor.type);
+  return componentSize > 0 && componentCount > 0
+             ? size_t(componentSize) * size_t(componentCount)
+             : 0;
+}
+
+// Bytes [byteOffset, byteOffset + byteLength) of a bufferView, empty if out of
+// bounds
+BufferSpan getBufferViewRange(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers, int bufferViewIdx,
+    size_t byteOffset, size_t byteLength)
+{
+  if (bufferViewIdx < 0 || size_t(bufferViewIdx) >= model.bufferViews.size()) {
+    return {};
+  }
+  const auto &bufferView = model.bufferViews[bufferViewIdx];
+  if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= buffers.size() ||
+      byteOffset + byteLength > bufferView.byteLength ||
+      bufferView.byteOffset + bufferView.byteLength >
+          buffers[bufferView.buffer].size) {
+    return {};
+  }
+  return {buffers[bufferView.buffer].data + bufferView.byteOffset + byteOffset,
+      byteLength};
+}
+
+bool setupDenseAccessor(const tinygltf::Model &model,
+    const std::vector<BufferSpan> &buffers,
+    const tinygltf::Accessor &accessor, DenseAccessor &dense)
+{
+  const auto &sparse = accessor.sparse;
+  dense.accessor = &accessor;
+  dense.elementSize = getElementSize(accessor);
+  dense.indexSize = size_t(tinygltf::GetComponentSizeInBytes(
+      uint32_t(sparse.indices.componentType)));
+  if (dense.elementSize == 0 || sparse.count < 0 ||
+      size_t(sparse.count) > accessor.count ||
+      (dense.indexSize != 1 && dense.indexSize != 2 && dense.indexSize != 4)) {
+    return false;
+  }
+  if (accessor.bufferView >= 0) {
+    const auto &bufferView = model.bufferViews[accessor.bufferView];
+    dense.baseStride =
+        bufferView.byteStride ? bufferView.byteStride : dense.elementSize;
+    const size_t baseSize = accessor.count == 0
+                                ? 0
+                                : (accessor.count - 1) * dense.baseStride +
+                                      dense.elementSize;
+    dense.base = getBufferViewRange(
+        model, buffers, accessor.bufferView, accessor.byteOffset, baseSize);
+    if (!dense.base.data && accessor.count > 0) {
+      return false;
+    }
+  }
+  const auto sparseCount = size_t(sparse.count);
+  dense.indices = getBufferViewRange(model, buffers, sparse.indices.bufferView,
+      size_t(sparse.indices.byteOffset), sparseCount * dense.indexSize);
+  dense.values = getBufferViewRange(model, buffers, sparse.values.bufferView,
+      size_t(sparse.values.byteOffset), sparseCount * dense.elementSize);
+  return sparseCount == 0 || (dense.indices.data && dense.values.data);
+}
+
+uint32_t readIndex(const DenseAccessor &dense, size_t i)
+{
+  const auto *bytes = dense.indices.data + i * dense.indexSize;
+  switch (dense.indexSize) {
+  case 1:
+    return *bytes;
+  case 2: {
+    uint16_t index;
+    std::memcpy(&index, bytes, sizeof(index));
+    return index;
+  }
+  default: {
+    uint32_t index;
+    std::memcpy(&index, bytes, sizeof(index));
+    return index;
+  }
+  }
+}
+
+// Tightly packed base values of dense
+void copyBase(const DenseAccessor &dense, unsigned char *output)
+{
+  const auto count = dense.accessor->count;
+  const auto elementSize = dense.elementSize;
+  if (!dense.base.data) {
+    std::memset(output, 0, count * elementSize);
+  } else if (dense.baseStride == elementSize) {
+    std::memcpy(output, dense.base.data, count * elementSize);
+  } else {
+    for (size_t i = 0; i < count; ++i) {
+      std::memcpy(output + i * elementSize,
+          dense.base.data + i * dense.baseStride, elementSize);
+    }
+  }
+}
+
+// Write the sparse values of dense over its base values in output. Returns
+// false if a sparse index is out of bounds.
+bool scatter(const DenseAccessor &dense, unsigned char *output)
+{
+  const auto count = dense.accessor->count;
+  const auto elementSize = dense.elementSize;
+
+  // Sparse indices are increasing, so values are scattered in one forward
+  // pass, runs of consecutive indices being copied at once
+  const size_t sparseCount = dense.values.size / elementSize;
+  for (size_t i = 0; i < sparseCount;) {
+    const auto first = readIndex(dense, i);
+    size_t runLength = 1;
+    while (i + runLength < sparseCount &&
+           readIndex(dense, i + runLength) == first + runLength) {
+      ++runLength;
+    }
+    if (first + runLength > count) {
+      return false;
+    }
+    std::memcpy(output + first * elementSize,
+        dense.values.data + i * elementSize, runLength * elementSize);
+    i += runLength;
+  }
+  return true;
+}
+
+} // namespace
+
+bool materializeSparseAccessors(tinygltf::Model &model,
+    std::vector<BufferSpan> &buffers, std::vector<unsigned char> &storage,
+    ThreadPool *threadPool, std::string *err)
+{
+  // Accessors with the same key have the same dense values
+  using Key = std::array<int64_t, 11>;
+  std::map<Key, size_t> denseIndices;
+  std::vector<DenseAccessor> denseAccessors;
+  std::vector<std::pair<size_t, size_t>> sparseAccessors; // With dense index
+  // Dense accessors with the same base values (bufferView, byteOffset, count,
+  // element size and stride, or zeros), whose base range is copied once
+  using BaseKey = std::array<int64_t, 5>;
+  std::map<BaseKey, size_t> groupIndices;
+  std::vector<std::vector<size_t>> groups;
+  for (size_t i = 0; i < model.accessors.size(); ++i) {
+    const auto &accessor = model.accessors[i];
+    if (!accessor.sparse.isSparse) {
+      continue;
+    }
+    const auto &sparse = accessor.sparse;
+    const Key key{{accessor.bufferView, int64_t(accessor.byteOffset),
+        accessor.componentType, accessor.type, int64_t(accessor.count),
+        sparse.count, sparse.indices.bufferView, sparse.indices.byteOffset,
+        sparse.indices.componentType, sparse.values.bufferView,
+        sparse.values.byteOffset}};
+    const auto it = denseIndices.find(key);
+    if (it != denseIndices.end()) {
+      sparseAccessors.emplace_back(i, it->second);
+      continue;
+    }
+    DenseAccessor dense;
+    if (!setupDenseAccessor(model, buffers, accessor, dense)) {
+      *err += "accessor[" + std::to_string(i) +
+              "] has invalid sparse storage.\n";
+      return false;
+    }
+    denseIndices[key] = denseAccessors.size();
+    sparseAccessors.emplace_back(i, denseAccessors.size());
+    const BaseKey baseKey{{dense.base.data ? accessor.bufferView : -1,
+        dense.base.data ? int64_t(accessor.byteOffset) : 0,
+        int64_t(accessor.count), int64_t(dense.elementSize),
+        int64_t(dense.baseStride)}};
+    const auto groupIt = groupIndices.emplace(baseKey, groups.size()).first;
+    if (groupIt->second == groups.size()) {
+      groups.emplace_back();
+    }
+    groups[groupIt->second].push_back(denseAccessors.size());
+    denseAccessors.emplace_back(dense);
+  }
+  if (denseAccessors.empty()) {
+    return true;
+  }
+
+  // Accessors of a same base are laid out next to each other, and groups of
+  // a same base bufferView too, aligned to 4 bytes as vertex attributes must
+  // be
+  std::vector<size_t> order(groups.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(begin(order), end(order), [&](size_t a, size_t b) {
+    return denseAccessors[groups[a].front()].accessor->bufferView <
+           denseAccessors[groups[b].front()].accessor->bufferView;
+  });
+  size_t storageSize = 0;
+  for (const auto groupIdx : order) {
+    for (const auto i : groups[groupIdx]) {
+      auto &dense = denseAccessors[i];
+      dense.byteOffset = storageSize;
+      storageSize +=
+          (dense.accessor->count * dense.elementSize + 3) & ~size_t(3);
+    }
+  }
+  storage.assign(storageSize, 0);
+
+  // The base range of a group is read once, into the values of its first
+  // accessor, then copied from there to the others before scattering
+  std::vector<char> succeeded(denseAccessors.size(), false);
+  const auto materializeGroup = [&](size_t groupIdx) {
+    const auto &group = groups[groupIdx];
+    const auto &first = denseAccessors[group.front()];
+    const auto *base = storage.data() + first.byteOffset;
+    copyBase(first, storage.data() + first.byteOffset);
+    for (size_t k = 1; k < group.size(); ++k) {
+      const auto &dense = denseAccessors[group[k]];
+      std::memcpy(storage.data() + dense.byteOffset, base,
+          dense.accessor->count * dense.elementSize);
+    }
+    for (const auto i : group) {
+      const auto &dense = denseAccessors[i];
+      succeeded[i] = scatter(dense, storage.data() + dense.byteOffset);
+    }
+  };
+  if (threadPool) {
+    threadPool->parallelFor(groups.size(), materializeGroup);
+  } else {
+    for (size_t i = 0; i < groups.size(); ++i) {
+      materializeGroup(i);
+    }
+  }
+  for (const auto &sparseAccessor : sparseAccessors) {
+    if (!succeeded[sparseAccessor.second]) {
+      *err += "accessor[" + std::to_string(sparseAccessor.first) +
+              "] has a sparse index out of bounds.\n";
+      return false;
+    }
+  }
+
+  const auto bufferIdx = int(model.buffers.size());
+  tinygltf::Buffer buffer;
+  buffer.name = "Materialized sparse accessors";
+  model.buffers.emplace_back(buffer);
+  buffers.push_back({storage.data(), storage.size()});
+
+  const auto firstBufferView = int(model.bufferViews.size());
+  for (const auto &dense : denseAccessors) {
+    tinygltf::BufferView bufferView;
+    bufferView.buffer = bufferIdx;
+    bufferView.byteOffset = dense.byteOffset;
+    bufferView.byteLength = dense.accessor->count * dense.elementSize;
+    model.bufferViews.emplace_back(bufferView);
+  }
+  for (const auto &sparseAccessor : sparseAccessors) {
+    auto &accessor = model.accessors[sparseAccessor.first];
+    accessor.bufferView = firstBufferView + int(sparseAccessor.second);
+    accessor.byteOffset = 0;
+    accessor.sparse.isSparse = false;
+  }
+  return true;
+}
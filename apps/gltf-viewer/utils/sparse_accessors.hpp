@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gltf.hpp"
+#include "thread_pool.hpp"
+
+#include <string>
+#include <tiny_gltf.h>
+#include <vector>
+
+// Replace the sparse accessors of model by dense ones, so that neither the
+// renderer nor CPU-side code (bounds, baking) has to know about sparse
+// storage.
+//
+// The dense values of all sparse accessors are materialized once into
+// storage, which is appended to model.buffers (with an empty uri) and to
+// buffers, each accessor getting a tightly packed bufferView of it. Sparse
+// accessors with the same base and the same sparse data share their dense
+// values. Those with only the same base range read it once, each scattering
+// its sparse values over a copy of it, and are laid out next to each other
+// like those of a same base bufferView. Bases are materialized in parallel
+// on threadPool if not null.
+//
+// buffers[i] are the bytes of model.buffers[i]. storage must stay alive and
+// unchanged as long as buffers are used. Returns false and fill err if an
+// accessor is out of bounds; model is then left unchanged.
+bool materializeSparseAccessors(tinygltf::Model &model,
+    std::vector<BufferSpan> &buffers, std::vector<unsigned char> &storage,
+    ThreadPool *threadPool, std::string *err);
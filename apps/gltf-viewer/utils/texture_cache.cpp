@@ -0,0 +1,184 @@
+#include "texture_cache.hpp"
+#include "hash.hpp"
+#include "images.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+
+const char kMagic[4] = {'G', 'V', 'T', 'C'};
+const uint32_t kVersion = 1;
+const size_t kLevelAlignment = 16;
+
+// Layout of a cache file: FileHeader, then levelCount uint64_t offsets of the
+// levels from the start of the file, then the texel data of each level
+struct FileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t components;
+  uint32_t bitsPerComponent;
+  uint32_t levelCount;
+  uint32_t reserved;
+};
+
+size_t alignOffset(size_t offset)
+{
+  return (offset + kLevelAlignment - 1) / kLevelAlignment * kLevelAlignment;
+}
+
+uint32_t getLevelCount(uint32_t width, uint32_t height)
+{
+  uint32_t levelCount = 1;
+  while ((std::max(width, height) >> levelCount) > 0) {
+    ++levelCount;
+  }
+  return levelCount;
+}
+
+uint32_t getLevelSize(uint32_t size, uint32_t level)
+{
+  return std::max(size >> level, 1u);
+}
+
+} // namespace
+
+TextureCache::TextureCache(const fs::path &directory) : m_Directory(directory)
+{
+  std::error_code error;
+  fs::create_directories(m_Directory, error);
+}
+
+uint64_t TextureCache::computeKey(const unsigned char *bytes, size_t size)
+{
+  // Seed with the format version so that entries are invalidated when it
+  // changes
+  return hashBytes(bytes, size, kVersion);
+}
+
+fs::path TextureCache::getEntryPath(uint64_t key) const
+{
+  return m_Directory / (hashToString(key) + ".gvtc");
+}
+
+bool TextureCache::find(uint64_t key, Entry &entry) const
+{
+  const auto path = getEntryPath(key);
+  if (!fs::exists(path)) {
+    return false;
+  }
+  try {
+    entry.file = MappedFile{path};
+  } catch (const std::runtime_error &) {
+    return false;
+  }
+
+  const auto *bytes = entry.file.data();
+  const auto size = entry.file.size();
+  FileHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, bytes, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion || header.width == 0 || header.height == 0 ||
+      header.components != 4 ||
+      (header.bitsPerComponent != 8 && header.bitsPerComponent != 16) ||
+      header.levelCount != getLevelCount(header.width, header.height) ||
+      size < sizeof(header) + header.levelCount * sizeof(uint64_t)) {
+    return false;
+  }
+
+  entry.components = header.components;
+  entry.bitsPerComponent = header.bitsPerComponent;
+  entry.levels.clear();
+  for (uint32_t level = 0; level < header.levelCount; ++level) {
+    uint64_t offset;
+    std::memcpy(&offset, bytes + sizeof(header) + level * sizeof(uint64_t),
+        sizeof(offset));
+    const auto width = getLevelSize(header.width, level);
+    const auto height = getLevelSize(header.height, level);
+    const size_t levelSize = size_t(width) * height * header.components *
+                             (header.bitsPerComponent / 8);
+    if (offset + levelSize > size) {
+      return false; // Truncated file
+    }
+    entry.levels.push_back({width, height, {bytes + offset, levelSize}});
+  }
+  return true;
+}
+
+bool TextureCache::store(uint64_t key, const tinygltf::Image &image) const
+{
+  if (image.image.empty() || image.width <= 0 || image.height <= 0 ||
+      image.component != 4 || (image.bits != 8 && image.bits != 16)) {
+    return false;
+  }
+
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.width = uint32_t(image.width);
+  header.height = uint32_t(image.height);
+  header.components = uint32_t(image.component);
+  header.bitsPerComponent = uint32_t(image.bits);
+  header.levelCount = getLevelCount(header.width, header.height);
+  header.reserved = 0;
+
+  std::vector<uint64_t> levelOffsets(header.levelCount);
+  size_t offset = sizeof(header) + header.levelCount * sizeof(uint64_t);
+  for (uint32_t level = 0; level < header.levelCount; ++level) {
+    offset = alignOffset(offset);
+    levelOffsets[level] = offset;
+    offset += size_t(getLevelSize(header.width, level)) *
+              getLevelSize(header.height, level) * header.components *
+              (header.bitsPerComponent / 8);
+  }
+
+  // Write to a temporary file then rename it, so that concurrent readers and
+  // writers never see a partial entry. Its name is random so that threads of
+  // distinct processes sharing the cache do not write to the same file.
+  const auto path = getEntryPath(key);
+  std::random_device random;
+  const uint64_t suffix =
+      (uint64_t(random()) << 32 | random()) ^
+      std::hash<std::thread::id>()(std::this_thread::get_id());
+  auto tmpPath = path;
+  tmpPath += "." + hashToString(suffix) + ".tmp";
+  {
+    std::ofstream output(tmpPath.string(), std::ios::binary);
+    if (!output) {
+      return false;
+    }
+    output.write((const char *)&header, sizeof(header));
+    output.write((const char *)levelOffsets.data(),
+        std::streamsize(levelOffsets.size() * sizeof(uint64_t)));
+    computeMipmaps(header.width, header.height, header.components,
+        header.bitsPerComponent, image.image.data(),
+        [&](uint32_t level, uint32_t, uint32_t, const unsigned char *texels,
+            size_t byteCount) {
+          output.seekp(std::streamoff(levelOffsets[level]));
+          output.write((const char *)texels, std::streamsize(byteCount));
+        });
+    if (!output) {
+      output.close();
+      std::error_code error;
+      fs::remove(tmpPath, error);
+      return false;
+    }
+  }
+  std::error_code error;
+  fs::rename(tmpPath, path, error);
+  if (error) {
+    fs::remove(tmpPath, error);
+    return fs::exists(path); // Another thread may have stored it first
+  }
+  return true;
+}
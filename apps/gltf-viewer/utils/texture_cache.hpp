@@ -0,0 +1,46 @@
+#pragma once
+
+#include "filesystem.hpp"
+#include "gltf.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdint>
+#include <tiny_gltf.h>
+#include <vector>
+
+// On-disk cache of decoded images and their full mip chain.
+//
+// Entries are keyed by a hash of the encoded image bytes and stored as raw
+// files (a small header followed by the texel data of each level) that are
+// memory mapped on lookup, so a cache hit costs neither decoding nor mipmap
+// generation: levels can be uploaded directly from the mapping.
+class TextureCache
+{
+public:
+  // A mapped cache entry
+  struct Entry
+  {
+    MappedFile file;
+    uint32_t components; // Always 4 (RGBA)
+    uint32_t bitsPerComponent; // 8 or 16
+    std::vector<ImageLevel> levels; // levels[0] is the full resolution image
+  };
+
+  explicit TextureCache(const fs::path &directory);
+
+  static uint64_t computeKey(const unsigned char *bytes, size_t size);
+
+  // Map the entry of key, returns false on cache miss or if the entry is
+  // invalid
+  bool find(uint64_t key, Entry &entry) const;
+
+  // Compute the mip chain of a decoded RGBA image and store it under key.
+  // Several threads or processes can store concurrently, even the same key.
+  // Returns false if the entry could not be written.
+  bool store(uint64_t key, const tinygltf::Image &image) const;
+
+private:
+  fs::path getEntryPath(uint64_t key) const;
+
+  fs::path m_Directory;
+};
@@ -0,0 +1,292 @@
+#include "textures.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <iostream>
+
+bool usesMipmaps(int minFilter)
+{
+  return minFilter == GL_NEAREST_MIPMAP_NEAREST ||
+         minFilter == GL_NEAREST_MIPMAP_LINEAR ||
+         minFilter == GL_LINEAR_MIPMAP_NEAREST ||
+         minFilter == GL_LINEAR_MIPMAP_LINEAR;
+}
+
+void setSamplerParameters(
+    const tinygltf::Model &model, const tinygltf::Texture &texture)
+{
+  setSamplerParameters(extractTexture(model, texture));
+}
+
+void setSamplerParameters(const Scene::Texture &texture)
+{
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.minFilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.magFilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, texture.wrapS);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, texture.wrapT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, texture.wrapR);
+}
+
+GLsizei getMipLevelCount(GLsizei width, GLsizei height)
+{
+  return 1 + GLsizei(std::floor(std::log2(std::max(width, height))));
+}
+
+void uploadImageLevels(const std::vector<ImageLevel> &levels,
+    uint32_t bitsPerComponent, bool mipmaps)
+{
+  const auto levelCount = mipmaps ? GLsizei(levels.size()) : 1;
+  const bool is16Bits = bitsPerComponent == 16;
+  glTexStorage2D(GL_TEXTURE_2D, levelCount, is16Bits ? GL_RGBA16 : GL_RGBA8,
+      levels[0].width, levels[0].height);
+  for (GLint level = 0; level < levelCount; ++level) {
+    const auto &levelData = levels[level];
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelData.width,
+        levelData.height, GL_RGBA,
+        is16Bits ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, levelData.texels.data);
+  }
+}
+
+void uploadCompressedImageLevels(const CompressedImage &image, bool mipmaps)
+{
+  const auto levelCount = mipmaps ? GLsizei(image.levels.size()) : 1;
+  glTexStorage2D(GL_TEXTURE_2D, levelCount, image.glFormat,
+      image.levels[0].width, image.levels[0].height);
+  for (GLint level = 0; level < levelCount; ++level) {
+    const auto &levelData = image.levels[level];
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levelData.width,
+        levelData.height, image.glFormat, GLsizei(levelData.texels.size),
+        levelData.texels.data);
+  }
+}
+
+std::vector<uint32_t> getSupportedCompressedFormats()
+{
+  // RGTC (BC4, BC5) and BPTC (BC7) are core since OpenGL 4.2, S3TC (BC1, BC3)
+  // is an extension that desktop drivers expose
+  std::vector<uint32_t> formats{GL_COMPRESSED_RED_RGTC1,
+      GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RGBA_BPTC_UNORM};
+  if (hasGLExtension("GL_EXT_texture_compression_s3tc")) {
+    formats.insert(end(formats), {GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                     GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+                                     GL_COMPRESSED_RGBA_S3TC_DXT5_EXT});
+  }
+  return formats;
+}
+
+TextureStreamer::TextureStreamer(tinygltf::Model &model, GltfLoader &loader,
+    ThreadPool &threadPool, size_t uploadBudget) :
+    m_Model(model),
+    m_Loader(loader),
+    m_Textures(model.textures.size()),
+    m_TextureObjects(model.textures.size(), 0),
+    m_nUploadBudget(std::max(uploadBudget, size_t(1)))
+{
+  glGenTextures(GLsizei(m_TextureObjects.size()), m_TextureObjects.data());
+  for (size_t texIdx = 0; texIdx < m_Textures.size(); ++texIdx) {
+    const auto &texture = model.textures[texIdx];
+    auto &state = m_Textures[texIdx];
+    state.glId = m_TextureObjects[texIdx];
+    state.imageIdx = texture.source;
+    glBindTexture(GL_TEXTURE_2D, state.glId);
+    setSamplerParameters(model, texture);
+    if (state.imageIdx < 0) {
+      state.failed = true;
+      ++m_nFinishedCount;
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // Decoding tasks only touch their own image, which is not read by the main
+  // thread before its index is published in m_DecodedImages. Images that no
+  // texture uses are not decoded, so that all tasks are done when all
+  // textures are.
+  std::vector<bool> isUsed(model.images.size(), false);
+  for (const auto &state : m_Textures) {
+    if (state.imageIdx >= 0) {
+      isUsed[state.imageIdx] = true;
+    }
+  }
+  for (size_t imageIdx = 0; imageIdx < model.images.size(); ++imageIdx) {
+    if (!isUsed[imageIdx]) {
+      continue;
+    }
+    m_DecodeTasks.emplace_back(threadPool.submit([this, &loader, imageIdx]() {
+      std::string err;
+      if (!loader.decodeImage(m_Model, int(imageIdx), &err)) {
+        std::cerr << "Error: " << err << std::endl;
+      }
+      std::lock_guard<std::mutex> lock(m_DecodedMutex);
+      m_DecodedImages.emplace_back(int(imageIdx));
+    }));
+  }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+  for (auto &task : m_DecodeTasks) {
+    task.wait();
+  }
+}
+
+void TextureStreamer::requestMaterial(int materialIdx, float screenCoverage)
+{
+  if (materialIdx < 0) {
+    return;
+  }
+  const auto &material = m_Model.materials[materialIdx];
+  requestTexture(
+      material.pbrMetallicRoughness.baseColorTexture.index, screenCoverage);
+  requestTexture(material.pbrMetallicRoughness.metallicRoughnessTexture.index,
+      screenCoverage);
+  requestTexture(material.emissiveTexture.index, screenCoverage);
+  requestTexture(material.normalTexture.index, screenCoverage);
+  requestTexture(material.occlusionTexture.index, screenCoverage);
+}
+
+void TextureStreamer::requestTexture(int textureIdx, float screenCoverage)
+{
+  if (textureIdx >= 0) {
+    // A texture shared by many objects matters as much as all of them
+    m_Textures[textureIdx].priority += screenCoverage;
+  }
+}
+
+void TextureStreamer::update()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_DecodedMutex);
+    for (const auto imageIdx : m_DecodedImages) {
+      for (auto &state : m_Textures) {
+        state.decoded = state.decoded || state.imageIdx == imageIdx;
+      }
+    }
+    m_DecodedImages.clear();
+  }
+
+  std::vector<size_t> candidates;
+  for (size_t texIdx = 0; texIdx < m_Textures.size(); ++texIdx) {
+    const auto &state = m_Textures[texIdx];
+    if (state.decoded && !state.complete && !state.failed) {
+      candidates.emplace_back(texIdx);
+    }
+  }
+  std::stable_sort(begin(candidates), end(candidates), [&](size_t a, size_t b) {
+    return m_Textures[a].priority > m_Textures[b].priority;
+  });
+
+  size_t budget = m_nUploadBudget;
+  for (const auto texIdx : candidates) {
+    if (budget == 0) {
+      break;
+    }
+    auto &state = m_Textures[texIdx];
+    const auto &image = m_Model.images[state.imageIdx];
+    const auto *cached = m_Loader.cachedImage(state.imageIdx);
+    const auto *compressed = m_Loader.compressedImage(state.imageIdx);
+    if (!cached && !compressed &&
+        (image.image.empty() || image.width <= 0 || image.height <= 0)) {
+      state.failed = true; // Could not be decoded, keep the placeholder
+      ++m_nFinishedCount;
+      continue;
+    }
+
+    const auto &texture = m_Model.textures[texIdx];
+    const bool mipmaps =
+        texture.sampler >= 0 &&
+        usesMipmaps(m_Model.samplers[texture.sampler].minFilter);
+    glBindTexture(GL_TEXTURE_2D, state.glId);
+    if (compressed) {
+      // Compressed levels are small, they are uploaded whole
+      const auto levelCount = mipmaps ? GLint(compressed->levels.size()) : 1;
+      if (!state.allocated) {
+        glTexStorage2D(GL_TEXTURE_2D, levelCount, compressed->glFormat,
+            compressed->levels[0].width, compressed->levels[0].height);
+        state.allocated = true;
+      }
+      while (budget > 0 && state.uploadedLevels < levelCount) {
+        const auto &level = compressed->levels[state.uploadedLevels];
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, state.uploadedLevels, 0, 0,
+            level.width, level.height, compressed->glFormat,
+            GLsizei(level.texels.size), level.texels.data);
+        budget -= std::min(budget, level.texels.size);
+        ++state.uploadedLevels;
+      }
+      if (state.uploadedLevels == levelCount) {
+        state.complete = true;
+        ++m_nFinishedCount;
+      }
+      continue;
+    }
+    if (!state.allocated) {
+      glTexStorage2D(GL_TEXTURE_2D,
+          mipmaps ? getMipLevelCount(image.width, image.height) : 1,
+          image.bits == 16 ? GL_RGBA16 : GL_RGBA8, image.width, image.height);
+      state.allocated = true;
+    }
+
+    // Cached images have all their levels, others only the first one
+    const auto levelCount =
+        cached && mipmaps ? GLint(cached->levels.size()) : 1;
+    while (budget > 0 && !state.complete) {
+      const auto width =
+          cached ? GLsizei(cached->levels[state.uploadedLevels].width)
+                 : image.width;
+      const auto height =
+          cached ? GLsizei(cached->levels[state.uploadedLevels].height)
+                 : image.height;
+      const auto *texels = cached
+                               ? cached->levels[state.uploadedLevels].texels.data
+                               : image.image.data();
+
+      // Upload as many rows as the budget allows, but at least one
+      const size_t rowSize =
+          size_t(width) * image.component * (image.bits / 8);
+      const auto rowCount =
+          GLsizei(std::min(size_t(height - state.uploadedRows),
+              std::max(budget / rowSize, size_t(1))));
+      glTexSubImage2D(GL_TEXTURE_2D, state.uploadedLevels, 0,
+          state.uploadedRows, width, rowCount, GL_RGBA, image.pixel_type,
+          texels + state.uploadedRows * rowSize);
+      state.uploadedRows += rowCount;
+      budget -= std::min(budget, rowCount * rowSize);
+
+      if (state.uploadedRows == height) {
+        state.uploadedRows = 0;
+        ++state.uploadedLevels;
+      }
+      if (state.uploadedLevels == levelCount) {
+        if (mipmaps && !cached) {
+          glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        state.complete = true;
+        ++m_nFinishedCount;
+      }
+    }
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  for (auto &state : m_Textures) {
+    state.priority = 0.f;
+  }
+}
+
+float estimateScreenCoverage(const glm::vec4 &boundingSphere,
+    const glm::mat4 &modelViewMatrix, const glm::mat4 &projMatrix)
+{
+  const auto viewSpaceCenter =
+      glm::vec3(modelViewMatrix * glm::vec4(glm::vec3(boundingSphere), 1.f));
+  const auto scale = std::max(glm::length(glm::vec3(modelViewMatrix[0])),
+      std::max(glm::length(glm::vec3(modelViewMatrix[1])),
+          glm::length(glm::vec3(modelViewMatrix[2]))));
+  const auto radius = boundingSphere.w * scale;
+  const auto distance = -viewSpaceCenter.z;
+  if (distance <= radius) {
+    return 1.f; // The camera is inside the sphere
+  }
+  // Radius of the projected sphere in NDC, the screen being 2x2 in NDC
+  const auto ndcRadius = radius * projMatrix[1][1] / distance;
+  return std::min(glm::pi<float>() * ndcRadius * ndcRadius / 4.f, 1.f);
+}
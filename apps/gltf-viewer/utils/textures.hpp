@@ -0,0 +1,125 @@
+#pragma once
+
+#include "gltf_loader.hpp"
+#include "scene.hpp"
+#include "texture_cache.hpp"
+#include "thread_pool.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <tiny_gltf.h>
+
+#include <future>
+#include <mutex>
+#include <vector>
+
+// Return true if the glTF minification filter samples mipmaps
+bool usesMipmaps(int minFilter);
+
+// Set filtering and wrapping parameters of the texture currently bound to
+// GL_TEXTURE_2D according to the sampler of the glTF texture
+void setSamplerParameters(
+    const tinygltf::Model &model, const tinygltf::Texture &texture);
+void setSamplerParameters(const Scene::Texture &texture);
+
+// Number of levels of a full mipmap chain for a width x height texture
+GLsizei getMipLevelCount(GLsizei width, GLsizei height);
+
+// Allocate the texture currently bound to GL_TEXTURE_2D and upload the RGBA
+// mipmap levels of an image (e.g. from the texture cache), or only its first
+// level if mipmaps is false
+void uploadImageLevels(const std::vector<ImageLevel> &levels,
+    uint32_t bitsPerComponent, bool mipmaps);
+
+// Allocate the texture currently bound to GL_TEXTURE_2D and upload the levels
+// of a compressed image as they are, or only its first level if mipmaps is
+// false
+void uploadCompressedImageLevels(const CompressedImage &image, bool mipmaps);
+
+// Compressed formats of KTX2 images (see ktx2.hpp) that the current context
+// supports
+std::vector<uint32_t> getSupportedCompressedFormats();
+
+// Rough fraction of the screen covered by a bounding sphere (center, radius)
+// given in local space
+float estimateScreenCoverage(const glm::vec4 &boundingSphere,
+    const glm::mat4 &modelViewMatrix, const glm::mat4 &projMatrix);
+
+// Uploads glTF textures progressively, so that rendering can start before all
+// images are decoded.
+//
+// Texture objects are created empty and images are decoded in background on
+// the thread pool. Each call to update() then uploads decoded images, at most
+// uploadBudget bytes per call (large images are uploaded across several
+// frames, a block of rows at a time). Textures requested by the materials that
+// cover most of the screen are uploaded first.
+// Images found in the texture cache of the loader and KTX2 images kept
+// compressed are uploaded level by level, others have their mipmaps generated
+// once uploaded.
+// Until a texture is complete, getTextureObject() returns the given
+// placeholder.
+class TextureStreamer
+{
+public:
+  // loader must have loaded model with deferred image decoding
+  TextureStreamer(tinygltf::Model &model, GltfLoader &loader,
+      ThreadPool &threadPool, size_t uploadBudget);
+
+  // Wait for background decoding tasks
+  ~TextureStreamer();
+
+  TextureStreamer(const TextureStreamer &) = delete;
+
+  TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+  GLuint getTextureObject(int textureIdx, GLuint placeholder) const
+  {
+    return m_Textures[textureIdx].complete ? m_Textures[textureIdx].glId
+                                           : placeholder;
+  }
+
+  // Raise the upload priority of the textures of the material for the
+  // current frame. screenCoverage is the fraction of the screen covered by an
+  // object using the material.
+  void requestMaterial(int materialIdx, float screenCoverage);
+
+  // Upload decoded images within the budget, by decreasing priority, then
+  // reset priorities for the next frame
+  void update();
+
+  // True when all textures are complete or have failed to decode, decoding
+  // tasks are then finished
+  bool done() const { return m_nFinishedCount == m_Textures.size(); }
+
+  size_t finishedCount() const { return m_nFinishedCount; }
+
+  const std::vector<GLuint> &textureObjects() const { return m_TextureObjects; }
+
+private:
+  void requestTexture(int textureIdx, float screenCoverage);
+
+  struct TextureState
+  {
+    GLuint glId = 0;
+    int imageIdx = -1;
+    float priority = 0.f;
+    bool decoded = false;
+    bool allocated = false;
+    GLint uploadedLevels = 0;
+    GLsizei uploadedRows = 0; // Of the level being uploaded
+    bool complete = false;
+    bool failed = false;
+  };
+
+  tinygltf::Model &m_Model;
+  const GltfLoader &m_Loader;
+  std::vector<TextureState> m_Textures;
+  std::vector<GLuint> m_TextureObjects;
+  size_t m_nFinishedCount = 0;
+  size_t m_nUploadBudget;
+
+  // Decoding tasks push indices of decoded images here
+  std::mutex m_DecodedMutex;
+  std::vector<int> m_DecodedImages;
+  std::vector<std::future<void>> m_DecodeTasks;
+};
@@ -0,0 +1,40 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_Workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bStop = true;
+  }
+  m_Condition.notify_all();
+  for (auto &worker : m_Workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::workerLoop()
+{
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Condition.wait(lock, [this]() { return m_bStop || !m_Tasks.empty(); });
+      if (m_Tasks.empty()) {
+        return; // m_bStop is set and there is nothing left to do
+      }
+      task = std::move(m_Tasks.front());
+      m_Tasks.pop_front();
+    }
+    task();
+  }
+}
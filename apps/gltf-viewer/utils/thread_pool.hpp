@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads executing tasks in submission order
+class ThreadPool
+{
+public:
+  // threadCount == 0 means one thread per hardware thread
+  explicit ThreadPool(size_t threadCount = 0);
+
+  // Pending tasks are executed before the workers are joined
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const { return m_Workers.size(); }
+
+  // Queue f() for execution on a worker. Exceptions thrown by f are rethrown
+  // by get() on the returned future.
+  template <typename Function>
+  auto submit(Function &&f) -> std::future<decltype(f())>
+  {
+    using ResultType = decltype(f());
+    const auto task = std::make_shared<std::packaged_task<ResultType()>>(
+        std::forward<Function>(f));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_Tasks.emplace_back([task]() { (*task)(); });
+    }
+    m_Condition.notify_one();
+    return future;
+  }
+
+  // Call f(i) for each i in [0, count) on the workers and the calling thread,
+  // and wait for all calls to complete. Indices are distributed dynamically so
+  // uneven workloads are balanced. The first exception thrown by f is
+  // rethrown once all workers are done.
+  // Must not be called from a task running on the pool itself.
+  template <typename Function> void parallelFor(size_t count, Function &&f)
+  {
+    if (count == 0) {
+      return;
+    }
+    std::atomic<size_t> nextIndex{0};
+    const auto work = [&]() {
+      for (auto i = nextIndex++; i < count; i = nextIndex++) {
+        f(i);
+      }
+    };
+    std::vector<std::future<void>> futures;
+    const auto helperCount = std::min(size(), count - 1);
+    for (size_t i = 0; i < helperCount; ++i) {
+      futures.emplace_back(submit(work));
+    }
+    std::exception_ptr exception;
+    try {
+      work();
+    } catch (...) {
+      exception = std::current_exception();
+      nextIndex = count; // Stop distributing work
+    }
+    for (auto &future : futures) {
+      try {
+        future.get();
+      } catch (...) {
+        if (!exception) {
+          exception = std::current_exception();
+        }
+      }
+    }
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+
+private:
+  void workerLoop();
+
+  std::vector<std::thread> m_Workers;
+  std::deque<std::function<void()>> m_Tasks;
+  std::mutex m_Mutex;
+  std::condition_variable m_Condition;
+  bool m_bStop = false;
+};
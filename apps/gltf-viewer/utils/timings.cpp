@@ -0,0 +1,110 @@
+#include "timings.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <json.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+Timings::Scope::Scope(Timings *timings, std::string name) :
+    m_pTimings(timings),
+    m_Name(std::move(name))
+{
+  if (m_pTimings) {
+    m_WallStart = std::chrono::steady_clock::now();
+    m_CpuStart = getCpuTime();
+  }
+}
+
+void Timings::Scope::stop()
+{
+  if (!m_pTimings) {
+    return;
+  }
+  const std::chrono::duration<double> wall =
+      std::chrono::steady_clock::now() - m_WallStart;
+  m_pTimings->add(m_Name, wall.count(), getCpuTime() - m_CpuStart);
+  m_pTimings = nullptr;
+}
+
+double Timings::getCpuTime()
+{
+#ifdef _WIN32
+  FILETIME creationTime, exitTime, kernelTime, userTime;
+  GetProcessTimes(
+      GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+  const auto toSeconds = [](const FILETIME &time) {
+    // In 100 ns units
+    return double((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) *
+           1e-7;
+  };
+  return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+  timespec time;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+  return double(time.tv_sec) + double(time.tv_nsec) * 1e-9;
+#endif
+}
+
+void Timings::add(
+    const std::string &name, double wallSeconds, double cpuSeconds)
+{
+  const auto it = std::find_if(begin(m_Phases), end(m_Phases),
+      [&](const Phase &phase) { return phase.name == name; });
+  if (it != end(m_Phases)) {
+    (*it).wallSeconds += wallSeconds;
+    (*it).cpuSeconds += cpuSeconds;
+  } else {
+    m_Phases.push_back({name, wallSeconds, cpuSeconds});
+  }
+}
+
+void Timings::print(std::ostream &out) const
+{
+  size_t nameWidth = 5; // "total"
+  for (const auto &phase : m_Phases) {
+    nameWidth = std::max(nameWidth, phase.name.size());
+  }
+  const auto printRow = [&](const std::string &name, double wall,
+                            double cpu) {
+    out << "  " << std::left << std::setw(int(nameWidth)) << name << std::right
+        << std::setw(12) << wall * 1e3 << std::setw(12) << cpu * 1e3
+        << std::endl;
+  };
+
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "  " << std::left << std::setw(int(nameWidth)) << "phase"
+      << std::right << std::setw(12) << "wall (ms)" << std::setw(12)
+      << "cpu (ms)" << std::endl;
+  double totalWall = 0., totalCpu = 0.;
+  for (const auto &phase : m_Phases) {
+    printRow(phase.name, phase.wallSeconds, phase.cpuSeconds);
+    totalWall += phase.wallSeconds;
+    totalCpu += phase.cpuSeconds;
+  }
+  printRow("total", totalWall, totalCpu);
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void Timings::printJson(std::ostream &out) const
+{
+  auto phases = nlohmann::json::array();
+  double totalWall = 0., totalCpu = 0.;
+  for (const auto &phase : m_Phases) {
+    phases.push_back({{"name", phase.name}, {"wall_ms", phase.wallSeconds * 1e3},
+        {"cpu_ms", phase.cpuSeconds * 1e3}});
+    totalWall += phase.wallSeconds;
+    totalCpu += phase.cpuSeconds;
+  }
+  const nlohmann::json document = {{"phases", phases},
+      {"total", {{"wall_ms", totalWall * 1e3}, {"cpu_ms", totalCpu * 1e3}}}};
+  out << document.dump(2) << std::endl;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Wall-clock and CPU time of named phases, e.g. startup phases of the viewer.
+// CPU time is the time spent by all threads of the process, so it can exceed
+// wall-clock time when a phase runs on the thread pool. Not thread-safe:
+// phases are measured from a single thread.
+class Timings
+{
+public:
+  // Measure a phase from construction to destruction or to stop(). Does
+  // nothing if timings is nullptr.
+  class Scope
+  {
+  public:
+    Scope(Timings *timings, std::string name);
+
+    ~Scope() { stop(); }
+
+    Scope(const Scope &) = delete;
+
+    Scope &operator=(const Scope &) = delete;
+
+    void stop();
+
+  private:
+    Timings *m_pTimings;
+    std::string m_Name;
+    std::chrono::steady_clock::time_point m_WallStart;
+    double m_CpuStart;
+  };
+
+  // Process CPU time in seconds
+  static double getCpuTime();
+
+  // Time of a phase measured several times is accumulated
+  void add(const std::string &name, double wallSeconds, double cpuSeconds);
+
+  bool empty() const { return m_Phases.empty(); }
+
+  // Human-readable table, in milliseconds
+  void print(std::ostream &out) const;
+
+  // {"phases": [{"name", "wall_ms", "cpu_ms"}...], "total": {...}}
+  void printJson(std::ostream &out) const;
+
+private:
+  struct Phase
+  {
+    std::string name;
+    double wallSeconds;
+    double cpuSeconds;
+  };
+
+  std::vector<Phase> m_Phases; // In order of first measure
+};
@@ -0,0 +1,97 @@
+#include "uniform_ring_buffer.hpp"
+
+#include <algorithm>
+
+size_t UniformRingBuffer::getOffsetAlignment()
+{
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  return size_t(std::max(alignment, 1));
+}
+
+unsigned char *UniformRingBuffer::beginFrame(size_t byteCount)
+{
+  m_Frame = (m_Frame + 1) % kFrameCount;
+  m_FrameByteCount = byteCount;
+  if (byteCount > m_FrameSize) {
+    allocate(std::max(byteCount, 2 * m_FrameSize));
+  }
+  auto &fence = m_Fences[m_Frame];
+  if (fence) {
+    // Only waits if the CPU is kFrameCount frames ahead of the GPU
+    GLenum status = GL_TIMEOUT_EXPIRED;
+    while (status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  return m_bPersistent ? m_pMapped + m_Frame * m_FrameSize : m_Staging.data();
+}
+
+void UniformRingBuffer::endWrites()
+{
+  // Persistent mappings are coherent, writes are visible to next commands
+  if (m_bPersistent || m_FrameByteCount == 0) {
+    return;
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, GLintptr(m_Frame * m_FrameSize),
+      GLsizeiptr(m_FrameByteCount), m_Staging.data());
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRingBuffer::bind(
+    GLuint binding, size_t byteOffset, size_t byteCount) const
+{
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_Buffer,
+      GLintptr(m_Frame * m_FrameSize + byteOffset), GLsizeiptr(byteCount));
+}
+
+void UniformRingBuffer::endFrame()
+{
+  if (m_bPersistent && m_Buffer) {
+    m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+}
+
+void UniformRingBuffer::clear()
+{
+  for (auto &fence : m_Fences) {
+    if (fence) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  if (m_Buffer) {
+    // Also unmaps it
+    glDeleteBuffers(1, &m_Buffer);
+    m_Buffer = 0;
+  }
+  m_pMapped = nullptr;
+  m_Staging.clear();
+  m_FrameSize = 0;
+}
+
+void UniformRingBuffer::allocate(size_t frameSize)
+{
+  clear();
+  const auto alignment = getOffsetAlignment();
+  m_FrameSize = (frameSize + alignment - 1) / alignment * alignment;
+  const auto bufferSize = GLsizeiptr(m_FrameSize * kFrameCount);
+  // glad only loads glBufferStorage() with the core 4.4 functions
+  m_bPersistent = GLAD_GL_VERSION_4_4 != 0;
+  glGenBuffers(1, &m_Buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+  if (m_bPersistent) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_UNIFORM_BUFFER, bufferSize, nullptr, flags);
+    m_pMapped = (unsigned char *)glMapBufferRange(
+        GL_UNIFORM_BUFFER, 0, bufferSize, flags);
+  } else {
+    glBufferData(GL_UNIFORM_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    m_Staging.resize(m_FrameSize);
+  }
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
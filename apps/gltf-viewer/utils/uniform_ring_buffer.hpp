@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Uniform buffer written by the CPU once per frame, in a ring of kFrameCount
+// regions so that a frame is written while the GPU still reads the previous
+// ones.
+//
+// With GL 4.4 (ARB_buffer_storage) the buffer is persistently and coherently
+// mapped: uniforms are written in place, and a fence per region makes
+// beginFrame() wait until the GPU is done with the frame that last used it.
+// Otherwise they are written to a CPU copy that endWrites() uploads with one
+// glBufferSubData() call. Either way, each draw selects its uniforms with one
+// glBindBufferRange() call instead of a glUniform*() call per uniform.
+//
+// Needs a current GL context, from construction to destruction.
+class UniformRingBuffer
+{
+public:
+  static const size_t kFrameCount = 3;
+
+  // Alignment of the byte offsets given to bind()
+  static size_t getOffsetAlignment();
+
+  UniformRingBuffer() = default;
+
+  ~UniformRingBuffer() { clear(); }
+
+  UniformRingBuffer(const UniformRingBuffer &) = delete;
+
+  UniformRingBuffer &operator=(const UniformRingBuffer &) = delete;
+
+  // Start a frame of byteCount bytes of uniforms, growing the buffer if
+  // needed, and return where to write them. Bytes must be written
+  // sequentially and not read back: they may be in write-combined memory.
+  unsigned char *beginFrame(size_t byteCount);
+
+  // Make the bytes written since beginFrame() visible to the GPU, to be called
+  // before drawing with them
+  void endWrites();
+
+  // Bind byteCount bytes at byteOffset in the current frame to the uniform
+  // block binding point binding
+  void bind(GLuint binding, size_t byteOffset, size_t byteCount) const;
+
+  // Fence the current frame, to be called after the draws reading it
+  void endFrame();
+
+  void clear();
+
+private:
+  void allocate(size_t frameSize);
+
+  bool m_bPersistent = false;
+  GLuint m_Buffer = 0;
+  size_t m_FrameSize = 0; // Bytes of each region, aligned
+  size_t m_FrameByteCount = 0; // Written in the current frame
+  size_t m_Frame = 0; // Region of the current frame
+  unsigned char *m_pMapped = nullptr; // Whole buffer, if m_bPersistent
+  std::vector<unsigned char> m_Staging; // Current frame, if not m_bPersistent
+  GLsync m_Fences[kFrameCount] = {};
+};
@@ -0,0 +1,281 @@
+#include "vertex_arrays.hpp"
+
+#include <algorithm>
+
+std::string VertexArrays::getShaderDefines()
+{
+  return "#define VertexAttribCount " + std::to_string(VertexAttribCount) +
+         "u\n";
+}
+
+bool VertexArrays::supportsVertexPulling()
+{
+  if (!GLAD_GL_VERSION_4_3) {
+    return false;
+  }
+  // GL 4.3 only requires storage blocks in fragment and compute shaders
+  GLint blockCount = 0;
+  glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &blockCount);
+  return blockCount >= 2;
+}
+
+uint64_t VertexArrays::getMaxVertexDataSize()
+{
+  GLint64 blockSize = 0;
+  glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &blockSize);
+  // Byte offsets are 32-bit in the vertex shader
+  return std::min(uint64_t(std::max(blockSize, GLint64(0))),
+             uint64_t(0xFFFFFFFF)) /
+         4 * 4;
+}
+
+void VertexArrays::create(
+    const Scene &scene, const GpuBuffers &gpuBuffers, bool pullVertices)
+{
+  clear();
+  // glad only loads glVertexAttribFormat() and glBindVertexBuffer() with the
+  // core 4.3 functions
+  m_bShareFormats = GLAD_GL_VERSION_4_3 != 0;
+  m_bPullVertices = pullVertices && supportsVertexPulling();
+  m_Primitives.resize(scene.primitives.size());
+  if (!m_bShareFormats) {
+    m_Formats.resize(scene.primitives.size());
+  }
+  if (m_bPullVertices) {
+    m_MaxVertexDataSize = getMaxVertexDataSize();
+    m_AttribFormats.assign(scene.primitives.size() * 4 * VertexAttribCount, 0);
+  }
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    setUp(scene, gpuBuffers, primIdx);
+  }
+  if (m_bPullVertices) {
+    glGenBuffers(1, &m_AttribFormatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_AttribFormatsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+        GLsizeiptr(m_AttribFormats.size() * sizeof(uint32_t)),
+        m_AttribFormats.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+  unbind();
+}
+
+void VertexArrays::update(const Scene &scene, const GpuBuffers &gpuBuffers,
+    const std::vector<size_t> &primIndices)
+{
+  for (const auto primIdx : primIndices) {
+    setUp(scene, gpuBuffers, primIdx);
+  }
+  if (m_bPullVertices && !primIndices.empty()) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_AttribFormatsBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+        GLsizeiptr(m_AttribFormats.size() * sizeof(uint32_t)),
+        m_AttribFormats.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+  unbind();
+}
+
+void VertexArrays::clear()
+{
+  for (const auto &format : m_Formats) {
+    if (format.vertexArray) {
+      glDeleteVertexArrays(1, &format.vertexArray);
+    }
+  }
+  if (m_AttribFormatsBuffer) {
+    glDeleteBuffers(1, &m_AttribFormatsBuffer);
+    m_AttribFormatsBuffer = 0;
+  }
+  m_bPullVertices = false;
+  m_AttribFormats.clear();
+  m_Formats.clear();
+  m_FormatIndices.clear();
+  m_Primitives.clear();
+  unbind();
+}
+
+uint64_t VertexArrays::bind(size_t primIdx)
+{
+  const auto &primitive = m_Primitives[primIdx];
+  if (m_bPullVertices) {
+    const auto primitiveUniform =
+        int64_t(primitive.storageBuffer ? GLuint(primIdx) : kNoPrimitive);
+    if (primitiveUniform != m_PrimitiveUniform) {
+      glUniform1ui(kPrimitiveUniformLocation, GLuint(primitiveUniform));
+      m_PrimitiveUniform = primitiveUniform;
+    }
+    if (primitive.storageBuffer &&
+        primitive.storageBuffer != m_BoundStorageBuffer) {
+      if (!m_BoundStorageBuffer) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kAttribFormatsBinding,
+            m_AttribFormatsBuffer);
+      }
+      glBindBufferRange(GL_SHADER_STORAGE_BUFFER, kVertexDataBinding,
+          primitive.storageBuffer, 0, primitive.storageSize);
+      m_BoundStorageBuffer = primitive.storageBuffer;
+    }
+  }
+  auto &format = m_Formats[primitive.format];
+  if (int64_t(primitive.format) != m_BoundFormat) {
+    glBindVertexArray(format.vertexArray);
+    m_BoundFormat = int64_t(primitive.format);
+  }
+  for (GLuint attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &binding = primitive.bindings[attribIdx];
+    if (binding.buffer && binding != format.bindings[attribIdx]) {
+      glBindVertexBuffer(
+          attribIdx, binding.buffer, binding.byteOffset, binding.byteStride);
+      format.bindings[attribIdx] = binding;
+    }
+  }
+  if (primitive.elementBuffer &&
+      primitive.elementBuffer != format.elementBuffer) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitive.elementBuffer);
+    format.elementBuffer = primitive.elementBuffer;
+  }
+  return primitive.indexByteOffset;
+}
+
+void VertexArrays::unbind()
+{
+  glBindVertexArray(0);
+  m_BoundFormat = -1;
+  m_BoundStorageBuffer = 0;
+  m_PrimitiveUniform = -1;
+}
+
+size_t VertexArrays::pulledCount() const
+{
+  return size_t(std::count_if(begin(m_Primitives), end(m_Primitives),
+      [](const PrimitiveBindings &bindings) {
+        return bindings.storageBuffer != 0;
+      }));
+}
+
+void VertexArrays::setUp(
+    const Scene &scene, const GpuBuffers &gpuBuffers, size_t primIdx)
+{
+  const auto &primitive = scene.primitives[primIdx];
+  auto &bindings = m_Primitives[primIdx];
+  bindings = PrimitiveBindings{};
+  m_BoundFormat = -1;
+
+  if (!m_bShareFormats) {
+    // New vertex array object, so that attributes the primitive lost do not
+    // stay enabled
+    auto &format = m_Formats[primIdx];
+    if (format.vertexArray) {
+      glDeleteVertexArrays(1, &format.vertexArray);
+    }
+    glGenVertexArrays(1, &format.vertexArray);
+    glBindVertexArray(format.vertexArray);
+    bindings.format = primIdx;
+    bindings.indexByteOffset = setupVertexArrayObject(primitive, gpuBuffers);
+    return;
+  }
+  if (m_bPullVertices) {
+    setUpPulling(scene, gpuBuffers, primIdx, bindings);
+  }
+
+  // Pulled primitives have no attributes in their vertex array object
+  FormatKey key{};
+  GLuint bufferObject = 0;
+  uint64_t byteOffset = 0;
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &attrib = primitive.attributes[attribIdx];
+    if (bindings.storageBuffer || attrib.buffer < 0 ||
+        !gpuBuffers.locate(
+            attrib.buffer, attrib.byteOffset, bufferObject, byteOffset)) {
+      continue;
+    }
+    key[3 * attribIdx] = uint32_t(attrib.size);
+    key[3 * attribIdx + 1] = attrib.componentType;
+    key[3 * attribIdx + 2] = attrib.normalized;
+    // Unlike glVertexAttribPointer(), a stride of 0 is not tightly packed
+    bindings.bindings[attribIdx] = {bufferObject, GLintptr(byteOffset),
+        GLsizei(getByteStride(attrib))};
+  }
+  if (primitive.indexBuffer >= 0 &&
+      gpuBuffers.locate(primitive.indexBuffer, primitive.indexByteOffset,
+          bufferObject, byteOffset)) {
+    bindings.elementBuffer = bufferObject;
+    bindings.indexByteOffset = byteOffset;
+  }
+
+  const auto it = m_FormatIndices.emplace(key, m_Formats.size()).first;
+  if (it->second == m_Formats.size()) {
+    Format format;
+    glGenVertexArrays(1, &format.vertexArray);
+    glBindVertexArray(format.vertexArray);
+    for (GLuint attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+      const auto size = key[3 * attribIdx];
+      if (size == 0) {
+        continue;
+      }
+      glEnableVertexAttribArray(attribIdx);
+      // Quantized attributes are fetched as they are stored, the GPU converts
+      // them to float
+      glVertexAttribFormat(attribIdx, GLint(size), key[3 * attribIdx + 1],
+          GLboolean(key[3 * attribIdx + 2]), 0);
+      glVertexAttribBinding(attribIdx, attribIdx);
+    }
+    m_Formats.push_back(format);
+  }
+  bindings.format = it->second;
+}
+
+bool VertexArrays::setUpPulling(const Scene &scene,
+    const GpuBuffers &gpuBuffers, size_t primIdx, PrimitiveBindings &bindings)
+{
+  const auto &primitive = scene.primitives[primIdx];
+  auto *formats = m_AttribFormats.data() + primIdx * 4 * VertexAttribCount;
+  std::fill(formats, formats + 4 * VertexAttribCount, 0);
+  GLuint storageBuffer = 0;
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &attrib = primitive.attributes[attribIdx];
+    GLuint bufferObject = 0;
+    uint64_t byteOffset = 0;
+    if (attrib.buffer < 0 ||
+        !gpuBuffers.locate(
+            attrib.buffer, attrib.byteOffset, bufferObject, byteOffset)) {
+      continue;
+    }
+    // The vertex shader reads 32-bit words, components must not straddle
+    // two of them
+    const auto byteStride = getByteStride(attrib);
+    const auto componentSize =
+        uint64_t(tinygltf::GetComponentSizeInBytes(attrib.componentType));
+    const auto byteEnd =
+        byteOffset + (primitive.vertexCount > 0
+                             ? (primitive.vertexCount - 1) * byteStride +
+                                   getElementSize(attrib)
+                             : 0);
+    if ((storageBuffer && bufferObject != storageBuffer) ||
+        attrib.componentType < GL_BYTE || attrib.componentType > GL_FLOAT ||
+        attrib.size < 1 || attrib.size > 4 || byteOffset % componentSize ||
+        byteStride % componentSize || byteEnd > m_MaxVertexDataSize) {
+      std::fill(formats, formats + 4 * VertexAttribCount, 0);
+      return false;
+    }
+    storageBuffer = bufferObject;
+    formats[4 * attribIdx] = uint32_t(byteOffset);
+    formats[4 * attribIdx + 1] = uint32_t(byteStride);
+    formats[4 * attribIdx + 2] = attrib.componentType;
+    formats[4 * attribIdx + 3] = uint32_t(attrib.size) |
+                                 (attrib.normalized ? 1u << 8 : 0u) |
+                                 uint32_t(componentSize << 16);
+  }
+  if (!storageBuffer) {
+    return false;
+  }
+
+  GLint64 bufferSize = 0;
+  glBindBuffer(GL_COPY_READ_BUFFER, storageBuffer);
+  glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &bufferSize);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  bindings.storageBuffer = storageBuffer;
+  bindings.storageSize = GLsizeiptr(
+      std::min(uint64_t(std::max(bufferSize, GLint64(0))),
+          m_MaxVertexDataSize));
+  return true;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "gpu_buffers.hpp"
+#include "scene.hpp"
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Vertex array objects reading the primitives of a scene from GpuBuffers.
+//
+// With GL 4.3 (ARB_vertex_attrib_binding), primitives with the same vertex
+// format (types, sizes and normalization of their attributes) share one
+// vertex array object: glVertexAttribFormat() is specified once for it, and
+// only the buffers of the primitive drawn are bound with glBindVertexBuffer().
+// Drivers validate a change of buffer offsets much faster than a change of
+// vertex array object, and bindings equal to the current ones are skipped.
+// Otherwise each primitive has its own vertex array object, as set up by
+// setupVertexArrayObject().
+//
+// With vertex pulling, the vertex shader (forward_pulling.vs.glsl) reads
+// attributes itself from a shader storage buffer, indexed by gl_VertexID:
+// the format of the attributes of each primitive is stored in a second
+// storage buffer, and drawing a primitive only sets its index in the
+// uniform at kPrimitiveUniformLocation. All pulled primitives share one
+// vertex array object, which only holds their element array buffer.
+// Primitives whose attributes are not in a same buffer object, or not
+// aligned on their component size, are drawn from vertex arrays.
+//
+// Needs a current GL context, from construction to destruction.
+class VertexArrays
+{
+public:
+  // Shared with forward_pulling.vs.glsl
+  static const GLint kPrimitiveUniformLocation = 0;
+  static const GLuint kVertexDataBinding = 0;
+  static const GLuint kAttribFormatsBinding = 1;
+  // Value of the primitive uniform for primitives drawn from vertex arrays
+  static const GLuint kNoPrimitive = 0xFFFFFFFF;
+
+  // Defines of the constants that shaders share with the scene layout
+  // (VertexAttribCount), to be given to loadShaderSource()
+  static std::string getShaderDefines();
+
+  // Whether the current context can pull vertices: GL 4.3 with shader
+  // storage blocks in vertex shaders
+  static bool supportsVertexPulling();
+
+  // Largest buffer object the vertex shader can read, to be given to
+  // GpuBuffers::upload() with vertex pulling
+  static uint64_t getMaxVertexDataSize();
+
+  VertexArrays() = default;
+
+  ~VertexArrays() { clear(); }
+
+  VertexArrays(const VertexArrays &) = delete;
+
+  VertexArrays &operator=(const VertexArrays &) = delete;
+
+  // Set up the vertex array objects of all primitives of scene, deleting the
+  // current ones. The program drawing them must be forward_pulling.vs.glsl
+  // if pullVertices, which needs supportsVertexPulling().
+  void create(const Scene &scene, const GpuBuffers &gpuBuffers,
+      bool pullVertices = false);
+
+  // Set up again the primitives primIndices of scene, which have changed but
+  // not their count
+  void update(const Scene &scene, const GpuBuffers &gpuBuffers,
+      const std::vector<size_t> &primIndices);
+
+  void clear();
+
+  // Bind the vertex array object and buffers of primitive primIdx, and set
+  // its index with vertex pulling. Returns the offset of its indices in the
+  // bound element array buffer.
+  uint64_t bind(size_t primIdx);
+
+  // Bind no vertex array object, to be called after drawing primitives so
+  // that the next bind() does not assume one is bound, nor the same program
+  void unbind();
+
+  // Number of vertex array objects
+  size_t size() const { return m_Formats.size(); }
+
+  // Number of primitives whose vertices are pulled
+  size_t pulledCount() const;
+
+private:
+  struct Binding
+  {
+    GLuint buffer = 0; // 0 if the attribute is disabled
+    GLintptr byteOffset = 0;
+    GLsizei byteStride = 0;
+
+    bool operator!=(const Binding &other) const
+    {
+      return buffer != other.buffer || byteOffset != other.byteOffset ||
+             byteStride != other.byteStride;
+    }
+  };
+
+  // Vertex array object, with the buffers bound to it
+  struct Format
+  {
+    GLuint vertexArray = 0;
+    Binding bindings[VertexAttribCount];
+    GLuint elementBuffer = 0;
+  };
+
+  // What a primitive binds, its bindings are empty if its vertex array object
+  // is its own or if its vertices are pulled
+  struct PrimitiveBindings
+  {
+    size_t format = 0; // Index in m_Formats
+    Binding bindings[VertexAttribCount];
+    GLuint elementBuffer = 0;
+    uint64_t indexByteOffset = 0;
+    // Bound to kVertexDataBinding if the vertices are pulled, 0 otherwise
+    GLuint storageBuffer = 0;
+    GLsizeiptr storageSize = 0;
+  };
+
+  // Sizes (0 if disabled), component types and normalization of attributes
+  using FormatKey = std::array<uint32_t, VertexAttribCount * 3>;
+
+  void setUp(const Scene &scene, const GpuBuffers &gpuBuffers, size_t primIdx);
+
+  // Fill the bindings of primitive primIdx and its attribute formats in
+  // m_AttribFormats if its vertices can be pulled, returns false otherwise
+  bool setUpPulling(const Scene &scene, const GpuBuffers &gpuBuffers,
+      size_t primIdx, PrimitiveBindings &bindings);
+
+  bool m_bShareFormats = false;
+  bool m_bPullVertices = false;
+  uint64_t m_MaxVertexDataSize = 0;
+  // Read by the vertex shader, for each primitive and each attribute: byte
+  // offset in its storage buffer, byte stride, component type, and size |
+  // normalized << 8 | component size << 16, size being 0 if the attribute is
+  // not pulled
+  std::vector<uint32_t> m_AttribFormats;
+  GLuint m_AttribFormatsBuffer = 0;
+  std::vector<Format> m_Formats;
+  std::map<FormatKey, size_t> m_FormatIndices; // If m_bShareFormats
+  std::vector<PrimitiveBindings> m_Primitives;
+  int64_t m_BoundFormat = -1;
+  GLuint m_BoundStorageBuffer = 0;
+  int64_t m_PrimitiveUniform = -1; // -1 if unknown
+};
@@ -0,0 +1,471 @@
+#include "vertex_cache.hpp"
+#include "overdraw.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+namespace
+{
+
+// Parameters of Forsyth's algorithm, which models an LRU cache larger than
+// the FIFO of actual GPUs
+const uint32_t kOptimizerCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.f;
+const float kValenceBoostPower = 0.5f;
+
+// Of each stream and index list in storage, as the ranges of GpuBufferLayout
+const uint64_t kStreamAlignment = 16;
+// Of the stride of attributes
+const uint64_t kAttribAlignment = 4;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Vertices in the cache score higher, those of the last triangle a bit less
+// so that strips do not turn back on themselves. Vertices with few triangles
+// left score higher so that they do not end isolated.
+float getVertexScore(int32_t cachePosition, uint32_t valence)
+{
+  if (valence == 0) {
+    return -1.f; // No triangle left to draw
+  }
+  float score = 0.f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = kLastTriangleScore;
+    } else {
+      const float scale = 1.f / (kOptimizerCacheSize - 3);
+      score = std::pow(1.f - (cachePosition - 3) * scale, kCacheDecayPower);
+    }
+  }
+  return score +
+         kValenceBoostScale * std::pow(float(valence), -kValenceBoostPower);
+}
+
+uint32_t getIndexSize(uint32_t indexType)
+{
+  const auto indexSize = tinygltf::GetComponentSizeInBytes(indexType);
+  return indexSize == 1 || indexSize == 2 || indexSize == 4
+             ? uint32_t(indexSize)
+             : 0;
+}
+
+// Returns false if indices are out of the bounds of their buffer or of the
+// vertices of primitive
+bool readIndices(const Scene &scene, const Scene::Primitive &primitive,
+    std::vector<uint32_t> &indices)
+{
+  const auto indexSize = getIndexSize(primitive.indexType);
+  if (size_t(primitive.indexBuffer) >= scene.buffers.size() ||
+      primitive.indexByteOffset + uint64_t(primitive.count) * indexSize >
+          scene.buffers[primitive.indexBuffer].size) {
+    return false;
+  }
+  const auto *bytes =
+      scene.buffers[primitive.indexBuffer].data + primitive.indexByteOffset;
+  indices.resize(primitive.count);
+  for (uint32_t i = 0; i < primitive.count; ++i) {
+    if (indexSize == 1) {
+      indices[i] = bytes[i];
+    } else if (indexSize == 2) {
+      uint16_t index;
+      std::memcpy(&index, bytes + 2 * i, 2);
+      indices[i] = index;
+    } else {
+      std::memcpy(&indices[i], bytes + 4 * i, 4);
+    }
+    if (indices[i] >= primitive.vertexCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename ComponentType>
+float readComponent(const unsigned char *bytes)
+{
+  ComponentType component;
+  std::memcpy(&component, bytes, sizeof(component));
+  return float(component);
+}
+
+// Positions of the vertices of a primitive, 3 floats each. Quantized ones
+// (see KHR_mesh_quantization) are read without their dequantization scale,
+// which does not change how clusters of triangles compare.
+std::vector<float> readPositions(
+    const Scene &scene, const Scene::VertexAttrib &attrib, size_t vertexCount)
+{
+  std::vector<float> positions(vertexCount * 3, 0.f);
+  if (attrib.buffer < 0 || attrib.size < 3) {
+    return positions;
+  }
+  const auto componentSize =
+      tinygltf::GetComponentSizeInBytes(attrib.componentType);
+  const auto byteStride = getByteStride(attrib);
+  const auto *bytes = scene.buffers[attrib.buffer].data + attrib.byteOffset;
+  for (size_t i = 0; i < vertexCount * 3; ++i) {
+    const auto *component =
+        bytes + (i / 3) * byteStride + (i % 3) * componentSize;
+    switch (attrib.componentType) {
+    case GL_BYTE:
+      positions[i] = readComponent<int8_t>(component);
+      break;
+    case GL_UNSIGNED_BYTE:
+      positions[i] = readComponent<uint8_t>(component);
+      break;
+    case GL_SHORT:
+      positions[i] = readComponent<int16_t>(component);
+      break;
+    case GL_UNSIGNED_SHORT:
+      positions[i] = readComponent<uint16_t>(component);
+      break;
+    case GL_FLOAT:
+      positions[i] = readComponent<float>(component);
+      break;
+    }
+  }
+  return positions;
+}
+
+void writeIndices(
+    const std::vector<uint32_t> &indices, uint32_t indexSize, void *output)
+{
+  if (indexSize == 4) {
+    std::memcpy(output, indices.data(), indices.size() * 4);
+  } else if (indexSize == 2) {
+    std::copy(begin(indices), end(indices), (uint16_t *)output);
+  } else {
+    std::copy(begin(indices), end(indices), (uint8_t *)output);
+  }
+}
+
+// Primitives sharing their vertices, and where their optimized vertices and
+// indices go in storage
+struct VertexSet
+{
+  std::vector<size_t> primitives; // Indices in Scene::primitives
+  bool optimizable = true;
+  Scene::VertexAttrib attributes[VertexAttribCount]; // Optimized
+  std::vector<uint64_t> indexByteOffsets; // Of each primitive
+};
+
+// Returns the end of the data of set in storage
+uint64_t layOutVertexSet(
+    const Scene &scene, VertexSet &set, uint64_t storageSize)
+{
+  const auto &first = scene.primitives[set.primitives[0]];
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    auto &attrib = set.attributes[attribIdx];
+    attrib = first.attributes[attribIdx];
+    if (attrib.buffer < 0) {
+      continue;
+    }
+    attrib.byteOffset = alignUp(storageSize, kStreamAlignment);
+    attrib.byteStride =
+        int32_t(alignUp(getElementSize(attrib), kAttribAlignment));
+    storageSize = attrib.byteOffset + uint64_t(first.vertexCount) *
+                                          uint64_t(attrib.byteStride);
+  }
+  for (const auto primIdx : set.primitives) {
+    const auto &primitive = scene.primitives[primIdx];
+    set.indexByteOffsets.push_back(alignUp(storageSize, kStreamAlignment));
+    storageSize = set.indexByteOffsets.back() +
+                  uint64_t(primitive.count) * getIndexSize(primitive.indexType);
+  }
+  return storageSize;
+}
+
+bool optimizeVertexSet(const Scene &scene, const VertexSet &set,
+    float overdrawThreshold, unsigned char *storage)
+{
+  const auto &first = scene.primitives[set.primitives[0]];
+  const auto vertexCount = size_t(first.vertexCount);
+  std::vector<float> positions;
+  if (overdrawThreshold > 0.f) {
+    positions = readPositions(
+        scene, first.attributes[VertexAttribPosition], vertexCount);
+  }
+
+  // Triangles are reordered per primitive, vertices for all of them
+  std::vector<uint32_t> allIndices;
+  std::vector<uint32_t> indices;
+  for (const auto primIdx : set.primitives) {
+    if (!readIndices(scene, scene.primitives[primIdx], indices)) {
+      return false;
+    }
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    if (overdrawThreshold > 0.f) {
+      optimizeOverdraw(indices.data(), indices.size(), positions.data(),
+          vertexCount, overdrawThreshold);
+    }
+    allIndices.insert(end(allIndices), begin(indices), end(indices));
+  }
+  const auto remap =
+      optimizeVertexFetch(allIndices.data(), allIndices.size(), vertexCount);
+
+  auto nextIndex = begin(allIndices);
+  for (size_t i = 0; i < set.primitives.size(); ++i) {
+    const auto &primitive = scene.primitives[set.primitives[i]];
+    indices.assign(nextIndex, nextIndex + primitive.count);
+    nextIndex += primitive.count;
+    writeIndices(indices, getIndexSize(primitive.indexType),
+        storage + set.indexByteOffsets[i]);
+  }
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &source = first.attributes[attribIdx];
+    if (source.buffer < 0) {
+      continue;
+    }
+    const auto &attrib = set.attributes[attribIdx];
+    const auto elementSize = getElementSize(source);
+    const auto sourceStride = getByteStride(source);
+    const auto *src = scene.buffers[source.buffer].data + source.byteOffset;
+    auto *dst = storage + attrib.byteOffset;
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+      std::memcpy(dst + remap[vertex] * uint64_t(attrib.byteStride),
+          src + vertex * sourceStride, elementSize);
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+    size_t vertexCount, uint32_t cacheSize)
+{
+  VertexCacheStats stats;
+  stats.triangleCount = indexCount / 3;
+  // A vertex is in the FIFO while less than cacheSize misses happened since
+  // its own one
+  std::vector<uint64_t> missTimes(vertexCount, 0);
+  uint64_t time = uint64_t(cacheSize) + 1;
+  for (size_t i = 0; i < stats.triangleCount * 3; ++i) {
+    const auto vertex = indices[i];
+    if (missTimes[vertex] == 0) {
+      ++stats.vertexCount;
+    }
+    if (time - missTimes[vertex] > cacheSize) {
+      missTimes[vertex] = time++;
+      ++stats.missCount;
+    }
+  }
+  return stats;
+}
+
+void optimizeVertexCache(
+    uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+  const size_t triangleCount = indexCount / 3;
+  if (triangleCount < 2) {
+    return;
+  }
+
+  // Triangles of each vertex not drawn yet: the first valences[v] of those
+  // starting at triangleOffsets[v] in vertexTriangles
+  std::vector<uint32_t> valences(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    ++valences[indices[i]];
+  }
+  std::vector<uint32_t> triangleOffsets(vertexCount, 0);
+  uint32_t offset = 0;
+  for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+    triangleOffsets[vertex] = offset;
+    offset += valences[vertex];
+  }
+  std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+  std::vector<uint32_t> triangleCounts(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; ++i) {
+    const auto vertex = indices[i];
+    vertexTriangles[triangleOffsets[vertex] + triangleCounts[vertex]++] =
+        uint32_t(i / 3);
+  }
+
+  std::vector<int32_t> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+    vertexScores[vertex] = getVertexScore(-1, valences[vertex]);
+  }
+  std::vector<float> triangleScores(triangleCount);
+  const auto getTriangleScore = [&](size_t triangle) {
+    return vertexScores[indices[3 * triangle]] +
+           vertexScores[indices[3 * triangle + 1]] +
+           vertexScores[indices[3 * triangle + 2]];
+  };
+  for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+    triangleScores[triangle] = getTriangleScore(triangle);
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  std::vector<bool> isDrawn(triangleCount, false);
+  size_t nextUndrawn = 0; // When no triangle of the cache is left
+  int64_t bestTriangle = std::max_element(begin(triangleScores),
+                             end(triangleScores)) -
+                         begin(triangleScores);
+  std::array<uint32_t, kOptimizerCacheSize + 3> cache, newCache;
+  size_t cacheCount = 0;
+  while (output.size() < triangleCount * 3) {
+    if (bestTriangle < 0) {
+      while (isDrawn[nextUndrawn]) {
+        ++nextUndrawn;
+      }
+      bestTriangle = int64_t(nextUndrawn);
+    }
+    const uint32_t *triangle = indices + 3 * bestTriangle;
+    isDrawn[bestTriangle] = true;
+    output.insert(end(output), triangle, triangle + 3);
+
+    // Vertices of the triangle move to the front of the cache
+    size_t newCount = 0;
+    for (size_t i = 0; i < 3; ++i) {
+      const auto vertex = triangle[i];
+      auto *triangles = vertexTriangles.data() + triangleOffsets[vertex];
+      auto *last = triangles + valences[vertex] - 1;
+      std::iter_swap(std::find(triangles, last, uint32_t(bestTriangle)), last);
+      --valences[vertex];
+      if (std::find(begin(newCache), begin(newCache) + newCount, vertex) ==
+          begin(newCache) + newCount) {
+        newCache[newCount++] = vertex;
+      }
+    }
+    for (size_t i = 0; i < cacheCount; ++i) {
+      if (std::find(triangle, triangle + 3, cache[i]) == triangle + 3) {
+        newCache[newCount++] = cache[i];
+      }
+    }
+
+    // Scores change for vertices of the cache and those leaving it, then for
+    // their triangles, among which the next one is chosen
+    for (size_t i = 0; i < newCount; ++i) {
+      const auto vertex = newCache[i];
+      cachePositions[vertex] = i < kOptimizerCacheSize ? int32_t(i) : -1;
+      vertexScores[vertex] =
+          getVertexScore(cachePositions[vertex], valences[vertex]);
+    }
+    bestTriangle = -1;
+    float bestScore = 0.f;
+    for (size_t i = 0; i < newCount; ++i) {
+      const auto vertex = newCache[i];
+      const auto *triangles = vertexTriangles.data() + triangleOffsets[vertex];
+      for (uint32_t j = 0; j < valences[vertex]; ++j) {
+        const auto score = getTriangleScore(triangles[j]);
+        triangleScores[triangles[j]] = score;
+        if (score > bestScore) {
+          bestScore = score;
+          bestTriangle = triangles[j];
+        }
+      }
+    }
+    cacheCount = std::min(newCount, size_t(kOptimizerCacheSize));
+    std::copy(begin(newCache), begin(newCache) + cacheCount, begin(cache));
+  }
+  std::copy(begin(output), end(output), indices);
+}
+
+std::vector<uint32_t> optimizeVertexFetch(
+    uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+  const auto unassigned = uint32_t(-1);
+  std::vector<uint32_t> remap(vertexCount, unassigned);
+  uint32_t nextVertex = 0;
+  for (size_t i = 0; i < indexCount; ++i) {
+    auto &newVertex = remap[indices[i]];
+    if (newVertex == unassigned) {
+      newVertex = nextVertex++;
+    }
+    indices[i] = newVertex;
+  }
+  for (auto &newVertex : remap) {
+    if (newVertex == unassigned) {
+      newVertex = nextVertex++;
+    }
+  }
+  return remap;
+}
+
+void optimizeVertexCaches(Scene &scene, std::vector<unsigned char> &storage,
+    ThreadPool *threadPool, float overdrawThreshold)
+{
+  // Primitives with the same key read the same vertices
+  using Key = std::array<int64_t, VertexAttribCount * 6 + 1>;
+  std::map<Key, size_t> setIndices;
+  std::vector<VertexSet> sets;
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    const auto &primitive = scene.primitives[primIdx];
+    Key key;
+    size_t keyIdx = 0;
+    for (const auto &attrib : primitive.attributes) {
+      key[keyIdx++] = attrib.buffer;
+      key[keyIdx++] = attrib.size;
+      key[keyIdx++] = attrib.componentType;
+      key[keyIdx++] = attrib.byteStride;
+      key[keyIdx++] = attrib.normalized;
+      key[keyIdx++] = int64_t(attrib.byteOffset);
+    }
+    key[keyIdx] = primitive.vertexCount;
+    const auto it = setIndices.emplace(key, sets.size()).first;
+    if (it->second == sets.size()) {
+      sets.emplace_back();
+    }
+    auto &set = sets[it->second];
+    set.primitives.push_back(primIdx);
+    set.optimizable = set.optimizable &&
+                      primitive.mode == TINYGLTF_MODE_TRIANGLES &&
+                      primitive.indexBuffer >= 0 &&
+                      primitive.baseVertex == 0 &&
+                      getIndexSize(primitive.indexType) > 0 &&
+                      hasAttributesInBounds(scene, primitive);
+  }
+  sets.erase(std::remove_if(begin(sets), end(sets),
+                 [](const VertexSet &set) { return !set.optimizable; }),
+      end(sets));
+  if (sets.empty()) {
+    return;
+  }
+
+  uint64_t storageSize = 0;
+  for (auto &set : sets) {
+    storageSize = layOutVertexSet(scene, set, storageSize);
+  }
+  storage.assign(storageSize, 0);
+  std::vector<char> optimized(sets.size(), false);
+  const auto optimize = [&](size_t i) {
+    optimized[i] =
+        optimizeVertexSet(scene, sets[i], overdrawThreshold, storage.data());
+  };
+  if (threadPool) {
+    threadPool->parallelFor(sets.size(), optimize);
+  } else {
+    for (size_t i = 0; i < sets.size(); ++i) {
+      optimize(i);
+    }
+  }
+
+  const auto bufferIdx = int32_t(scene.buffers.size());
+  scene.buffers.push_back({storage.data(), storage.size()});
+  for (size_t setIdx = 0; setIdx < sets.size(); ++setIdx) {
+    if (!optimized[setIdx]) {
+      continue;
+    }
+    const auto &set = sets[setIdx];
+    for (size_t i = 0; i < set.primitives.size(); ++i) {
+      auto &primitive = scene.primitives[set.primitives[i]];
+      for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+        if (set.attributes[attribIdx].buffer >= 0) {
+          primitive.attributes[attribIdx] = set.attributes[attribIdx];
+          primitive.attributes[attribIdx].buffer = bufferIdx;
+        }
+      }
+      primitive.indexBuffer = bufferIdx;
+      primitive.indexByteOffset = set.indexByteOffsets[i];
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "scene.hpp"
+#include "thread_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache optimization of indexed triangle lists.
+//
+// GPUs reuse the vertex shader outputs of recently transformed vertices;
+// exporters, CAD ones notably, often write triangles in an order that defeats
+// that cache. Triangles are reordered with Forsyth's algorithm ("Linear-Speed
+// Vertex Cache Optimisation"), then vertices are renumbered in order of first
+// use so that vertex fetches are sequential too.
+
+// Size of the FIFO cache simulated by analyzeVertexCache(), that of most
+// desktop GPUs
+const uint32_t kVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+  uint64_t triangleCount = 0;
+  uint64_t vertexCount = 0; // Referenced by indices
+  uint64_t missCount = 0; // Vertices transformed
+
+  VertexCacheStats &operator+=(const VertexCacheStats &other)
+  {
+    triangleCount += other.triangleCount;
+    vertexCount += other.vertexCount;
+    missCount += other.missCount;
+    return *this;
+  }
+
+  // Average cache miss ratio: vertices transformed per triangle, 0.5 at best
+  // for regular meshes and 3 at worst
+  double acmr() const
+  {
+    return triangleCount > 0 ? double(missCount) / triangleCount : 0.;
+  }
+
+  // Average transformed to vertex ratio: vertices transformed per referenced
+  // vertex, 1 at best
+  double atvr() const
+  {
+    return vertexCount > 0 ? double(missCount) / vertexCount : 0.;
+  }
+};
+
+// Simulate a FIFO cache of cacheSize vertices while drawing the triangle list
+// indices. Indices must be lower than vertexCount.
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount,
+    size_t vertexCount, uint32_t cacheSize = kVertexCacheSize);
+
+// Reorder the triangles of the list indices for the vertex cache. Indices
+// must be lower than vertexCount.
+void optimizeVertexCache(
+    uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+// Renumber vertices in order of first use by indices, which are rewritten.
+// Returns the new index of each vertex; unreferenced vertices come after the
+// referenced ones, in their current order.
+std::vector<uint32_t> optimizeVertexFetch(
+    uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+// Optimize the indexed triangle lists of scene with optimizeVertexCache(),
+// then optimizeOverdraw() (see overdraw.hpp) with overdrawThreshold if it is
+// greater than 0, and optimizeVertexFetch().
+//
+// Primitives sharing vertices are optimized together: their triangles are
+// reordered separately and their vertices renumbered by first use across all
+// of them. Vertices are left unchanged if a primitive using them is not an
+// indexed triangle list, has a baseVertex, or has indices or attributes out
+// of bounds.
+//
+// Optimized vertices and indices are written to storage, which is appended
+// to scene.buffers, attributes as one stream each and indices with their
+// type. Vertices are optimized in parallel on threadPool if not null.
+// storage must stay alive and unchanged as long as scene.buffers are used.
+void optimizeVertexCaches(Scene &scene, std::vector<unsigned char> &storage,
+    ThreadPool *threadPool, float overdrawThreshold = 0.f);
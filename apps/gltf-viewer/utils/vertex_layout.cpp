@@ -0,0 +1,182 @@
+#include "vertex_layout.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <map>
+
+namespace
+{
+
+const char *const kVertexLayoutNames[VertexLayoutCount] = {
+    "source", "interleaved", "split"};
+
+// Of each stream, as the ranges of GpuBufferLayout
+const uint64_t kStreamAlignment = 16;
+// Of each attribute in a vertex
+const uint64_t kAttribAlignment = 4;
+
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Vertices shared by primitives with the same attributes
+struct VertexSet
+{
+  const Scene::Primitive *source = nullptr; // First primitive using them
+  Scene::VertexAttrib attributes[VertexAttribCount]; // Repacked
+};
+
+// Lay out the streams of set from byte offset of storage, returns the end of
+// its last stream
+uint64_t layOutVertexSet(VertexSet &set, VertexLayout layout, uint64_t offset)
+{
+  const auto &source = *set.source;
+  const auto getStream = [&](size_t attribIdx) {
+    return layout == VertexLayoutSplit && attribIdx != VertexAttribPosition
+               ? 1
+               : 0;
+  };
+  for (int stream = 0; stream < 2; ++stream) {
+    uint64_t byteStride = 0;
+    for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+      if (source.attributes[attribIdx].buffer >= 0 &&
+          getStream(attribIdx) == stream) {
+        auto &attrib = set.attributes[attribIdx];
+        attrib = source.attributes[attribIdx];
+        attrib.byteOffset = byteStride; // Made absolute below
+        byteStride +=
+            alignUp(getElementSize(source.attributes[attribIdx]),
+                kAttribAlignment);
+      }
+    }
+    if (byteStride == 0) {
+      continue;
+    }
+    const uint64_t streamOffset = alignUp(offset, kStreamAlignment);
+    for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+      if (source.attributes[attribIdx].buffer >= 0 &&
+          getStream(attribIdx) == stream) {
+        auto &attrib = set.attributes[attribIdx];
+        attrib.byteOffset += streamOffset;
+        attrib.byteStride = int32_t(byteStride);
+      }
+    }
+    offset = streamOffset + source.vertexCount * byteStride;
+  }
+  return offset;
+}
+
+void repackVertexSet(const Scene &scene, const VertexSet &set,
+    unsigned char *storage)
+{
+  const auto &source = *set.source;
+  for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+    const auto &sourceAttrib = source.attributes[attribIdx];
+    if (sourceAttrib.buffer < 0) {
+      continue;
+    }
+    const auto &attrib = set.attributes[attribIdx];
+    const auto elementSize = getElementSize(sourceAttrib);
+    const auto sourceStride = getByteStride(sourceAttrib);
+    const auto *src =
+        scene.buffers[sourceAttrib.buffer].data + sourceAttrib.byteOffset;
+    auto *dst = storage + attrib.byteOffset;
+    for (uint32_t i = 0; i < source.vertexCount; ++i) {
+      std::memcpy(dst, src, elementSize);
+      src += sourceStride;
+      dst += attrib.byteStride;
+    }
+  }
+}
+
+} // namespace
+
+const char *getVertexLayoutName(VertexLayout layout)
+{
+  return layout >= 0 && layout < VertexLayoutCount ? kVertexLayoutNames[layout]
+                                                   : "";
+}
+
+bool parseVertexLayout(const std::string &name, VertexLayout &layout)
+{
+  for (int i = 0; i < VertexLayoutCount; ++i) {
+    if (name == kVertexLayoutNames[i]) {
+      layout = VertexLayout(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void applyVertexLayout(Scene &scene, VertexLayout layout,
+    std::vector<unsigned char> &storage, ThreadPool *threadPool)
+{
+  if (layout == VertexLayoutSource) {
+    return;
+  }
+
+  // Primitives with the same key read the same vertices
+  using Key = std::array<int64_t, VertexAttribCount * 6 + 1>;
+  std::map<Key, size_t> setIndices;
+  std::vector<VertexSet> sets;
+  std::vector<int64_t> primitiveSets(scene.primitives.size(), -1);
+  uint64_t storageSize = 0;
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    const auto &primitive = scene.primitives[primIdx];
+    if (!hasAttributesInBounds(scene, primitive)) {
+      continue;
+    }
+    Key key;
+    size_t keyIdx = 0;
+    for (const auto &attrib : primitive.attributes) {
+      key[keyIdx++] = attrib.buffer;
+      key[keyIdx++] = attrib.size;
+      key[keyIdx++] = attrib.componentType;
+      key[keyIdx++] = attrib.byteStride;
+      key[keyIdx++] = attrib.normalized;
+      key[keyIdx++] = int64_t(attrib.byteOffset);
+    }
+    key[keyIdx] = primitive.vertexCount;
+    const auto it = setIndices.emplace(key, sets.size()).first;
+    if (it->second == sets.size()) {
+      VertexSet set;
+      set.source = &primitive;
+      storageSize = layOutVertexSet(set, layout, storageSize);
+      sets.push_back(set);
+    }
+    primitiveSets[primIdx] = int64_t(it->second);
+  }
+  if (sets.empty()) {
+    return;
+  }
+
+  storage.assign(storageSize, 0);
+  const auto repack = [&](size_t i) {
+    repackVertexSet(scene, sets[i], storage.data());
+  };
+  if (threadPool) {
+    threadPool->parallelFor(sets.size(), repack);
+  } else {
+    for (size_t i = 0; i < sets.size(); ++i) {
+      repack(i);
+    }
+  }
+
+  const auto bufferIdx = int32_t(scene.buffers.size());
+  scene.buffers.push_back({storage.data(), storage.size()});
+  for (size_t primIdx = 0; primIdx < scene.primitives.size(); ++primIdx) {
+    if (primitiveSets[primIdx] < 0) {
+      continue;
+    }
+    auto &primitive = scene.primitives[primIdx];
+    const auto &set = sets[primitiveSets[primIdx]];
+    for (size_t attribIdx = 0; attribIdx < VertexAttribCount; ++attribIdx) {
+      if (primitive.attributes[attribIdx].buffer >= 0) {
+        primitive.attributes[attribIdx] = set.attributes[attribIdx];
+        primitive.attributes[attribIdx].buffer = bufferIdx;
+      }
+    }
+  }
+}
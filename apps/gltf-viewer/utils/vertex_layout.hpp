@@ -0,0 +1,42 @@
+#pragma once
+
+#include "scene.hpp"
+#include "thread_pool.hpp"
+
+#include <string>
+#include <vector>
+
+// Layout of the vertex attributes of primitives in buffers
+enum VertexLayout {
+  // As stored by the glTF file, usually one tightly packed stream per
+  // attribute
+  VertexLayoutSource = 0,
+  // A single stream with all the attributes of a vertex next to each other
+  VertexLayoutInterleaved,
+  // A stream of positions, and a stream with the other attributes
+  // interleaved. Passes that only read positions (depth prepass, shadows)
+  // then fetch no other bytes.
+  VertexLayoutSplit,
+  VertexLayoutCount
+};
+
+// Name used on the command line ("source", "interleaved", "split"), and its
+// parsing. Returns false if name is unknown.
+const char *getVertexLayoutName(VertexLayout layout);
+bool parseVertexLayout(const std::string &name, VertexLayout &layout);
+
+// Repack the vertex attributes of the primitives of scene with layout. Does
+// nothing for VertexLayoutSource.
+//
+// Repacked vertices are written to storage, which is appended to
+// scene.buffers, and the attributes of primitives are updated to read them
+// there; indices are left where they are. Primitives with the same
+// attributes share their repacked vertices. Components keep their type (see
+// KHR_mesh_quantization), each attribute starting on a 4-byte boundary in a
+// vertex. Primitives whose attributes are out of the bounds of their buffer
+// are left unchanged.
+//
+// Vertices are repacked in parallel on threadPool if not null. storage must
+// stay alive and unchanged as long as scene.buffers are used.
+void applyVertexLayout(Scene &scene, VertexLayout layout,
+    std::vector<unsigned char> &storage, ThreadPool *threadPool);